@@ -16,9 +16,11 @@
 #define INTERPOLATION_ENABLED (!NoInterpolation)
 #endif
 #define OUTPUT_INTERPOLATION_TREE (INTERPOLATION_ENABLED &&OutputTree)
+#define STREAM_INTERPOLATION_TREE (INTERPOLATION_ENABLED &&StreamTree)
 #else
 #define INTERPOLATION_ENABLED false
 #define OUTPUT_INTERPOLATION_TREE false
+#define STREAM_INTERPOLATION_TREE false
 #endif
 
 namespace klee {
@@ -79,6 +81,12 @@ enum SpecStrategy {
   CUSTOM
 };
 
+enum SubsumptionEviction {
+  EVICT_OLDEST,
+  EVICT_LRU,
+  EVICT_HIT_RATIO
+};
+
 extern llvm::cl::opt<CoreSolverType> CoreSolverToUse;
 
 extern llvm::cl::opt<CoreSolverType> DebugCrossCheckCoreSolverWith;
@@ -87,16 +95,42 @@ extern llvm::cl::opt<CoreSolverType> DebugCrossCheckCoreSolverWith;
 // was undefined to avoid regression test failure.
 extern llvm::cl::opt<bool> NoInterpolation;
 
+extern llvm::cl::opt<unsigned> TxProfilingSampleRate;
+
 #ifdef ENABLE_Z3
 
 extern llvm::cl::opt<bool> OutputTree;
 
+extern llvm::cl::opt<bool> StreamTree;
+
 extern llvm::cl::opt<bool> SubsumedTest;
 
 extern llvm::cl::opt<bool> NoExistential;
 
 extern llvm::cl::opt<int> MaxFailSubsumption;
 
+extern llvm::cl::opt<unsigned> MaxSubsumptionTableMemory;
+
+extern llvm::cl::opt<SubsumptionEviction> SubsumptionEvictionToUse;
+
+extern llvm::cl::opt<bool> SubsumptionFailureCache;
+
+extern llvm::cl::opt<bool> UnsatCoreCache;
+
+extern llvm::cl::opt<unsigned> MaxUnsatCoreCache;
+
+extern llvm::cl::opt<bool> LazyDependency;
+
+extern llvm::cl::opt<bool> ConcreteFastPath;
+
+extern llvm::cl::opt<unsigned> ParallelSubsumption;
+
+extern llvm::cl::opt<unsigned> SubsumptionThreads;
+
+extern llvm::cl::opt<bool> SaveInterpolants;
+
+extern llvm::cl::opt<std::string> LoadInterpolants;
+
 extern llvm::cl::opt<int> DebugState;
 
 extern llvm::cl::opt<int> DebugSubsumption;
@@ -117,8 +151,16 @@ extern llvm::cl::opt<SpecStrategy> SpecStrategyToUse;
 
 extern llvm::cl::opt<std::string> DependencyFolder;
 
+extern llvm::cl::opt<std::string> SpecDependencyCache;
+
+extern llvm::cl::opt<bool> WriteSpecAvoid;
+
 extern llvm::cl::opt<bool> WPInterpolant;
 
+extern llvm::cl::opt<std::string> WPSimplificationTactics;
+
+extern llvm::cl::opt<unsigned> WPSimplificationThreshold;
+
 extern llvm::cl::opt<bool> MarkGlobal;
 
 #endif
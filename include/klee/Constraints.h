@@ -11,6 +11,7 @@
 #define KLEE_CONSTRAINTS_H
 
 #include "klee/Expr.h"
+#include "klee/util/ConstraintPartition.h"
 
 // FIXME: Currently we use ConstraintManager for two things: to pass
 // sets of constraints around, and to optimize constraints. We should
@@ -33,7 +34,9 @@ public:
   ConstraintManager(const std::vector< ref<Expr> > &_constraints) :
     constraints(_constraints) {}
 
-  ConstraintManager(const ConstraintManager &cs) : constraints(cs.constraints) {}
+  // the partition is shared until either copy is modified
+  ConstraintManager(const ConstraintManager &cs)
+      : constraints(cs.constraints), partition(cs.partition) {}
 
   typedef std::vector< ref<Expr> >::const_iterator constraint_iterator;
 
@@ -71,9 +74,21 @@ public:
 	  return constraints;
   }
 
+  /// \brief The partition of the constraints into independent factors,
+  /// computed on first use and then kept up to date as constraints are added
+  const ConstraintPartition &getPartition() const;
+
 private:
   std::vector< ref<Expr> > constraints;
 
+  /// \brief The partition of the constraints, or null if not yet computed.
+  /// It is shared copy-on-write between copies of the manager, e.g., across
+  /// ExecutionState::branch.
+  mutable ref<ConstraintPartition> partition;
+
+  /// \brief Append a constraint, updating the partition if computed
+  void pushConstraint(ref<Expr> e);
+
   // returns true iff the constraints were modified
   bool rewriteConstraints(ExprVisitor &visitor);
 
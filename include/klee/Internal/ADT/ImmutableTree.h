@@ -43,7 +43,7 @@ namespace klee {
 
     const value_type &min() const;
     const value_type &max() const;
-    size_t size() const;
+    size_t size() const; // constant time
 
     ImmutableTree insert(const value_type &value) const;
     ImmutableTree replace(const value_type &value) const;
@@ -75,6 +75,7 @@ namespace klee {
     Node *left, *right;
     value_type value;
     unsigned height, references;
+    size_t count; // number of values in the subtree, for constant-time size
 
   protected:
     Node(); // solely for creating the terminator node
@@ -248,7 +249,8 @@ namespace klee {
     : left(&terminator), 
       right(&terminator), 
       height(0), 
-      references(3) { 
+      references(3),
+      count(0) { 
     assert(this==&terminator);
   }
 
@@ -258,7 +260,8 @@ namespace klee {
       right(_right), 
       value(_value), 
       height(std::max(left->height, right->height) + 1),
-      references(1) 
+      references(1),
+      count(left->count + 1 + right->count)
   {
     ++allocated;
   }
@@ -333,11 +336,7 @@ namespace klee {
 
   template<class K, class V, class KOV, class CMP>
   size_t ImmutableTree<K,V,KOV,CMP>::Node::size() {
-    if (isTerminator()) {
-      return 0;
-    } else {
-      return left->size() + 1 + right->size();
-    }
+    return count;
   }
 
   template<class K, class V, class KOV, class CMP>
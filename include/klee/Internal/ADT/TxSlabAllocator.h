@@ -0,0 +1,167 @@
+//===-- TxSlabAllocator.h ---------------------------------------*- C++ -*-===//
+//
+//               The Tracer-X KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Typed slab allocators for the objects created on every branch of the
+/// interpolation tree.
+///
+/// A TxTreeNode and its TxDependency, TxStore and TxPathCondition are created
+/// on every split and deleted in TxTree::remove, mostly in the reverse order
+/// of their creation. The allocators below carve fixed-size slots out of large
+/// slabs and keep freed slots in a LIFO free list, so that the slot freed last
+/// is reused first.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef __UTIL_TXSLABALLOCATOR_H__
+#define __UTIL_TXSLABALLOCATOR_H__
+
+#include "klee/Statistic.h"
+
+#include <sstream>
+#include <stdint.h>
+
+namespace klee {
+
+/// \brief The counters and the bookkeeping common to all slab allocators
+class TxSlabAllocatorBase {
+  /// \brief The name of the allocated class, for printing
+  const char *name;
+
+protected:
+  /// \brief The size of a slot in bytes
+  size_t slotSize;
+
+  /// \brief The number of objects currently allocated
+  uint64_t live;
+
+  /// \brief The maximum of live
+  uint64_t peak;
+
+  /// \brief The number of allocations served
+  uint64_t total;
+
+  /// \brief The number of bytes reserved as slabs by this allocator
+  uint64_t reservedBytes;
+
+  /// \brief The number of allocations served by all slab allocators
+  static Statistic allocations;
+
+  /// \brief The number of allocations served from the free lists
+  static Statistic reuses;
+
+  /// \brief The number of bytes reserved as slabs by all slab allocators
+  static Statistic slabBytes;
+
+  TxSlabAllocatorBase(const char *_name, size_t _slotSize);
+
+  /// \brief Reserve a new slab of the given number of slots
+  char *newSlab(size_t slots);
+
+  void allocated() {
+    ++total;
+    if (++live > peak)
+      peak = live;
+    ++allocations;
+  }
+
+public:
+  /// \brief The slabs are never released: ref-counted objects may still be
+  /// freed into them by the destructors of other static objects at exit.
+  /// Memory limits account for their free slots with getTotalFreeBytes.
+  virtual ~TxSlabAllocatorBase() {}
+
+  const char *getName() const { return name; }
+
+  uint64_t getLive() const { return live; }
+
+  uint64_t getPeak() const { return peak; }
+
+  uint64_t getTotal() const { return total; }
+
+  uint64_t getReservedBytes() const { return reservedBytes; }
+
+  /// \brief The number of bytes of the slabs not holding a live object,
+  /// which are reused before any new slab is reserved
+  uint64_t getFreeBytes() const { return reservedBytes - live * slotSize; }
+
+  /// \brief The number of bytes reserved as slabs by all slab allocators
+  static uint64_t getSlabBytes() { return slabBytes; }
+
+  /// \brief The free bytes of all slab allocators. The slabs are counted as
+  /// in use by the malloc statistics, hence a memory limit on these is to
+  /// discount the free bytes.
+  static uint64_t getTotalFreeBytes();
+
+  /// \brief Print the counters of all slab allocators
+  static void printStat(std::stringstream &stream);
+};
+
+/// \brief A slab allocator for objects of class T. A class uses it by
+/// declaring a static instance and overloading its own operator new and
+/// operator delete to call allocate and deallocate.
+template <class T, unsigned SlotsPerSlab = 1024>
+class TxSlabAllocator : public TxSlabAllocatorBase {
+  union Slot {
+    Slot *next;
+    char storage[sizeof(T)];
+
+    // Alignment
+    void *pointer;
+    uint64_t integer;
+    long double floating;
+  };
+
+  /// \brief The last freed slot
+  Slot *freeList;
+
+  /// \brief The part of the current slab not yet handed out
+  Slot *unused, *unusedEnd;
+
+public:
+  explicit TxSlabAllocator(const char *_name)
+      : TxSlabAllocatorBase(_name, sizeof(Slot)), freeList(0), unused(0),
+        unusedEnd(0) {}
+
+  void *allocate(size_t size) {
+    // Objects of derived classes do not fit the slots
+    if (size != sizeof(T))
+      return ::operator new(size);
+
+    allocated();
+    if (freeList) {
+      Slot *slot = freeList;
+      freeList = slot->next;
+      ++reuses;
+      return slot;
+    }
+    if (unused == unusedEnd) {
+      unused = reinterpret_cast<Slot *>(newSlab(SlotsPerSlab));
+      unusedEnd = unused + SlotsPerSlab;
+    }
+    return unused++;
+  }
+
+  void deallocate(void *p, size_t size) {
+    if (!p)
+      return;
+    if (size != sizeof(T)) {
+      ::operator delete(p);
+      return;
+    }
+
+    --live;
+    Slot *slot = static_cast<Slot *>(p);
+    slot->next = freeList;
+    freeList = slot;
+  }
+};
+}
+
+#endif
@@ -15,6 +15,7 @@
 
 #include <map>
 #include <set>
+#include <string>
 #include <vector>
 
 namespace llvm {
@@ -113,6 +114,10 @@ namespace klee {
     // Functions which are part of KLEE runtime
     std::set<const llvm::Function*> internalFunctions;
 
+    // The variable dependency sets of the basic blocks for the speculation
+    // mode, computed by SpecDependencyPass
+    std::map<llvm::BasicBlock*, std::set<std::string> > specDependencies;
+
   private:
     // Mark function with functionName as part of the KLEE runtime
     void addInternalFunction(const char* functionName);
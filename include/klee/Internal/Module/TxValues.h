@@ -21,6 +21,9 @@
 
 #include "klee/Config/Version.h"
 #include "klee/Expr.h"
+#include "klee/Internal/ADT/TxSlabAllocator.h"
+
+#include "llvm/ADT/DenseMap.h"
 
 #if LLVM_VERSION_CODE >= LLVM_VERSION(3, 3)
 #include <llvm/IR/BasicBlock.h>
@@ -34,6 +37,7 @@
 #include <llvm/Value.h>
 #endif
 
+#include <map>
 #include <vector>
 
 namespace klee {
@@ -49,6 +53,61 @@ class TxStore;
 const uint64_t symbolicBoundId = ULONG_MAX;
 void setDebugSubsumptionLevelTxValue(int debugSubsumptionLevel);
 
+/// \brief An interned call history.
+///
+/// Every distinct sequence of call sites is represented by exactly one node of
+/// a global trie, whose parent is the call history without the most recent
+/// call site. Call histories are therefore passed around as pointers to the
+/// nodes, and compared by their unique ids. The nodes are never deleted.
+class TxCallHistory {
+  /// \brief The call history without the most recent call site
+  const TxCallHistory *parent;
+
+  /// \brief The most recent call site
+  llvm::Instruction *site;
+
+  /// \brief The unique id of the call history
+  uint64_t id;
+
+  /// \brief The number of call sites
+  unsigned length;
+
+  /// \brief The interned extensions of this call history by one call site
+  mutable std::map<llvm::Instruction *, TxCallHistory *> next;
+
+  static uint64_t internedCount;
+
+  TxCallHistory(const TxCallHistory *_parent, llvm::Instruction *_site)
+      : parent(_parent), site(_site), id(internedCount++),
+        length(_parent ? _parent->length + 1 : 0) {}
+
+public:
+  /// \brief The empty call history, the root of the trie
+  static const TxCallHistory *getEmpty();
+
+  /// \brief The call history extended with a call site
+  const TxCallHistory *push(llvm::Instruction *_site) const;
+
+  /// \brief The call history without the most recent call site. Popping the
+  /// empty call history returns itself.
+  const TxCallHistory *pop() const { return parent ? parent : this; }
+
+  /// \brief The most recent call site, or null for the empty call history
+  llvm::Instruction *getCallSite() const { return site; }
+
+  uint64_t getId() const { return id; }
+
+  unsigned size() const { return length; }
+
+  bool empty() const { return length == 0; }
+
+  /// \brief Retrieve the call sites, the outermost first
+  void getCallSites(std::vector<llvm::Instruction *> &sites) const;
+
+  /// \brief The number of distinct call histories interned so far
+  static uint64_t getInternedCount() { return internedCount; }
+};
+
 class TxAllocationContext {
 
 public:
@@ -59,52 +118,29 @@ private:
   llvm::Value *value;
 
   /// \brief The call history by which the allocation is reached
-  std::vector<llvm::Instruction *> callHistory;
+  const TxCallHistory *callHistory;
 
-  TxAllocationContext(llvm::Value *_value,
-                      const std::vector<llvm::Instruction *> &_callHistory)
+  TxAllocationContext(llvm::Value *_value, const TxCallHistory *_callHistory)
       : refCount(0), value(_value), callHistory(_callHistory) {}
 
 public:
-  ~TxAllocationContext() { callHistory.clear(); }
+  ~TxAllocationContext() {}
 
-  static ref<TxAllocationContext>
-  create(llvm::Value *_value,
-         const std::vector<llvm::Instruction *> &_callHistory);
+  static ref<TxAllocationContext> create(llvm::Value *_value,
+                                         const TxCallHistory *_callHistory);
 
   llvm::Value *getValue() const { return value; }
 
-  const std::vector<llvm::Instruction *> &getCallHistory() const {
-    return callHistory;
-  }
+  const TxCallHistory *getCallHistory() const { return callHistory; }
 
   int compare(const TxAllocationContext &other) const {
     if (value == other.value) {
-      // Please note the use of reverse iterator here, which improves
-      // performance.
-      for (std::vector<llvm::Instruction *>::const_reverse_iterator
-               it1 = callHistory.rbegin(),
-               ie1 = callHistory.rend(), it2 = other.callHistory.rbegin(),
-               ie2 = other.callHistory.rend();
-           ; ++it1, ++it2) {
-        if (it1 == ie1) {
-          if (it2 == ie2) {
-            break;
-          } else
-            return -1;
-        }
-        if (it2 == ie2)
-          return 1;
-        if (it1 == ie1)
-          return 1;
-        if ((*it1) > (*it2))
-          return 2;
-        if (it2 == ie2)
-          return -1;
-        if ((*it1) < (*it2))
-          return -2;
-      }
-      return 0;
+      // Call histories are interned, hence comparing their ids suffices.
+      if (callHistory->getId() == other.callHistory->getId())
+        return 0;
+      if (callHistory->getId() < other.callHistory->getId())
+        return -2;
+      return 2;
     } else if (value < other.value) {
       return -3;
     }
@@ -364,6 +400,18 @@ private:
          dummySubstitution, dummyReplacements);
   }
 
+  TxInterpolantValue(
+      llvm::Value *_value, ref<Expr> _expr, bool _doNotUseBound,
+      const std::map<ref<TxAllocationInfo>, std::set<uint64_t> > &
+          _allocationBounds,
+      const std::map<ref<TxAllocationInfo>, std::set<ref<Expr> > > &
+          _allocationOffsets)
+      : refCount(0), expr(_expr), allocationBounds(_allocationBounds),
+        allocationOffsets(_allocationOffsets), value(_value),
+        doNotUseBound(_doNotUseBound) {
+    id = reinterpret_cast<uintptr_t>(this);
+  }
+
 public:
   static ref<TxInterpolantValue>
   create(llvm::Value *value, ref<Expr> expr, bool canInterpolateBound,
@@ -384,6 +432,19 @@ public:
     return sv;
   }
 
+  /// \brief Create a value of the given offset bounds and offsets, for
+  /// loading a value saved into an interpolant database
+  static ref<TxInterpolantValue>
+  create(llvm::Value *value, ref<Expr> expr, bool doNotUseBound,
+         const std::map<ref<TxAllocationInfo>, std::set<uint64_t> > &
+             allocationBounds,
+         const std::map<ref<TxAllocationInfo>, std::set<ref<Expr> > > &
+             allocationOffsets) {
+    ref<TxInterpolantValue> sv(new TxInterpolantValue(
+        value, expr, doNotUseBound, allocationBounds, allocationOffsets));
+    return sv;
+  }
+
   ~TxInterpolantValue() {}
 
   int compare(const TxInterpolantValue other) const {
@@ -424,6 +485,16 @@ public:
 
   llvm::Value *getValue() const { return value; }
 
+  const std::map<ref<TxAllocationInfo>, std::set<uint64_t> > &
+  getAllocationBounds() const {
+    return allocationBounds;
+  }
+
+  const std::map<ref<TxAllocationInfo>, std::set<ref<Expr> > > &
+  getAllocationOffsets() const {
+    return allocationOffsets;
+  }
+
   void setOriginalValue(ref<TxStateValue> value) { originalValue = value; }
 
   ref<TxStateValue> getOriginalValue() const { return originalValue; }
@@ -526,8 +597,7 @@ public:
   ~TxStateAddress() {}
 
   static ref<TxStateAddress>
-  create(llvm::Value *value,
-         const std::vector<llvm::Instruction *> &_callHistory,
+  create(llvm::Value *value, const TxCallHistory *_callHistory,
          ref<Expr> &address, uint64_t size) {
     ref<Expr> zeroPointer = Expr::createPointer(0);
     ref<TxStateAddress> ret(
@@ -638,6 +708,9 @@ public:
   unsigned refCount;
 
 private:
+  /// \brief The slab allocator of the objects of this class
+  static TxSlabAllocator<TxStateValue> allocator;
+
   llvm::Value *value;
 
   const ref<Expr> valueExpr;
@@ -649,7 +722,7 @@ private:
   uint64_t id;
 
   /// \brief The context of this value
-  std::vector<llvm::Instruction *> callHistory;
+  const TxCallHistory *callHistory;
 
   /// \brief Store entries this value is dependent upon, on which memory bound
   /// interpolation may be enabled.
@@ -662,8 +735,7 @@ private:
   /// \brief The creation depth of this value.
   uint64_t depth;
 
-  TxStateValue(llvm::Value *value,
-               const std::vector<llvm::Instruction *> &_callHistory,
+  TxStateValue(llvm::Value *value, const TxCallHistory *_callHistory,
                ref<Expr> _valueExpr, uint64_t _depth)
       : refCount(0), value(value), valueExpr(_valueExpr),
         id(reinterpret_cast<uint64_t>(this)), callHistory(_callHistory),
@@ -672,9 +744,14 @@ private:
 public:
   ~TxStateValue() {}
 
+  static void *operator new(size_t size) { return allocator.allocate(size); }
+
+  static void operator delete(void *p, size_t size) {
+    allocator.deallocate(p, size);
+  }
+
   static ref<TxStateValue>
-  create(uint64_t depth, llvm::Value *value,
-         const std::vector<llvm::Instruction *> &_callHistory,
+  create(uint64_t depth, llvm::Value *value, const TxCallHistory *_callHistory,
          ref<Expr> valueExpr) {
     ref<TxStateValue> vvalue(
         new TxStateValue(value, _callHistory, valueExpr, depth));
@@ -739,9 +816,7 @@ public:
 
   llvm::Value *getValue() const { return value; }
 
-  const std::vector<llvm::Instruction *> &getCallHistory() const {
-    return callHistory;
-  }
+  const TxCallHistory *getCallHistory() const { return callHistory; }
 
   /// \brief Print minimal information about this object.
   ///
@@ -777,6 +852,12 @@ public:
   }
 };
 
+/// \brief The versions of the LLVM values created at a node of the
+/// interpolation tree, keyed by the LLVM value, the latest version last. This
+/// is the delta of the versioned values of the node over those of its parent.
+typedef llvm::DenseMap<llvm::Value *, std::vector<ref<TxStateValue> > >
+TxValuesMap;
+
 /// \brief A class for each entry in the store. This class also stores the
 /// information for memory bound interpolation. Hence, it has a static (e.g.,
 /// TxStoreEntry#value, TxStoreEntry#valueExpr, TxStoreEnty#entryList) as well
@@ -791,6 +872,9 @@ public:
   unsigned refCount;
 
 private:
+  /// \brief The slab allocator of the objects of this class
+  static TxSlabAllocator<TxStoreEntry> allocator;
+
   ref<TxStateAddress> address;
 
   ref<TxStateValue> addressValue;
@@ -856,6 +940,12 @@ public:
 
   ~TxStoreEntry() {}
 
+  static void *operator new(size_t size) { return allocator.allocate(size); }
+
+  static void operator delete(void *p, size_t size) {
+    allocator.deallocate(p, size);
+  }
+
   ref<TxVariable> getIndex() { return address->getAsVariable(); }
 
   ref<TxStateAddress> getAddress() { return address; }
@@ -10,13 +10,17 @@
 #ifndef KLEE_TRANSFORM_UTIL_H
 #define KLEE_TRANSFORM_UTIL_H
 
+#include <set>
 #include <string>
 
+#include <stdint.h>
+
 namespace llvm {
   class Function;
   class Instruction;
   class Module; 
   class CallSite; 
+  class Value;
 }
 
 namespace klee {
@@ -36,6 +40,15 @@ namespace klee {
   /// terminates in a direct call).
   bool functionEscapes(const llvm::Function *f);
 
+  /// Compute a hash of the textual IR of the module, for recognizing files
+  /// saved for the same module in an earlier run.
+  uint64_t hashModule(llvm::Module *module);
+
+  /// Collect the names of the variables a value depends on through its
+  /// operands: global variables and allocas, where the unnamed allocas of
+  /// the first two arguments of a function are named after the arguments.
+  void collectVariableNames(llvm::Value *v, std::set<std::string> &names);
+
 }
 
 #endif
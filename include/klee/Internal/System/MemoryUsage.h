@@ -15,6 +15,9 @@
 namespace klee {
   namespace util {
     size_t GetTotalMallocUsage();
+
+    /// The peak resident set size of the process in bytes.
+    size_t GetPeakResidentSetSize();
   }
 }
 
@@ -257,6 +257,58 @@ namespace klee {
     /// layers of solving
     bool directComputeValidity(const Query &query, Solver::Validity &result,
                                std::vector<ref<Expr> > &unsatCore);
+
+    /// startSession - Start an incremental session for a sequence of
+    /// (possibly quantified) queries sharing the same constraints. The
+    /// constraints are asserted only once, and each query is then checked
+    /// within its own push/pop scope. Any previous session is terminated.
+    void startSession(const ConstraintManager &constraints);
+
+    /// sessionComputeTruth - Compute the truth of the expression under the
+    /// constraints of the current session, without other layers of solving.
+    bool sessionComputeTruth(ref<Expr> expr, bool &isValid,
+                             std::vector<ref<Expr> > &unsatCore);
+
+    /// endSession - Terminate the current incremental session, if any.
+    void endSession();
+
+    bool inSession() const;
+  };
+
+  class Z3ParallelSolverImpl;
+
+  /// Z3ParallelSolver - Decides the validity of a batch of queries sharing
+  /// the same constraints using a pool of worker threads, each with its own
+  /// Z3 context. The queries are translated into SMT-LIBv2 scripts by the
+  /// calling thread, as KLEE expressions are not thread-safe, and the first
+  /// query found valid cancels the others. The worker which finds the query
+  /// valid also returns its unsat core.
+  class Z3ParallelSolver {
+    Z3ParallelSolverImpl *impl;
+
+  public:
+    /// Z3ParallelSolver - Construct a pool of the given number of workers.
+    Z3ParallelSolver(unsigned threadCount);
+
+    ~Z3ParallelSolver();
+
+    /// findValid - Solve the queries in parallel under the constraints.
+    ///
+    /// \param timeout The timeout of each query in seconds; 0 is off.
+    /// \param usefulTime Incremented by the solving time of the valid query.
+    /// \param wastedTime Incremented by the solving time of the other
+    /// queries, including the cancelled ones.
+    /// \param invalid Set to whether each query was found invalid; a query
+    /// that timed out or was cancelled is neither valid nor invalid.
+    /// \param unsatCore Filled with the constraints in the unsat core of the
+    /// query found valid.
+    /// \return The index of the query found valid, or -1 if no query was
+    /// found valid.
+    int findValid(const ConstraintManager &constraints,
+                  const std::vector<ref<Expr> > &queries, double timeout,
+                  double &usefulTime, double &wastedTime,
+                  std::vector<bool> &invalid,
+                  std::vector<ref<Expr> > &unsatCore);
   };
   #endif // ENABLE_Z3
 
@@ -0,0 +1,141 @@
+//===-- TxTimerStatIncrementer.h --------------------------------*- C++ -*-===//
+//
+//               The Tracer-X KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Low-overhead timers for the profiling of the interpolation methods.
+///
+/// Unlike TimerStatIncrementer, which reads the wall clock through
+/// gettimeofday twice per call, the timers here read the time stamp counter
+/// where available, and otherwise the coarse monotonic clock. They time only
+/// one in every -tx-profiling-sample-rate calls and scale the result by the
+/// number of calls. Configuring with --disable-tx-profiling compiles them out
+/// entirely.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_TXTIMERSTATINCREMENTER_H
+#define KLEE_TXTIMERSTATINCREMENTER_H
+
+#include "klee/Config/config.h"
+
+#include <sstream>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TX_PROFILING_USE_TSC
+#endif
+
+namespace klee {
+
+/// \brief The clock of the profiling timers, in ticks of unspecified length
+class TxProfilingClock {
+public:
+  static uint64_t now() {
+#ifdef TX_PROFILING_USE_TSC
+    uint32_t low, high;
+    __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+#else
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC_COARSE
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+  }
+
+  /// \brief The number of ticks per microsecond, calibrated against the
+  /// monotonic clock since the start of the program
+  static double ticksPerMicrosecond();
+};
+
+/// \brief A profiled time, with its call count and a histogram of the sampled
+/// latencies
+class TxTimerStatistic {
+public:
+  /// \brief The number of buckets of the histogram. Bucket i counts the
+  /// samples of at least 2^(i - 1) and less than 2^i ticks.
+  static const unsigned histogramSize = 48;
+
+private:
+  const char *name;
+
+  /// \brief The number of calls
+  uint64_t calls;
+
+  /// \brief The number of calls until the next sampled one
+  unsigned countdown;
+
+  /// \brief The number of sampled calls and their total ticks
+  uint64_t sampledCalls;
+  uint64_t sampledTicks;
+
+  uint64_t histogram[histogramSize];
+
+  /// \brief The value of -tx-profiling-sample-rate
+  static unsigned getSampleRate();
+
+public:
+  explicit TxTimerStatistic(const char *_name);
+
+  /// \brief Count a call, returning true if it is to be sampled
+  bool count() {
+    ++calls;
+    if (--countdown)
+      return false;
+    countdown = getSampleRate();
+    return true;
+  }
+
+  void addSample(uint64_t ticks);
+
+  const char *getName() const { return name; }
+
+  uint64_t getCalls() const { return calls; }
+
+  uint64_t getSampledCalls() const { return sampledCalls; }
+
+  /// \brief The total time of all calls in microseconds, estimated from the
+  /// sampled calls
+  uint64_t getValue() const;
+
+  operator uint64_t() const { return getValue(); }
+
+  /// \brief Print the call counts, times and histograms of all timers that
+  /// have been called
+  static void printStat(std::stringstream &stream);
+};
+
+/// \brief Add the time of its scope to a TxTimerStatistic, for the sampled
+/// calls
+class TxTimerStatIncrementer {
+#ifndef KLEE_DISABLE_TX_PROFILING
+  TxTimerStatistic &statistic;
+  uint64_t start;
+
+public:
+  explicit TxTimerStatIncrementer(TxTimerStatistic &_statistic)
+      : statistic(_statistic),
+        start(_statistic.count() ? TxProfilingClock::now() : 0) {}
+
+  ~TxTimerStatIncrementer() {
+    if (start)
+      statistic.addSample(TxProfilingClock::now() - start);
+  }
+#else
+public:
+  explicit TxTimerStatIncrementer(TxTimerStatistic &) {}
+#endif
+};
+}
+
+#endif
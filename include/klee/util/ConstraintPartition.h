@@ -0,0 +1,99 @@
+//===-- ConstraintPartition.h -----------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_UTIL_CONSTRAINTPARTITION_H
+#define KLEE_UTIL_CONSTRAINTPARTITION_H
+
+#include "klee/Expr.h"
+
+#include <map>
+#include <vector>
+
+namespace klee {
+
+/// \brief The partition of a constraint set into independent factors.
+///
+/// The elements are the individual bytes of the arrays read at constant
+/// indices, and the whole arrays read at symbolic indices. A whole array
+/// element is joined with all the byte elements of the same array. The
+/// elements are kept in a union-find structure, and every constraint is
+/// recorded in the class of the elements it reads, such that two constraints
+/// are in the same class exactly when they are transitively dependent.
+///
+/// The partition is updated incrementally as constraints are added, which
+/// makes finding the constraints relevant to an expression a lookup instead
+/// of a fixpoint computation.
+class ConstraintPartition {
+  /// \brief The elements of an array
+  struct ArrayElements {
+    /// \brief Whether the array is read at a symbolic index
+    bool wholeRead;
+
+    /// \brief The element of the whole array, valid when wholeRead is set
+    unsigned whole;
+
+    /// \brief The elements of the bytes read at constant indices
+    std::map<unsigned, unsigned> bytes;
+
+    ArrayElements() : wholeRead(false), whole(0) {}
+  };
+
+  std::map<const Array *, ArrayElements> arrays;
+
+  /// \brief The union-find forest of the elements
+  mutable std::vector<unsigned> parent;
+
+  /// \brief The indices of the constraints of each class, stored at the root
+  /// element of the class
+  std::vector<std::vector<unsigned> > members;
+
+  /// \brief A read of an array, at a constant index unless whole is set
+  struct Access {
+    const Array *array;
+    bool whole;
+    unsigned index;
+
+    Access(const Array *_array, bool _whole, unsigned _index)
+        : array(_array), whole(_whole), index(_index) {}
+  };
+
+  /// \brief Collect the reads of an expression that may alias
+  static void getAccesses(ref<Expr> e, std::vector<Access> &accesses);
+
+  unsigned newElement();
+
+  unsigned find(unsigned element) const;
+
+  /// \brief Merge the classes of two elements, returning the new root
+  unsigned unite(unsigned a, unsigned b);
+
+public:
+  unsigned refCount;
+
+  ConstraintPartition() : refCount(0) {}
+
+  ConstraintPartition(const ConstraintPartition &other)
+      : arrays(other.arrays), parent(other.parent), members(other.members),
+        refCount(0) {}
+
+  /// \brief Record a constraint, given its index in the constraint set
+  void add(unsigned index, ref<Expr> constraint);
+
+  /// \brief The indices, in ascending order, of the constraints which are
+  /// transitively dependent on the expression
+  void getDependentConstraints(ref<Expr> e,
+                               std::vector<unsigned> &indices) const;
+
+  /// \brief The indices of the constraints of each class, in ascending order
+  /// within each class. Constraints that read no array are not in any class.
+  void getFactors(std::vector<std::vector<unsigned> > &factors) const;
+};
+}
+
+#endif
@@ -21,6 +21,7 @@
 
 #include "llvm/Support/raw_ostream.h"
 
+#include <fstream>
 #include <map>
 
 namespace klee {
@@ -34,6 +35,24 @@ class TxSubsumptionTableEntry;
 class TxTreeNode;
 
 /// \brief The interpolation tree graph for outputting to .dot file.
+///
+/// With -output-tree, the graph is built in memory and rendered at the end of
+/// the run. With -stream-tree, the changes to the graph are instead written to
+/// a log as they happen, one event per line, and only the nodes of the
+/// interpolation tree that are still alive are remembered:
+///
+///   root <node>
+///   split <parent> <false child> <true child>
+///   visit <node> <sequence number> <name>
+///   mark <node>
+///   condition <node> <condition> <text>
+///   core <condition>
+///   subsumed <node> <subsuming node, or 0 if unknown>
+///   error <node> <assertion|memory|generic> <location>
+///
+/// The nodes and conditions are numbered from 1 in order of creation, and
+/// backslashes and newlines in the names, texts and locations are escaped as
+/// \\ and \n. The log is converted to .dot or JSON by tx-tree-convert.
 class TxTreeGraph {
 
 public:
@@ -129,6 +148,56 @@ private:
     std::string render() const;
   };
 
+  /// \brief The event log of -stream-tree
+  class EventLog {
+    friend class TxTreeGraph;
+
+    /// \brief A node of the interpolation tree that is not yet removed
+    struct LiveNode {
+      uint64_t id;
+
+      /// \brief Whether the node has been visited by a state
+      bool visited;
+
+      /// \brief The path conditions added at the node
+      std::vector<TxPCConstraint *> conditions;
+
+      LiveNode() : id(0), visited(false) {}
+    };
+
+    std::ofstream out;
+
+    uint64_t nodeId;
+
+    uint64_t conditionId;
+
+    std::map<TxTreeNode *, LiveNode> liveNodes;
+
+    std::map<TxPCConstraint *, uint64_t> conditionIds;
+
+    /// \brief The ids of the nodes where the table entries were created
+    std::map<TxSubsumptionTableEntry *, uint64_t> entryNodeIds;
+
+    EventLog(const std::string &fileName, TxTreeNode *root);
+
+    uint64_t newNode(TxTreeNode *txTreeNode);
+
+    /// \brief The id of a node, or 0 if unknown
+    uint64_t getId(TxTreeNode *txTreeNode) const;
+
+    /// \brief Escape backslashes and newlines
+    static std::string escape(const std::string &s);
+  };
+
+  static EventLog *eventLog;
+
+  /// \brief The human-readable identifier of a node: the function and the
+  /// location of the state's instruction
+  static std::string getName(const ExecutionState &state);
+
+  /// \brief The location of the state's instruction
+  static std::string getLocation(const ExecutionState &state);
+
   TxTreeGraph::Node *root;
   std::map<TxTreeNode *, TxTreeGraph::Node *> txTreeNodeMap;
   std::map<TxSubsumptionTableEntry *, TxTreeGraph::Node *> tableEntryMap;
@@ -156,16 +225,22 @@ private:
 public:
   static uint64_t nodeCount;
 
-  static void initialize(TxTreeNode *root) {
-    if (!OUTPUT_INTERPOLATION_TREE)
-      return;
+  /// \brief Create the graph, and with -stream-tree, start the event log
+  /// into the given file
+  static void initialize(TxTreeNode *root, const std::string &logFileName);
 
-    if (!instance)
-      delete instance;
-    instance = new TxTreeGraph(root);
+  /// \brief Test if the path conditions are needed for the graph or the
+  /// event log as soon as they are added
+  static bool isRecordingPathConditions() {
+    return OUTPUT_INTERPOLATION_TREE || eventLog;
   }
 
   static void deallocate() {
+    if (eventLog) {
+      delete eventLog;
+      eventLog = 0;
+    }
+
     if (!OUTPUT_INTERPOLATION_TREE)
       return;
 
@@ -190,12 +265,18 @@ public:
   static void addTableEntryMapping(TxTreeNode *txTreeNode,
                                    TxSubsumptionTableEntry *entry);
 
+  static void removeTableEntryMapping(TxSubsumptionTableEntry *entry);
+
+  /// \brief Forget a node of the interpolation tree which is about to be
+  /// deleted. This only matters to the event log of -stream-tree.
+  static void removeNode(TxTreeNode *txTreeNode);
+
   static void setAsCore(TxPCConstraint *pathCondition);
 
   static void setError(const ExecutionState &state,
                        TxTreeGraph::Error errorType);
 
-  /// \brief Save the graph
+  /// \brief Save the graph, and flush the event log
   static void save(std::string dotFileName);
 };
 }
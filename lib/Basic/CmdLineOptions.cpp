@@ -90,6 +90,13 @@ llvm::cl::opt<bool> NoInterpolation(
                    "Interpolation is enabled by default when Z3 was the solver "
                    "used. This option has no effect when Z3 was not used."));
 
+llvm::cl::opt<unsigned> TxProfilingSampleRate(
+    "tx-profiling-sample-rate",
+    llvm::cl::desc("Time only one in every n calls of the profiled "
+                   "interpolation methods, and estimate the total time from "
+                   "the sampled calls (default=1)."),
+    llvm::cl::init(1));
+
 #ifdef ENABLE_Z3
 llvm::cl::opt<bool> OutputTree(
     "output-tree",
@@ -97,6 +104,15 @@ llvm::cl::opt<bool> OutputTree(
                    "format. At present, this feature is only available when "
                    "Z3 is compiled in and interpolation is enabled."));
 
+llvm::cl::opt<bool> StreamTree(
+    "stream-tree",
+    llvm::cl::desc("Outputs tree.log: the execution tree as a log of events "
+                   "written while the tree is explored, such that the memory "
+                   "used does not grow with the size of the tree. The log is "
+                   "converted into .dot or JSON format with tx-tree-convert. "
+                   "At present, this feature is only available when Z3 is "
+                   "compiled in and interpolation is enabled."));
+
 llvm::cl::opt<bool>
 SubsumedTest("subsumed-test",
              llvm::cl::desc("Enables generation of test cases for subsumed "
@@ -121,12 +137,101 @@ llvm::cl::opt<bool> NoExistential(
 
 llvm::cl::opt<int> MaxFailSubsumption(
     "max-subsumption-failure",
-    llvm::cl::desc("To set the maximum number of failed subsumption check. "
+    llvm::cl::desc("To set the maximum number of subsumption table entries. "
                    "When this options is specified and the number of "
                    "subsumption table entries is more than the specified "
-                   "value, the oldest entry will be deleted (default=0 (off))"),
+                   "value, an entry chosen by -subsumption-eviction will be "
+                   "deleted (default=0 (off))"),
+    llvm::cl::init(0));
+
+llvm::cl::opt<unsigned> MaxSubsumptionTableMemory(
+    "max-subsumption-table-memory",
+    llvm::cl::desc("To set the approximate memory budget of the subsumption "
+                   "table in megabytes. When the budget is exceeded, entries "
+                   "chosen by -subsumption-eviction will be deleted "
+                   "(default=0 (off))"),
+    llvm::cl::init(0));
+
+llvm::cl::opt<SubsumptionEviction> SubsumptionEvictionToUse(
+    "subsumption-eviction",
+    llvm::cl::desc("Policy to choose the subsumption table entry to delete "
+                   "when the table is bounded by -max-subsumption-failure or "
+                   "-max-subsumption-table-memory"),
+    llvm::cl::values(
+        clEnumValN(EVICT_OLDEST, "oldest", "the oldest entry (default)"),
+        clEnumValN(EVICT_LRU, "lru", "the least-recently-hit entry"),
+        clEnumValN(EVICT_HIT_RATIO, "hit-ratio",
+                   "the entry with the lowest hit/attempt ratio"),
+        clEnumValEnd),
+    llvm::cl::init(EVICT_OLDEST));
+
+llvm::cl::opt<bool> SubsumptionFailureCache(
+    "subsumption-failure-cache",
+    llvm::cl::desc("Remember the subsumption queries which the solver did not "
+                   "find valid for each table entry, and fail the same check "
+                   "again without calling the solver (default=false)"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<bool> UnsatCoreCache(
+    "unsat-core-cache",
+    llvm::cl::desc("Remember the unsat cores of the branch conditions found "
+                   "valid or unsatisfiable, and reuse one without calling the "
+                   "solver when the same branch condition is evaluated under "
+                   "a path condition containing it (default=false)"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<unsigned> MaxUnsatCoreCache(
+    "max-unsat-core-cache",
+    llvm::cl::desc("To set the maximum number of unsat cores kept by "
+                   "-unsat-core-cache. When the number is exceeded, the cores "
+                   "of the oldest branch conditions are deleted "
+                   "(default=65536, 0 (unbounded))"),
+    llvm::cl::init(65536));
+
+llvm::cl::opt<bool> LazyDependency(
+    "lazy-dependency",
+    llvm::cl::desc("Record the instructions executed on an interpolation tree "
+                   "node, and build its dependency information from the "
+                   "record only when a subsumption check, a marking or the "
+                   "tabling of its interpolant needs it (default=false)"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<bool> ConcreteFastPath(
+    "concrete-fast-path",
+    llvm::cl::desc("Do not build dependency information for the integer and "
+                   "floating-point constant operands of arithmetic, "
+                   "comparison and select instructions, nor for the "
+                   "instructions of no argument other than the conditional "
+                   "branches (default=true)"),
+    llvm::cl::init(true));
+
+llvm::cl::opt<unsigned> ParallelSubsumption(
+    "parallel-subsumption",
+    llvm::cl::desc("Solve the subsumption queries of this many table entries "
+                   "at a time in parallel, stopping at the first entry that "
+                   "subsumes the state (default=0 (off))"),
     llvm::cl::init(0));
 
+llvm::cl::opt<unsigned> SubsumptionThreads(
+    "subsumption-threads",
+    llvm::cl::desc("Number of solver threads used by -parallel-subsumption "
+                   "(default=4)"),
+    llvm::cl::init(4));
+
+llvm::cl::opt<bool> SaveInterpolants(
+    "save-interpolants",
+    llvm::cl::desc("Save the subsumption table into interpolants.txdb in the "
+                   "output directory at the end of the run, to be preloaded "
+                   "using -load-interpolants (default=false)"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<std::string> LoadInterpolants(
+    "load-interpolants",
+    llvm::cl::desc("Preload the subsumption table from an interpolant "
+                   "database saved by -save-interpolants. A database saved "
+                   "for a different module is rejected."),
+    llvm::cl::init(""));
+
 llvm::cl::opt<int>
 DebugState("debug-state",
            llvm::cl::desc("Dump information on symbolic execution state when "
@@ -201,14 +306,44 @@ llvm::cl::opt<std::string> DependencyFolder(
         "One file for each BB with name format: \"BB_Dep_{order}.txt\""
         "An initial file containing visited BBs with name "
         "\"InitialVisitedBB.txt\""
-        "also must be put in this folder"),
+        "also must be put in this folder. When not given, the dependency "
+        "sets are computed from the module (see -spec-dependency-cache)."),
     llvm::cl::init("."));
 
+llvm::cl::opt<std::string> SpecDependencyCache(
+    "spec-dependency-cache",
+    llvm::cl::desc("The file caching the dependency sets computed from the "
+                   "module when -spec-dependency is not given, reused by the "
+                   "runs on the same module (default=spec.txdep in the "
+                   "output directory)"),
+    llvm::cl::init(""));
+
+llvm::cl::opt<bool> WriteSpecAvoid(
+    "write-spec-avoid",
+    llvm::cl::desc("Write the dependency sets computed from the module into "
+                   "the output directory, one SpecAvoid_{order}.txt file per "
+                   "target block, in the format of the -spec-dependency "
+                   "folder (default=false)"),
+    llvm::cl::init(false));
+
 llvm::cl::opt<bool>
 WPInterpolant("wp-interpolant",
               llvm::cl::desc("Perform weakest-precondition interpolation"),
               llvm::cl::init(false));
 
+llvm::cl::opt<std::string> WPSimplificationTactics(
+    "wp-simplification-tactics",
+    llvm::cl::desc("Comma-separated list of the Z3 tactics applied in order "
+                   "to simplify weakest preconditions "
+                   "(default=simplify,ctx-solver-simplify)"),
+    llvm::cl::init("simplify,ctx-solver-simplify"));
+
+llvm::cl::opt<unsigned> WPSimplificationThreshold(
+    "wp-simplification-threshold",
+    llvm::cl::desc("Do not simplify weakest preconditions of fewer distinct "
+                   "expression nodes than this (default=0 (off))"),
+    llvm::cl::init(0));
+
 llvm::cl::opt<bool>
 MarkGlobal("mark-global",
            llvm::cl::desc("Decide whether global variables are marked or not"),
@@ -0,0 +1,68 @@
+//===-- TxSlabAllocator.cpp -------------------------------------*- C++ -*-===//
+//
+//               The Tracer-X KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/ADT/TxSlabAllocator.h"
+
+#include <new>
+#include <vector>
+
+using namespace klee;
+
+Statistic TxSlabAllocatorBase::allocations("TxSlabAllocations",
+                                           "TxSlabAlloc");
+Statistic TxSlabAllocatorBase::reuses("TxSlabReuses", "TxSlabReuse");
+Statistic TxSlabAllocatorBase::slabBytes("TxSlabBytes", "TxSlabBytes");
+
+namespace {
+/// \brief All slab allocators, in order of construction. This is a function
+/// static, as the allocators are themselves static objects of various
+/// translation units.
+std::vector<TxSlabAllocatorBase *> &getAllocators() {
+  static std::vector<TxSlabAllocatorBase *> allocators;
+  return allocators;
+}
+}
+
+TxSlabAllocatorBase::TxSlabAllocatorBase(const char *_name, size_t _slotSize)
+    : name(_name), slotSize(_slotSize), live(0), peak(0), total(0),
+      reservedBytes(0) {
+  getAllocators().push_back(this);
+}
+
+char *TxSlabAllocatorBase::newSlab(size_t slots) {
+  size_t size = slots * slotSize;
+  reservedBytes += size;
+  slabBytes += size;
+  return static_cast<char *>(::operator new(size));
+}
+
+uint64_t TxSlabAllocatorBase::getTotalFreeBytes() {
+  std::vector<TxSlabAllocatorBase *> &allocators = getAllocators();
+  uint64_t freeBytes = 0;
+  for (std::vector<TxSlabAllocatorBase *>::iterator it = allocators.begin(),
+                                                     ie = allocators.end();
+       it != ie; ++it) {
+    freeBytes += (*it)->getFreeBytes();
+  }
+  return freeBytes;
+}
+
+void TxSlabAllocatorBase::printStat(std::stringstream &stream) {
+  std::vector<TxSlabAllocatorBase *> &allocators = getAllocators();
+  for (std::vector<TxSlabAllocatorBase *>::iterator it = allocators.begin(),
+                                                     ie = allocators.end();
+       it != ie; ++it) {
+    stream << "KLEE: done:     " << (*it)->getName()
+           << ": allocated = " << (*it)->getTotal()
+           << ", live = " << (*it)->getLive()
+           << ", peak = " << (*it)->getPeak()
+           << ", reserved (KiB) = " << ((*it)->getReservedBytes() >> 10)
+           << "\n";
+  }
+}
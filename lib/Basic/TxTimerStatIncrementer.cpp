@@ -0,0 +1,112 @@
+//===-- TxTimerStatIncrementer.cpp ------------------------------*- C++ -*-===//
+//
+//               The Tracer-X KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/TxTimerStatIncrementer.h"
+
+#include "klee/CommandLine.h"
+
+#include <iomanip>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+uint64_t getMonotonicNanoseconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/// \brief The clock readings at the start of the program, for calibration
+const uint64_t startTicks = TxProfilingClock::now();
+const uint64_t startNanoseconds = getMonotonicNanoseconds();
+
+/// \brief All timers, in order of construction. This is a function static, as
+/// the timers are themselves static objects of various translation units.
+std::vector<TxTimerStatistic *> &getTimers() {
+  static std::vector<TxTimerStatistic *> timers;
+  return timers;
+}
+}
+
+double TxProfilingClock::ticksPerMicrosecond() {
+#ifdef TX_PROFILING_USE_TSC
+  uint64_t ticks = now() - startTicks;
+  uint64_t nanoseconds = getMonotonicNanoseconds() - startNanoseconds;
+  if (!nanoseconds || !ticks)
+    return 1000;
+  return (double)ticks * 1000 / nanoseconds;
+#else
+  return 1000;
+#endif
+}
+
+TxTimerStatistic::TxTimerStatistic(const char *_name)
+    : name(_name), calls(0), countdown(1), sampledCalls(0), sampledTicks(0) {
+  for (unsigned i = 0; i < histogramSize; ++i)
+    histogram[i] = 0;
+  getTimers().push_back(this);
+}
+
+unsigned TxTimerStatistic::getSampleRate() {
+  return TxProfilingSampleRate ? TxProfilingSampleRate : 1;
+}
+
+void TxTimerStatistic::addSample(uint64_t ticks) {
+  ++sampledCalls;
+  sampledTicks += ticks;
+
+  unsigned bucket = 0;
+  while (ticks && bucket < histogramSize - 1) {
+    ticks >>= 1;
+    ++bucket;
+  }
+  ++histogram[bucket];
+}
+
+uint64_t TxTimerStatistic::getValue() const {
+  if (!sampledCalls)
+    return 0;
+  double ticks = (double)sampledTicks * calls / sampledCalls;
+  return (uint64_t)(ticks / TxProfilingClock::ticksPerMicrosecond());
+}
+
+void TxTimerStatistic::printStat(std::stringstream &stream) {
+#ifdef KLEE_DISABLE_TX_PROFILING
+  stream << "KLEE: done:     Profiling timers are disabled\n";
+#else
+  double ticksPerMicrosecond = TxProfilingClock::ticksPerMicrosecond();
+  std::vector<TxTimerStatistic *> &timers = getTimers();
+  for (std::vector<TxTimerStatistic *>::iterator it = timers.begin(),
+                                                  ie = timers.end();
+       it != ie; ++it) {
+    TxTimerStatistic *timer = *it;
+    if (!timer->sampledCalls)
+      continue;
+
+    stream << "KLEE: done:     " << timer->name
+           << ": calls = " << timer->calls
+           << ", sampled = " << timer->sampledCalls
+           << ", total (ms) = " << ((double)timer->getValue()) / 1000
+           << ", average (us) = "
+           << (double)timer->sampledTicks / timer->sampledCalls /
+                  ticksPerMicrosecond << "\n";
+
+    // The histogram of the sampled latencies, omitting the empty buckets
+    for (unsigned i = 0; i < histogramSize; ++i) {
+      if (!timer->histogram[i])
+        continue;
+      stream << "KLEE: done:       < " << std::setprecision(3)
+             << (double)((uint64_t)1 << i) / ticksPerMicrosecond
+             << " us: " << timer->histogram[i] << "\n";
+    }
+  }
+  stream << std::setprecision(6);
+#endif
+}
@@ -0,0 +1,185 @@
+//===-- CopyOnWriteArray.h --------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_COPYONWRITEARRAY_H
+#define KLEE_COPYONWRITEARRAY_H
+
+#include "CoreStats.h"
+
+#include <algorithm>
+#include <stdint.h>
+
+namespace klee {
+
+/// An array split into chunks of 2^chunkShift elements. The copies of an
+/// array share its chunks, and a chunk is copied only when one of the copies
+/// writes to it, so that a write to a large object after a fork copies a
+/// single chunk instead of the whole object.
+template <class T> class CopyOnWriteArray {
+  struct Chunk {
+    unsigned refCount;
+    T *elements;
+
+    explicit Chunk(unsigned length) : refCount(1), elements(new T[length]) {}
+    ~Chunk() { delete[] elements; }
+  };
+
+  unsigned size;
+  unsigned chunkShift;
+  unsigned chunkCount;
+  Chunk **chunks;
+
+  unsigned getChunkLength(unsigned c) const {
+    return std::min(size - (c << chunkShift), 1u << chunkShift);
+  }
+
+  unsigned getChunkOffset(unsigned i) const {
+    return i & ((1u << chunkShift) - 1);
+  }
+
+  /// Make chunk c exclusive to this array, copying its elements if it is
+  /// shared
+  T *getWriteableChunk(unsigned c) {
+    Chunk *chunk = chunks[c];
+    if (chunk->refCount == 1)
+      return chunk->elements;
+
+    unsigned length = getChunkLength(c);
+    Chunk *copy = new Chunk(length);
+    std::copy(chunk->elements, chunk->elements + length, copy->elements);
+    --chunk->refCount;
+    chunks[c] = copy;
+    stats::objectBytesCopied += length * sizeof(T);
+    return copy->elements;
+  }
+
+  /// Make chunk c exclusive to this array without copying its elements, for
+  /// when all of them are about to be overwritten
+  T *replaceChunk(unsigned c) {
+    Chunk *chunk = chunks[c];
+    if (chunk->refCount == 1)
+      return chunk->elements;
+
+    --chunk->refCount;
+    chunks[c] = new Chunk(getChunkLength(c));
+    return chunks[c]->elements;
+  }
+
+  // DO NOT IMPLEMENT
+  CopyOnWriteArray &operator=(const CopyOnWriteArray &a);
+
+public:
+  CopyOnWriteArray(unsigned _size, unsigned _chunkShift, const T &value)
+      : size(_size), chunkShift(_chunkShift),
+        chunkCount((_size >> _chunkShift) +
+                   ((_size & ((1u << _chunkShift) - 1)) != 0)),
+        chunks(new Chunk *[chunkCount]) {
+    for (unsigned c = 0; c < chunkCount; ++c) {
+      unsigned length = getChunkLength(c);
+      chunks[c] = new Chunk(length);
+      std::fill(chunks[c]->elements, chunks[c]->elements + length, value);
+    }
+  }
+
+  CopyOnWriteArray(const CopyOnWriteArray &a)
+      : size(a.size), chunkShift(a.chunkShift), chunkCount(a.chunkCount),
+        chunks(new Chunk *[a.chunkCount]) {
+    for (unsigned c = 0; c < chunkCount; ++c) {
+      chunks[c] = a.chunks[c];
+      ++chunks[c]->refCount;
+    }
+  }
+
+  ~CopyOnWriteArray() {
+    for (unsigned c = 0; c < chunkCount; ++c) {
+      if (--chunks[c]->refCount == 0)
+        delete chunks[c];
+    }
+    delete[] chunks;
+  }
+
+  const T &operator[](unsigned i) const {
+    return chunks[i >> chunkShift]->elements[getChunkOffset(i)];
+  }
+
+  /// Get an element for writing, copying its chunk if it is shared
+  T &at(unsigned i) {
+    return getWriteableChunk(i >> chunkShift)[getChunkOffset(i)];
+  }
+
+  /// Set all elements to the value
+  void fill(const T &value) {
+    for (unsigned c = 0; c < chunkCount; ++c) {
+      T *elements = replaceChunk(c);
+      std::fill(elements, elements + getChunkLength(c), value);
+    }
+  }
+
+  /// Copy the elements into the buffer of size elements
+  void copyOut(T *dest) const {
+    for (unsigned c = 0; c < chunkCount; ++c) {
+      const T *elements = chunks[c]->elements;
+      dest = std::copy(elements, elements + getChunkLength(c), dest);
+    }
+  }
+
+  /// Set the elements from the buffer of size elements. Only the chunks that
+  /// differ from the buffer are written.
+  void copyIn(const T *src) {
+    for (unsigned c = 0; c < chunkCount; ++c) {
+      unsigned length = getChunkLength(c);
+      if (!std::equal(src, src + length, chunks[c]->elements))
+        std::copy(src, src + length, replaceChunk(c));
+      src += length;
+    }
+  }
+
+  /// Test if the elements equal the buffer of size elements
+  bool equals(const T *src) const {
+    for (unsigned c = 0; c < chunkCount; ++c) {
+      unsigned length = getChunkLength(c);
+      if (!std::equal(src, src + length, chunks[c]->elements))
+        return false;
+      src += length;
+    }
+    return true;
+  }
+};
+
+/// A bit array whose words are in copy-on-write chunks, aligned with the
+/// chunks of a CopyOnWriteArray of the same chunk shift
+class CopyOnWriteBitArray {
+  CopyOnWriteArray<uint32_t> words;
+
+  static unsigned getWordShift(unsigned chunkShift) {
+    return chunkShift > 5 ? chunkShift - 5 : 0;
+  }
+
+public:
+  CopyOnWriteBitArray(unsigned size, unsigned chunkShift, bool value)
+      : words((size + 31) / 32, getWordShift(chunkShift),
+              value ? 0xFFFFFFFF : 0) {}
+
+  bool get(unsigned idx) const { return (words[idx / 32] >> (idx % 32)) & 1; }
+
+  // A bit already of the value is not written, so as not to copy its chunk
+  void set(unsigned idx) {
+    if (!get(idx))
+      words.at(idx / 32) |= 1u << (idx % 32);
+  }
+
+  void unset(unsigned idx) {
+    if (get(idx))
+      words.at(idx / 32) &= ~(1u << (idx % 32));
+  }
+};
+
+} // End klee namespace
+
+#endif
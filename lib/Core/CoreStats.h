@@ -30,6 +30,17 @@ namespace stats {
   /// The number of process forks.
   extern Statistic forks;
 
+  /// The number of bytes of object contents copied on write after a fork.
+  extern Statistic objectBytesCopied;
+
+  /// The number of multi-byte reads at a concrete offset answered by a whole
+  /// word, either a constant or the expression last written to it.
+  extern Statistic wordReads;
+
+  /// The number of multi-byte reads and writes at a symbolic offset, each
+  /// flushing the object once for the whole word.
+  extern Statistic symbolicWordAccesses;
+
   /// Number of states, this is a "fake" statistic used by istats, it
   /// isn't normally up-to-date.
   extern Statistic states;
@@ -390,25 +390,25 @@ void ExecutionState::dumpStack(llvm::raw_ostream &out) const {
 }
 
 void ExecutionState::debugSubsumption(uint64_t level) {
-  txTreeNode->dependency->debugSubsumptionLevel = level;
+  txTreeNode->getDependency()->debugSubsumptionLevel = level;
 }
 
 void ExecutionState::debugSubsumptionOff() {
 #if ENABLE_Z3
-  txTreeNode->dependency->debugSubsumptionLevel = DebugSubsumption;
+  txTreeNode->getDependency()->debugSubsumptionLevel = DebugSubsumption;
 #else
-  txTreeNode->dependency->debugSubsumptionLevel = 0;
+  txTreeNode->getDependency()->debugSubsumptionLevel = 0;
 #endif
 }
 
 void ExecutionState::debugState(uint64_t level) {
-  txTreeNode->dependency->debugStateLevel = level;
+  txTreeNode->getDependency()->debugStateLevel = level;
 }
 
 void ExecutionState::debugStateOff() {
 #if ENABLE_Z3
-  txTreeNode->dependency->debugStateLevel = DebugState;
+  txTreeNode->getDependency()->debugStateLevel = DebugState;
 #else
-  txTreeNode->dependency->debugStateLevel = 0;
+  txTreeNode->getDependency()->debugStateLevel = 0;
 #endif
 }
@@ -37,6 +37,7 @@
 #include "klee/util/TxPrintUtil.h"
 #include "klee/Config/Version.h"
 #include "klee/Internal/ADT/KTest.h"
+#include "klee/Internal/ADT/TxSlabAllocator.h"
 #include "klee/Internal/ADT/RNG.h"
 #include "klee/Internal/Module/Cell.h"
 #include "klee/Internal/Module/InstructionInfoTable.h"
@@ -48,6 +49,7 @@
 #include "klee/Internal/System/MemoryUsage.h"
 #include "klee/SolverStats.h"
 #include "TxShadowArray.h"
+#include "TxInterpolantDatabase.h"
 #include "TxTree.h"
 #include "TxSpeculation.h"
 
@@ -404,6 +406,9 @@ const Module *Executor::setModule(llvm::Module *module,
   kmodule->prepare(opts, interpreterHandler);
   specialFunctionHandler->bind();
 
+  if (INTERPOLATION_ENABLED && SpecTypeToUse != NO_SPEC)
+    TxSpeculationHelper::buildProfiles(module);
+
   if (StatsTracker::useStatistics() || userSearcherRequiresMD2U()) {
     statsTracker = new StatsTracker(
         *this, interpreterHandler->getOutputFilename("assembly.ll"),
@@ -791,10 +796,16 @@ Executor::StatePair Executor::fork(ExecutionState &current, ref<Expr> condition,
   // llvm::errs() << "Calling solver->evaluate on query:\n";
   // ExprPPrinter::printQuery(llvm::errs(), current.constraints, condition);
 
-  solver->setTimeout(timeout);
   std::vector<ref<Expr> > unsatCore;
-  bool success = solver->evaluate(current, condition, res, unsatCore);
-  solver->setTimeout(0);
+  bool success = true;
+  if (!INTERPOLATION_ENABLED ||
+      !txTree->lookupUnsatCore(current, condition, res, unsatCore)) {
+    solver->setTimeout(timeout);
+    success = solver->evaluate(current, condition, res, unsatCore);
+    solver->setTimeout(0);
+    if (success && INTERPOLATION_ENABLED)
+      txTree->storeUnsatCore(current, condition, res, unsatCore);
+  }
 
   if (!success) {
     current.pc = current.prevPC;
@@ -1007,41 +1018,6 @@ Executor::StatePair Executor::fork(ExecutionState &current, ref<Expr> condition,
   }
 }
 
-std::set<std::string> Executor::extractVarNames(ExecutionState &current,
-                                                llvm::Value *v) {
-  std::set<std::string> res;
-  if (isa<GlobalVariable>(v)) {
-    GlobalVariable *gv = cast<GlobalVariable>(v);
-    res.insert(gv->getName().data());
-  } else if (isa<Instruction>(v)) {
-    Instruction *ins = dyn_cast<Instruction>(v);
-    switch (ins->getOpcode()) {
-    case Instruction::Alloca: {
-      AllocaInst *ai = cast<AllocaInst>(ins);
-      if (ai->getName() == "") {
-        llvm::Function *f = ai->getParent()->getParent();
-        if (ai == &f->getEntryBlock().front()) {
-          res.insert(f->arg_begin()->getName().data());
-        } else if (ai == f->getEntryBlock().front().getNextNode()) {
-          res.insert(f->arg_begin()->getNextNode()->getName().data());
-        }
-      } else {
-        res.insert(ai->getName().data());
-      }
-      break;
-    }
-    default: {
-      for (unsigned i = 0u; i < ins->getNumOperands(); i++) {
-        std::set<std::string> tmp =
-            extractVarNames(current, ins->getOperand(i));
-        res.insert(tmp.begin(), tmp.end());
-      }
-    }
-    }
-  }
-  return res;
-}
-
 Executor::StatePair Executor::branchFork(ExecutionState &current,
                                          ref<Expr> condition, bool isInternal) {
   start = clock();
@@ -1095,10 +1071,16 @@ Executor::StatePair Executor::branchFork(ExecutionState &current,
   // llvm::errs() << "Calling solver->evaluate on query:\n";
   // ExprPPrinter::printQuery(llvm::errs(), current.constraints, condition);
 
-  solver->setTimeout(timeout);
   std::vector<ref<Expr> > unsatCore;
-  bool success = solver->evaluate(current, condition, res, unsatCore);
-  solver->setTimeout(0);
+  bool success = true;
+  if (!INTERPOLATION_ENABLED ||
+      !txTree->lookupUnsatCore(current, condition, res, unsatCore)) {
+    solver->setTimeout(timeout);
+    success = solver->evaluate(current, condition, res, unsatCore);
+    solver->setTimeout(0);
+    if (success && INTERPOLATION_ENABLED)
+      txTree->storeUnsatCore(current, condition, res, unsatCore);
+  }
 
   if (!success) {
     current.pc = current.prevPC;
@@ -1218,8 +1200,7 @@ Executor::StatePair Executor::branchFork(ExecutionState &current,
         }
       } else {
         if (SpecStrategyToUse == TIMID) {
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             independenceYes++;
             StatsTracker::increaseEle(curBB, 0, true);
             StatsTracker::increaseEle(curBB, 2, false);
@@ -1230,8 +1211,7 @@ Executor::StatePair Executor::branchFork(ExecutionState &current,
           return StatePair(&current, 0);
         } else if (SpecStrategyToUse == AGGRESSIVE) {
           // check independency
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             // open speculation & assume success
             independenceYes++;
             StatsTracker::increaseEle(curBB, 0, true);
@@ -1246,8 +1226,7 @@ Executor::StatePair Executor::branchFork(ExecutionState &current,
           }
         } else if (SpecStrategyToUse == CUSTOM) {
           // check independency
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             // open speculation & assume success
             independenceYes++;
             //          StatsTracker::increaseEle(curBB, 0, true);
@@ -1306,8 +1285,7 @@ Executor::StatePair Executor::branchFork(ExecutionState &current,
         }
       } else {
         if (SpecStrategyToUse == TIMID) {
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             independenceYes++;
             StatsTracker::increaseEle(curBB, 0, true);
             StatsTracker::increaseEle(curBB, 2, false);
@@ -1317,8 +1295,7 @@ Executor::StatePair Executor::branchFork(ExecutionState &current,
           }
           return StatePair(0, &current);
         } else if (SpecStrategyToUse == AGGRESSIVE) {
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             // open speculation & assume success
             independenceYes++;
             StatsTracker::increaseEle(curBB, 0, true);
@@ -1332,8 +1309,7 @@ Executor::StatePair Executor::branchFork(ExecutionState &current,
                                       false);
           }
         } else if (SpecStrategyToUse == CUSTOM) {
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             // open speculation & assume success
             independenceYes++;
             //          StatsTracker::increaseEle(curBB, 0, true);
@@ -1410,8 +1386,7 @@ Executor::StatePair Executor::branchFork(ExecutionState &current,
         }
       } else {
         if (SpecStrategyToUse == TIMID) {
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             // open speculation & assume success
             independenceYes++;
             StatsTracker::increaseEle(curBB, 0, true);
@@ -1425,8 +1400,7 @@ Executor::StatePair Executor::branchFork(ExecutionState &current,
             return StatePair(&current, 0);
           }
         } else if (SpecStrategyToUse == AGGRESSIVE) {
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             // open speculation & assume success
             independenceYes++;
             StatsTracker::increaseEle(curBB, 0, true);
@@ -1442,8 +1416,7 @@ Executor::StatePair Executor::branchFork(ExecutionState &current,
                                       true);
           }
         } else if (SpecStrategyToUse == CUSTOM) {
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             // open speculation & assume success
             independenceYes++;
             //          StatsTracker::increaseEle(curBB, 0, true);
@@ -1523,8 +1496,7 @@ Executor::StatePair Executor::branchFork(ExecutionState &current,
         }
       } else {
         if (SpecStrategyToUse == TIMID) {
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             // open speculation & assume success
             independenceYes++;
             StatsTracker::increaseEle(curBB, 0, true);
@@ -1538,8 +1510,7 @@ Executor::StatePair Executor::branchFork(ExecutionState &current,
             return StatePair(0, &current);
           }
         } else if (SpecStrategyToUse == AGGRESSIVE) {
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             // open speculation & assume success
             independenceYes++;
             StatsTracker::increaseEle(curBB, 0, true);
@@ -1556,8 +1527,7 @@ Executor::StatePair Executor::branchFork(ExecutionState &current,
           }
         } else if (SpecStrategyToUse == CUSTOM) {
 
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             // open speculation & assume success
             independenceYes++;
             //          StatsTracker::increaseEle(curBB, 0, true);
@@ -1807,10 +1777,16 @@ Executor::StatePair Executor::speculationFork(ExecutionState &current,
   // llvm::errs() << "Calling solver->evaluate on query:\n";
   // ExprPPrinter::printQuery(llvm::errs(), current.constraints, condition);
 
-  solver->setTimeout(timeout);
   std::vector<ref<Expr> > unsatCore;
-  bool success = solver->evaluate(current, condition, res, unsatCore);
-  solver->setTimeout(0);
+  bool success = true;
+  if (!INTERPOLATION_ENABLED ||
+      !txTree->lookupUnsatCore(current, condition, res, unsatCore)) {
+    solver->setTimeout(timeout);
+    success = solver->evaluate(current, condition, res, unsatCore);
+    solver->setTimeout(0);
+    if (success && INTERPOLATION_ENABLED)
+      txTree->storeUnsatCore(current, condition, res, unsatCore);
+  }
 
   if (!success) {
     current.pc = current.prevPC;
@@ -1855,8 +1831,7 @@ Executor::StatePair Executor::speculationFork(ExecutionState &current,
                                     true);
         } else if (SpecStrategyToUse == CUSTOM) {
 
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             // open speculation & assume success
             //          independenceYes++;
             return StatePair(&current, 0);
@@ -1910,8 +1885,7 @@ Executor::StatePair Executor::speculationFork(ExecutionState &current,
           return addSpeculationNode(current, condition, binst, isInternal,
                                     false);
         } else if (SpecStrategyToUse == CUSTOM) {
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             // open speculation & assume success
             //          independenceYes++;
             return StatePair(0, &current);
@@ -1980,8 +1954,7 @@ Executor::StatePair Executor::speculationFork(ExecutionState &current,
           return addSpeculationNode(current, condition, binst, isInternal,
                                     true);
         } else if (SpecStrategyToUse == CUSTOM) {
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             // open speculation & assume success
             //          independenceYes++;
             return StatePair(&current, 0);
@@ -2058,8 +2031,7 @@ Executor::StatePair Executor::speculationFork(ExecutionState &current,
           return addSpeculationNode(current, condition, binst, isInternal,
                                     false);
         } else if (SpecStrategyToUse == CUSTOM) {
-          std::set<std::string> vars = extractVarNames(current, binst);
-          if (TxSpeculationHelper::isIndependent(vars, bbOrderToSpecAvoid)) {
+          if (TxSpeculationHelper::isIndependent(binst)) {
             // open speculation & assume success
             //          independenceYes++;
             return StatePair(0, &current);
@@ -4290,6 +4262,15 @@ void Executor::bindModuleConstants() {
   }
 }
 
+/// The heap usage in MB, not counting the free slots of the slab allocators of
+/// the interpolation tree, which are reused before the heap grows again
+static unsigned getHeapUsage() {
+  uint64_t used = util::GetTotalMallocUsage();
+  uint64_t slabFree = TxSlabAllocatorBase::getTotalFreeBytes();
+  // The malloc statistics may be unavailable, or wrap around
+  return used > slabFree ? (used - slabFree) >> 20 : used >> 20;
+}
+
 void Executor::checkMemoryUsage() {
   if (!MaxMemory)
     return;
@@ -4297,8 +4278,22 @@ void Executor::checkMemoryUsage() {
     // We need to avoid calling GetTotalMallocUsage() often because it
     // is O(elts on freelist). This is really bad since we start
     // to pummel the freelist once we hit the memory cap.
-    unsigned mbs = (util::GetTotalMallocUsage() >> 20) +
-                   (memory->getUsedDeterministicSize() >> 20);
+    unsigned mbs =
+        getHeapUsage() + (memory->getUsedDeterministicSize() >> 20);
+
+    if (mbs > MaxMemory && INTERPOLATION_ENABLED) {
+      // A state terminated early prevents all of its ancestors in the
+      // interpolation tree from being tabled, hence we first release the
+      // table entries that never subsumed, and then the caches of the
+      // interpolation, which are recomputed on demand.
+      uint64_t excess = (uint64_t)(mbs - MaxMemory) << 20;
+      if (TxSubsumptionTable::evictUnused(excess) < excess) {
+        TxShadowArray::clearCache();
+        Z3Simplification::clear();
+        txTree->clearUnsatCoreCache();
+      }
+      mbs = getHeapUsage() + (memory->getUsedDeterministicSize() >> 20);
+    }
 
     if (mbs > MaxMemory) {
       if (mbs > MaxMemory + 100) {
@@ -4307,15 +4302,30 @@ void Executor::checkMemoryUsage() {
         unsigned toKill = std::max(1U, numStates - numStates * MaxMemory / mbs);
         klee_warning("killing %d states (over memory cap)", toKill);
         std::vector<ExecutionState *> arr(states.begin(), states.end());
-        for (unsigned i = 0, N = arr.size(); N && i < toKill; ++i, --N) {
-          unsigned idx = rand() % N;
-          // Make two pulls to try and not hit a state that
-          // covered new code.
-          if (arr[idx]->coveredNew)
-            idx = rand() % N;
-
-          std::swap(arr[idx], arr[N - 1]);
-          terminateStateEarly(*arr[N - 1], "Memory limit exceeded.");
+        if (INTERPOLATION_ENABLED) {
+          // Kill the states which prevent the fewest interpolants from being
+          // tabled, preferring those that did not cover new code.
+          std::vector<std::pair<std::pair<unsigned, bool>, unsigned> > costs;
+          for (unsigned i = 0, N = arr.size(); i < N; ++i) {
+            costs.push_back(std::make_pair(
+                std::make_pair(arr[i]->txTreeNode->getPendingInterpolantCount(),
+                               arr[i]->coveredNew),
+                i));
+          }
+          std::sort(costs.begin(), costs.end());
+          for (unsigned i = 0, N = costs.size(); i < N && i < toKill; ++i)
+            terminateStateEarly(*arr[costs[i].second], "Memory limit exceeded.");
+        } else {
+          for (unsigned i = 0, N = arr.size(); N && i < toKill; ++i, --N) {
+            unsigned idx = rand() % N;
+            // Make two pulls to try and not hit a state that
+            // covered new code.
+            if (arr[idx]->coveredNew)
+              idx = rand() % N;
+
+            std::swap(arr[idx], arr[N - 1]);
+            terminateStateEarly(*arr[N - 1], "Memory limit exceeded.");
+          }
         }
       }
       atMemoryLimit = true;
@@ -4416,9 +4426,27 @@ void Executor::run(ExecutionState &initialState) {
          it != ie; ++it) {
       it->second = 0;
     }
-    // load avoid BB
-    bbOrderToSpecAvoid = readBBOrderToSpecAvoid(DependencyFolder);
-    visitedBlocks = readVisitedBB(DependencyFolder + "/InitialVisitedBB.txt");
+    // load avoid BB, either from the dependency files, or as computed
+    // when preparing the module
+    TxSpeculationHelper::clearAvoidance();
+    if (DependencyFolder.getNumOccurrences()) {
+      bbOrderToSpecAvoid = readBBOrderToSpecAvoid(DependencyFolder);
+      for (std::map<int, std::set<std::string> >::iterator
+               it = bbOrderToSpecAvoid.begin(),
+               ie = bbOrderToSpecAvoid.end();
+           it != ie; ++it) {
+        TxSpeculationHelper::addAvoidance(it->second);
+      }
+      visitedBlocks =
+          readVisitedBB(DependencyFolder + "/InitialVisitedBB.txt");
+    } else {
+      for (std::map<llvm::BasicBlock *, std::set<std::string> >::iterator
+               it = kmodule->specDependencies.begin(),
+               ie = kmodule->specDependencies.end();
+           it != ie; ++it) {
+        TxSpeculationHelper::addAvoidance(it->second);
+      }
+    }
   }
 
   startingBBPlottingTime = time(0);
@@ -4476,6 +4504,32 @@ void Executor::run(ExecutionState &initialState) {
     }
   }
 
+  // Write the dependency sets computed from the module, in the format of the
+  // dependency files
+  if (INTERPOLATION_ENABLED && SpecTypeToUse != NO_SPEC && WriteSpecAvoid &&
+      !DependencyFolder.getNumOccurrences()) {
+    for (std::map<llvm::BasicBlock *, std::set<std::string> >::iterator
+             it = kmodule->specDependencies.begin(),
+             ie = kmodule->specDependencies.end();
+         it != ie; ++it) {
+      std::map<llvm::Function *, std::map<llvm::BasicBlock *, int> >::iterator
+          fit = fBBOrder.find(it->first->getParent());
+      if (fit == fBBOrder.end())
+        continue;
+      int order = fit->second[it->first];
+      std::ostringstream fileName;
+      fileName << "SpecAvoid_" << order << ".txt";
+      std::ofstream out(
+          interpreterHandler->getOutputFilename(fileName.str()).c_str());
+      out << order << "\n";
+      for (std::set<std::string>::iterator vit = it->second.begin(),
+                                           vie = it->second.end();
+           vit != vie; ++vit) {
+        out << *vit << "\n";
+      }
+    }
+  }
+
   // first BB of main()
   KInstruction *ki = initialState.pc;
   BasicBlock *firstBB = ki->inst->getParent();
@@ -5574,7 +5628,13 @@ void Executor::runFunctionAsMain(Function *f, int argc, char **argv,
   if (INTERPOLATION_ENABLED) {
     txTree = new TxTree(state, kmodule->targetData, &globalAddresses);
     state->txTreeNode = txTree->root;
-    TxTreeGraph::initialize(txTree->root);
+    TxTreeGraph::initialize(txTree->root,
+                            interpreterHandler->getOutputFilename("tree.log"));
+#ifdef ENABLE_Z3
+    if (!LoadInterpolants.empty())
+      TxInterpolantDatabase::load(LoadInterpolants, kmodule->module,
+                                  arrayCache);
+#endif
   }
 
   run(*state);
@@ -5585,8 +5645,18 @@ void Executor::runFunctionAsMain(Function *f, int argc, char **argv,
     TxTreeGraph::save(interpreterHandler->getOutputFilename("tree.dot"));
     TxTreeGraph::deallocate();
 
+#ifdef ENABLE_Z3
+    if (SaveInterpolants)
+      TxInterpolantDatabase::save(
+          interpreterHandler->getOutputFilename("interpolants.txdb"),
+          kmodule->module);
+#endif
+
     delete txTree;
     txTree = 0;
+    TxInterpolantDatabase::deallocate();
+    TxShadowArray::clearCache();
+    Z3Simplification::clear();
 
 #ifdef ENABLE_Z3
     // Print interpolation time statistics
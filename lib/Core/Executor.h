@@ -361,9 +361,6 @@ private:
   StatePair branchFork(ExecutionState &current, ref<Expr> condition,
                        bool isInternal);
 
-  std::set<std::string> extractVarNames(ExecutionState &current,
-                                        llvm::Value *v);
-
   // Generally the nodes are in normal mode. In case an infeasible path
   // is found, an speculation node is generated for the infeasible path
   // excluding the last constraint and the execution of the speculation
@@ -10,10 +10,10 @@
 #include "Memory.h"
 
 #include "Context.h"
+#include "CoreStats.h"
 #include "klee/CommandLine.h"
 #include "klee/Expr.h"
 #include "klee/Solver.h"
-#include "klee/util/BitArray.h"
 #include "klee/Internal/Support/ErrorHandling.h"
 #include "klee/util/ArrayCache.h"
 
@@ -44,6 +44,14 @@ namespace {
   cl::opt<bool>
   UseConstantArrays("use-constant-arrays",
                     cl::init(true));
+
+  cl::opt<unsigned>
+  ObjectChunkSize("object-chunk-size",
+                  cl::desc("Size in bytes of the chunks of the object "
+                           "contents, which are shared between states and "
+                           "copied only when written, rounded up to a power "
+                           "of two (default=4096)"),
+                  cl::init(4096));
 }
 
 /***/
@@ -100,11 +108,22 @@ void MemoryObject::getAllocInfo(std::string &result) const {
 
 /***/
 
+unsigned ObjectState::getChunkShift() {
+  static unsigned chunkShift = 0;
+  static bool initialized = false;
+  if (!initialized) {
+    while (chunkShift < 30 && (1u << chunkShift) < ObjectChunkSize)
+      ++chunkShift;
+    initialized = true;
+  }
+  return chunkShift;
+}
+
 ObjectState::ObjectState(const MemoryObject *mo)
   : copyOnWriteOwner(0),
     refCount(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
+    concreteStore(mo->size, getChunkShift(), 0),
     concreteMask(0),
     flushMask(0),
     knownSymbolics(0),
@@ -127,7 +146,6 @@ ObjectState::ObjectState(const MemoryObject *mo)
       TxShadowArray::addShadowArrayMap(array, shadow);
     }
   }
-  memset(concreteStore, 0, size);
 }
 
 
@@ -135,7 +153,7 @@ ObjectState::ObjectState(const MemoryObject *mo, const Array *array)
   : copyOnWriteOwner(0),
     refCount(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
+    concreteStore(mo->size, getChunkShift(), 0),
     concreteMask(0),
     flushMask(0),
     knownSymbolics(0),
@@ -144,38 +162,31 @@ ObjectState::ObjectState(const MemoryObject *mo, const Array *array)
     readOnly(false) {
   mo->refCount++;
   makeSymbolic();
-  memset(concreteStore, 0, size);
 }
 
 ObjectState::ObjectState(const ObjectState &os) 
   : copyOnWriteOwner(0),
     refCount(0),
     object(os.object),
-    concreteStore(new uint8_t[os.size]),
-    concreteMask(os.concreteMask ? new BitArray(*os.concreteMask, os.size) : 0),
-    flushMask(os.flushMask ? new BitArray(*os.flushMask, os.size) : 0),
-    knownSymbolics(0),
+    concreteStore(os.concreteStore),
+    concreteMask(os.concreteMask ? new CopyOnWriteBitArray(*os.concreteMask)
+                                 : 0),
+    flushMask(os.flushMask ? new CopyOnWriteBitArray(*os.flushMask) : 0),
+    knownSymbolics(os.knownSymbolics
+                       ? new CopyOnWriteArray<ref<Expr> >(*os.knownSymbolics)
+                       : 0),
     updates(os.updates),
     size(os.size),
     readOnly(false) {
   assert(!os.readOnly && "no need to copy read only object?");
   if (object)
     object->refCount++;
-
-  if (os.knownSymbolics) {
-    knownSymbolics = new ref<Expr>[size];
-    for (unsigned i=0; i<size; i++)
-      knownSymbolics[i] = os.knownSymbolics[i];
-  }
-
-  memcpy(concreteStore, os.concreteStore, size*sizeof(*concreteStore));
 }
 
 ObjectState::~ObjectState() {
   if (concreteMask) delete concreteMask;
   if (flushMask) delete flushMask;
-  if (knownSymbolics) delete[] knownSymbolics;
-  delete[] concreteStore;
+  if (knownSymbolics) delete knownSymbolics;
 
   if (object)
   {
@@ -258,7 +269,7 @@ const UpdateList &ObjectState::getUpdates() const {
 void ObjectState::makeConcrete() {
   if (concreteMask) delete concreteMask;
   if (flushMask) delete flushMask;
-  if (knownSymbolics) delete[] knownSymbolics;
+  if (knownSymbolics) delete knownSymbolics;
   concreteMask = 0;
   flushMask = 0;
   knownSymbolics = 0;
@@ -278,15 +289,13 @@ void ObjectState::makeSymbolic() {
 
 void ObjectState::initializeToZero() {
   makeConcrete();
-  memset(concreteStore, 0, size);
+  concreteStore.fill(0);
 }
 
 void ObjectState::initializeToRandom() {  
   makeConcrete();
-  for (unsigned i=0; i<size; i++) {
-    // randomly selected by 256 sided die
-    concreteStore[i] = 0xAB;
-  }
+  // randomly selected by 256 sided die
+  concreteStore.fill(0xAB);
 }
 
 /*
@@ -306,7 +315,8 @@ void ObjectState::fastRangeCheckOffset(ref<Expr> offset,
 
 void ObjectState::flushRangeForRead(unsigned rangeBase, 
                                     unsigned rangeSize) const {
-  if (!flushMask) flushMask = new BitArray(size, true);
+  if (!flushMask)
+    flushMask = new CopyOnWriteBitArray(size, getChunkShift(), true);
  
   for (unsigned offset=rangeBase; offset<rangeBase+rangeSize; offset++) {
     if (!isByteFlushed(offset)) {
@@ -316,7 +326,7 @@ void ObjectState::flushRangeForRead(unsigned rangeBase,
       } else {
         assert(isByteKnownSymbolic(offset) && "invalid bit set in flushMask");
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       knownSymbolics[offset]);
+                       (*knownSymbolics)[offset]);
       }
 
       flushMask->unset(offset);
@@ -326,7 +336,8 @@ void ObjectState::flushRangeForRead(unsigned rangeBase,
 
 void ObjectState::flushRangeForWrite(unsigned rangeBase, 
                                      unsigned rangeSize) {
-  if (!flushMask) flushMask = new BitArray(size, true);
+  if (!flushMask)
+    flushMask = new CopyOnWriteBitArray(size, getChunkShift(), true);
 
   for (unsigned offset=rangeBase; offset<rangeBase+rangeSize; offset++) {
     if (!isByteFlushed(offset)) {
@@ -337,7 +348,7 @@ void ObjectState::flushRangeForWrite(unsigned rangeBase,
       } else {
         assert(isByteKnownSymbolic(offset) && "invalid bit set in flushMask");
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       knownSymbolics[offset]);
+                       (*knownSymbolics)[offset]);
         setKnownSymbolic(offset, 0);
       }
 
@@ -363,7 +374,7 @@ bool ObjectState::isByteFlushed(unsigned offset) const {
 }
 
 bool ObjectState::isByteKnownSymbolic(unsigned offset) const {
-  return knownSymbolics && knownSymbolics[offset].get();
+  return knownSymbolics && (*knownSymbolics)[offset].get();
 }
 
 void ObjectState::markByteConcrete(unsigned offset) {
@@ -373,7 +384,7 @@ void ObjectState::markByteConcrete(unsigned offset) {
 
 void ObjectState::markByteSymbolic(unsigned offset) {
   if (!concreteMask)
-    concreteMask = new BitArray(size, true);
+    concreteMask = new CopyOnWriteBitArray(size, getChunkShift(), true);
   concreteMask->unset(offset);
 }
 
@@ -384,7 +395,7 @@ void ObjectState::markByteUnflushed(unsigned offset) {
 
 void ObjectState::markByteFlushed(unsigned offset) {
   if (!flushMask) {
-    flushMask = new BitArray(size, false);
+    flushMask = new CopyOnWriteBitArray(size, getChunkShift(), false);
   } else {
     flushMask->unset(offset);
   }
@@ -393,11 +404,14 @@ void ObjectState::markByteFlushed(unsigned offset) {
 void ObjectState::setKnownSymbolic(unsigned offset, 
                                    Expr *value /* can be null */) {
   if (knownSymbolics) {
-    knownSymbolics[offset] = value;
+    // Clearing a byte that is not known symbolic does not copy its chunk
+    if (value || (*knownSymbolics)[offset].get())
+      knownSymbolics->at(offset) = value;
   } else {
     if (value) {
-      knownSymbolics = new ref<Expr>[size];
-      knownSymbolics[offset] = value;
+      knownSymbolics =
+          new CopyOnWriteArray<ref<Expr> >(size, getChunkShift(), ref<Expr>());
+      knownSymbolics->at(offset) = value;
     }
   }
 }
@@ -408,7 +422,7 @@ ref<Expr> ObjectState::read8(unsigned offset) const {
   if (isByteConcrete(offset)) {
     return ConstantExpr::create(concreteStore[offset], Expr::Int8);
   } else if (isByteKnownSymbolic(offset)) {
-    return knownSymbolics[offset];
+    return (*knownSymbolics)[offset];
   } else {
     assert(isByteFlushed(offset) && "unflushed byte without cache value");
     
@@ -419,6 +433,11 @@ ref<Expr> ObjectState::read8(unsigned offset) const {
 
 ref<Expr> ObjectState::read8(ref<Expr> offset) const {
   assert(!isa<ConstantExpr>(offset) && "constant offset passed to symbolic read8");
+  flushForSymbolicRead(offset);
+  return ReadExpr::create(getUpdates(), ZExtExpr::create(offset, Expr::Int32));
+}
+
+void ObjectState::flushForSymbolicRead(ref<Expr> offset) const {
   unsigned base, size;
   fastRangeCheckOffset(offset, &base, &size);
   flushRangeForRead(base, size);
@@ -430,13 +449,13 @@ ref<Expr> ObjectState::read8(ref<Expr> offset) const {
                       size,
                       allocInfo.c_str());
   }
-  
-  return ReadExpr::create(getUpdates(), ZExtExpr::create(offset, Expr::Int32));
 }
 
 void ObjectState::write8(unsigned offset, uint8_t value) {
   //assert(read_only == false && "writing to read-only object!");
-  concreteStore[offset] = value;
+  // An unchanged byte is not written, so as not to copy its chunk
+  if (concreteStore[offset] != value)
+    concreteStore.at(offset) = value;
   setKnownSymbolic(offset, 0);
 
   markByteConcrete(offset);
@@ -457,6 +476,11 @@ void ObjectState::write8(unsigned offset, ref<Expr> value) {
 
 void ObjectState::write8(ref<Expr> offset, ref<Expr> value) {
   assert(!isa<ConstantExpr>(offset) && "constant offset passed to symbolic write8");
+  flushForSymbolicWrite(offset);
+  updates.extend(ZExtExpr::create(offset, Expr::Int32), value);
+}
+
+void ObjectState::flushForSymbolicWrite(ref<Expr> offset) {
   unsigned base, size;
   fastRangeCheckOffset(offset, &base, &size);
   flushRangeForWrite(base, size);
@@ -468,8 +492,6 @@ void ObjectState::write8(ref<Expr> offset, ref<Expr> value) {
                       size,
                       allocInfo.c_str());
   }
-  
-  updates.extend(ZExtExpr::create(offset, Expr::Int32), value);
 }
 
 /***/
@@ -486,15 +508,18 @@ ref<Expr> ObjectState::read(ref<Expr> offset, Expr::Width width) const {
   if (width == Expr::Bool)
     return ExtractExpr::create(read8(offset), 0, Expr::Bool);
 
-  // Otherwise, follow the slow general case.
+  // Otherwise, read the bytes of the updates, flushing the object only once
+  // for the whole word.
   unsigned NumBytes = width / 8;
   assert(width == NumBytes * 8 && "Invalid read size!");
+  ++stats::symbolicWordAccesses;
+  flushForSymbolicRead(offset);
+  const UpdateList &ul = getUpdates();
   ref<Expr> Res(0);
   for (unsigned i = 0; i != NumBytes; ++i) {
     unsigned idx = Context::get().isLittleEndian() ? i : (NumBytes - i - 1);
-    ref<Expr> Byte = read8(AddExpr::create(offset, 
-                                           ConstantExpr::create(idx, 
-                                                                Expr::Int32)));
+    ref<Expr> Byte = ReadExpr::create(
+        ul, AddExpr::create(offset, ConstantExpr::create(idx, Expr::Int32)));
     Res = i ? ConcatExpr::create(Byte, Res) : Byte;
   }
 
@@ -506,9 +531,32 @@ ref<Expr> ObjectState::read(unsigned offset, Expr::Width width) const {
   if (width == Expr::Bool)
     return ExtractExpr::create(read8(offset), 0, Expr::Bool);
 
-  // Otherwise, follow the slow general case.
   unsigned NumBytes = width / 8;
   assert(width == NumBytes * 8 && "Invalid width for read size!");
+
+  // A word of concrete bytes is assembled directly into a constant.
+  bool Concrete = NumBytes <= 8;
+  for (unsigned i = 0; Concrete && i != NumBytes; ++i)
+    Concrete = isByteConcrete(offset + i);
+  if (Concrete) {
+    uint64_t Value = 0;
+    for (unsigned i = 0; i != NumBytes; ++i) {
+      unsigned idx = Context::get().isLittleEndian() ? i : (NumBytes - i - 1);
+      Value |= (uint64_t) concreteStore[offset + idx] << (8 * i);
+    }
+    ++stats::wordReads;
+    return ConstantExpr::create(Value, width);
+  }
+
+  // A word last written as a whole holds the extracts of the written
+  // expression, which is returned instead of the concatenation of its bytes.
+  ref<Expr> Word = readKnownSymbolicWord(offset, width);
+  if (!Word.isNull()) {
+    ++stats::wordReads;
+    return Word;
+  }
+
+  // Otherwise, follow the slow general case.
   ref<Expr> Res(0);
   for (unsigned i = 0; i != NumBytes; ++i) {
     unsigned idx = Context::get().isLittleEndian() ? i : (NumBytes - i - 1);
@@ -519,6 +567,29 @@ ref<Expr> ObjectState::read(unsigned offset, Expr::Width width) const {
   return Res;
 }
 
+ref<Expr> ObjectState::readKnownSymbolicWord(unsigned offset,
+                                             Expr::Width width) const {
+  unsigned NumBytes = width / 8;
+  ref<Expr> Word(0);
+  for (unsigned i = 0; i != NumBytes; ++i) {
+    unsigned idx = Context::get().isLittleEndian() ? i : (NumBytes - i - 1);
+    if (!isByteKnownSymbolic(offset + idx))
+      return 0;
+    const ExtractExpr *Byte =
+        dyn_cast<ExtractExpr>((*knownSymbolics)[offset + idx]);
+    if (!Byte || Byte->offset != 8 * i)
+      return 0;
+    if (!i) {
+      Word = Byte->expr;
+      if (Word->getWidth() != width)
+        return 0;
+    } else if (Byte->expr != Word) {
+      return 0;
+    }
+  }
+  return Word;
+}
+
 void ObjectState::write(ref<Expr> offset, ref<Expr> value) {
   // Truncate offset to 32-bits.
   offset = ZExtExpr::create(offset, Expr::Int32);
@@ -536,13 +607,17 @@ void ObjectState::write(ref<Expr> offset, ref<Expr> value) {
     return;
   }
 
-  // Otherwise, follow the slow general case.
+  // Otherwise, flush the object only once for the whole word, and add the
+  // updates of its bytes.
   unsigned NumBytes = w / 8;
   assert(w == NumBytes * 8 && "Invalid write size!");
+  ++stats::symbolicWordAccesses;
+  flushForSymbolicWrite(offset);
   for (unsigned i = 0; i != NumBytes; ++i) {
     unsigned idx = Context::get().isLittleEndian() ? i : (NumBytes - i - 1);
-    write8(AddExpr::create(offset, ConstantExpr::create(idx, Expr::Int32)),
-           ExtractExpr::create(value, 8 * i, Expr::Int8));
+    updates.extend(
+        AddExpr::create(offset, ConstantExpr::create(idx, Expr::Int32)),
+        ExtractExpr::create(value, 8 * i, Expr::Int8));
   }
 }
 
@@ -11,6 +11,7 @@
 #define KLEE_MEMORY_H
 
 #include "Context.h"
+#include "CopyOnWriteArray.h"
 #include "klee/Expr.h"
 
 #include "llvm/ADT/StringExtras.h"
@@ -24,7 +25,6 @@ namespace llvm {
 
 namespace klee {
 
-class BitArray;
 class MemoryManager;
 class Solver;
 class ArrayCache;
@@ -156,14 +156,16 @@ private:
 
   const MemoryObject *object;
 
-  uint8_t *concreteStore;
+  // The contents are in chunks of -object-chunk-size bytes, which are shared
+  // with the copies of this object state and copied only when written.
+  CopyOnWriteArray<uint8_t> concreteStore;
   // XXX cleanup name of flushMask (its backwards or something)
-  BitArray *concreteMask;
+  CopyOnWriteBitArray *concreteMask;
 
   // mutable because may need flushed during read of const
-  mutable BitArray *flushMask;
+  mutable CopyOnWriteBitArray *flushMask;
 
-  ref<Expr> *knownSymbolics;
+  CopyOnWriteArray<ref<Expr> > *knownSymbolics;
 
   // mutable because we may need flush during read of const
   mutable UpdateList updates;
@@ -195,6 +197,9 @@ public:
   // make contents all concrete and random
   void initializeToRandom();
 
+  // Multi-byte reads are expressions over byte reads: a concatenation of a
+  // ReadExpr per byte, except for words of concrete bytes or of the bytes of
+  // one known expression. There is no word-level read expression.
   ref<Expr> read(ref<Expr> offset, Expr::Width width) const;
   ref<Expr> read(unsigned offset, Expr::Width width) const;
   ref<Expr> read8(unsigned offset) const;
@@ -209,6 +214,9 @@ public:
   void write64(unsigned offset, uint64_t value);
 
 private:
+  /// The log2 of -object-chunk-size
+  static unsigned getChunkShift();
+
   const UpdateList &getUpdates() const;
 
   void makeConcrete();
@@ -216,6 +224,11 @@ private:
   void makeSymbolic();
 
   ref<Expr> read8(ref<Expr> offset) const;
+
+  /// Read the word at the offset as the expression of which its bytes are the
+  /// extracts, or return null if they are not
+  ref<Expr> readKnownSymbolicWord(unsigned offset, Expr::Width width) const;
+
   void write8(unsigned offset, ref<Expr> value);
   void write8(ref<Expr> offset, ref<Expr> value);
 
@@ -224,6 +237,11 @@ private:
   void flushRangeForRead(unsigned rangeBase, unsigned rangeSize) const;
   void flushRangeForWrite(unsigned rangeBase, unsigned rangeSize);
 
+  /// Flush the bytes that a read or a write at the symbolic offset may
+  /// access into the updates
+  void flushForSymbolicRead(ref<Expr> offset) const;
+  void flushForSymbolicWrite(ref<Expr> offset);
+
   bool isByteConcrete(unsigned offset) const;
   bool isByteFlushed(unsigned offset) const;
   bool isByteKnownSymbolic(unsigned offset) const;
@@ -13,7 +13,9 @@
 #include "Executor.h"
 #include "PTree.h"
 #include "StatsTracker.h"
+#include "TxTree.h"
 
+#include "klee/CommandLine.h"
 #include "klee/ExecutionState.h"
 #include "klee/Statistics.h"
 #include "klee/Internal/Module/InstructionInfoTable.h"
@@ -41,6 +43,7 @@
 #include "llvm/IR/CallSite.h"
 #endif
 
+#include <algorithm>
 #include <cassert>
 #include <fstream>
 #include <climits>
@@ -97,6 +100,163 @@ void DFSSearcher::update(ExecutionState *current,
 
 ///
 
+unsigned InterpolationSearcher::closingDepth(ExecutionState *state) {
+  unsigned depth = 0;
+  TxTreeNode *node = state->txTreeNode;
+  for (TxTreeNode *parent = node->getParent(); parent;
+       node = parent, parent = parent->getParent()) {
+    // The sibling is removed from the tree once its subtree is fully explored
+    TxTreeNode *sibling =
+        (parent->getLeft() == node) ? parent->getRight() : parent->getLeft();
+    if (sibling)
+      break;
+    ++depth;
+  }
+  return depth;
+}
+
+bool InterpolationSearcher::Priority::operator<(const Priority &p) const {
+  if (inTree != p.inTree)
+    return inTree;
+  if (tabled != p.tabled)
+    return tabled;
+  if (depth != p.depth)
+    return depth > p.depth;
+  return order > p.order;
+}
+
+void InterpolationSearcher::erase(ExecutionState *state) {
+  std::map<ExecutionState *, Priority>::iterator it = priorities.find(state);
+  if (it == priorities.end())
+    return;
+
+  const Priority &priority = it->second;
+  queue.erase(priority);
+  std::map<TxTreeNode *, ExecutionState *>::iterator nit =
+      stateOfNode.find(priority.node);
+  if (nit != stateOfNode.end() && nit->second == state)
+    stateOfNode.erase(nit);
+  std::map<uintptr_t, std::set<ExecutionState *> >::iterator pit =
+      statesAt.find(priority.programPoint);
+  if (pit != statesAt.end()) {
+    pit->second.erase(state);
+    if (pit->second.empty())
+      statesAt.erase(pit);
+  }
+}
+
+void InterpolationSearcher::refresh(ExecutionState *state) {
+  Priority priority = priorities[state];
+  erase(state);
+
+  priority.state = state;
+  priority.node = state->txTreeNode;
+  priority.inTree = INTERPOLATION_ENABLED && priority.node;
+  priority.programPoint = reinterpret_cast<uintptr_t>(state->pc->inst);
+  priority.tabled = false;
+  priority.depth = 0;
+  if (priority.inTree) {
+    priority.tabled = TxSubsumptionTable::hasEntries(
+        priority.programPoint, priority.node->entryCallHistory);
+    priority.depth = closingDepth(state);
+    stateOfNode[priority.node] = state;
+    statesAt[priority.programPoint].insert(state);
+  }
+
+  priorities[state] = priority;
+  queue.insert(priority);
+}
+
+void InterpolationSearcher::markRemoval(TxTreeNode *node) {
+  // The node and its ancestors without another subtree are completed, and
+  // their program points get table entries
+  TxTreeNode *parent = node->getParent();
+  for (;; node = parent, parent = parent->getParent()) {
+    std::map<uintptr_t, std::set<ExecutionState *> >::iterator pit =
+        statesAt.find(node->getProgramPoint());
+    if (pit != statesAt.end())
+      stale.insert(pit->second.begin(), pit->second.end());
+    if (!parent)
+      return;
+    if ((parent->getLeft() == node) ? parent->getRight() : parent->getLeft())
+      break;
+  }
+
+  // The closing depth only changes for the leaf of the other subtree when
+  // the subtree is a single path, as the leaves of a subtree which branches
+  // have their closing depth bounded within it.
+  TxTreeNode *other =
+      (parent->getLeft() == node) ? parent->getRight() : parent->getLeft();
+  while (!other->getLeft() != !other->getRight())
+    other = other->getLeft() ? other->getLeft() : other->getRight();
+  if (other->getLeft())
+    return;
+
+  std::map<TxTreeNode *, ExecutionState *>::iterator nit =
+      stateOfNode.find(other);
+  if (nit != stateOfNode.end())
+    stale.insert(nit->second);
+}
+
+ExecutionState &InterpolationSearcher::selectState() {
+  for (std::set<ExecutionState *>::iterator it = stale.begin(),
+                                            ie = stale.end();
+       it != ie; ++it) {
+    refresh(*it);
+  }
+  stale.clear();
+  return *queue.begin()->state;
+}
+
+void InterpolationSearcher::update(
+    ExecutionState *current, const std::vector<ExecutionState *> &addedStates,
+    const std::vector<ExecutionState *> &removedStates) {
+  for (std::vector<ExecutionState *>::const_iterator it = addedStates.begin(),
+                                                     ie = addedStates.end();
+       it != ie; ++it) {
+    priorities[*it].order = nextOrder++;
+    stale.insert(*it);
+  }
+
+  // The removed states are still in the interpolation tree
+  for (std::vector<ExecutionState *>::const_iterator it = removedStates.begin(),
+                                                     ie = removedStates.end();
+       it != ie; ++it) {
+    ExecutionState *es = *it;
+    assert(priorities.find(es) != priorities.end() && "invalid state removed");
+    erase(es);
+    priorities.erase(es);
+    stale.erase(es);
+    if (INTERPOLATION_ENABLED && es->txTreeNode && removedStates.size() == 1)
+      markRemoval(es->txTreeNode);
+  }
+
+  // The completion of the tree by several removals at once is not followed
+  if (removedStates.size() > 1) {
+    for (std::map<ExecutionState *, Priority>::iterator
+             it = priorities.begin(),
+             ie = priorities.end();
+         it != ie; ++it) {
+      stale.insert(it->first);
+    }
+  }
+
+  if (current && priorities.find(current) != priorities.end())
+    stale.insert(current);
+}
+
+std::vector<ExecutionState *> InterpolationSearcher::getStates() {
+  std::vector<ExecutionState *> states;
+  for (std::map<ExecutionState *, Priority>::iterator it = priorities.begin(),
+                                                      ie = priorities.end();
+       it != ie; ++it) {
+    states.push_back(it->first);
+  }
+  return states;
+}
+
+///
+
 ExecutionState &BFSSearcher::selectState() {
   return *states.front();
 }
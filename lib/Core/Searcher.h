@@ -15,6 +15,7 @@
 #include <set>
 #include <map>
 #include <queue>
+#include <stdint.h>
 
 namespace llvm {
   class BasicBlock;
@@ -27,6 +28,7 @@ namespace klee {
   template<class T> class DiscretePDF;
   class ExecutionState;
   class Executor;
+  class TxTreeNode;
 
   class Searcher {
   public:
@@ -80,7 +82,8 @@ namespace klee {
       NURS_Depth,
       NURS_ICnt,
       NURS_CPICnt,
-      NURS_QC
+      NURS_QC,
+      Interpolation
     };
   };
 
@@ -100,6 +103,80 @@ namespace klee {
     virtual std::vector<ExecutionState *> getStates() { return states; }
   };
 
+  /// \brief A depth-first searcher which prefers the states whose termination
+  /// gets interpolants tabled soonest.
+  ///
+  /// A state at a program point which already has subsumption table entries is
+  /// selected first, since it may be subsumed right away. Otherwise, the state
+  /// which closes the most subtrees of the interpolation tree is selected: a
+  /// state whose ancestors have their other subtree already fully explored
+  /// completes all of them when it terminates, and each completed subtree
+  /// stores an entry into the table. Ties are broken by selecting the most
+  /// recently added state, as in DFSSearcher.
+  ///
+  /// The states are kept ordered by their priority, which is only recomputed
+  /// for the states it may have changed for: the current and added states,
+  /// the states at the program points tabled by the termination of a removed
+  /// state, and the state whose ancestors are completed by it.
+  class InterpolationSearcher : public Searcher {
+    struct Priority {
+      /// \brief Whether the state has an interpolation tree node
+      bool inTree;
+      /// \brief Whether the state is at a program point with table entries
+      bool tabled;
+      unsigned depth;
+      /// \brief The order of addition of the state, for breaking ties
+      uint64_t order;
+      /// \brief The node and program point the priority was computed at
+      TxTreeNode *node;
+      uintptr_t programPoint;
+      ExecutionState *state;
+
+      /// \brief Orders the higher priority first
+      bool operator<(const Priority &p) const;
+    };
+
+    std::set<Priority> queue;
+
+    std::map<ExecutionState *, Priority> priorities;
+
+    /// \brief The states whose priority is to be recomputed before the next
+    /// selection
+    std::set<ExecutionState *> stale;
+
+    /// \brief The states by the node and program point of their priority
+    std::map<TxTreeNode *, ExecutionState *> stateOfNode;
+    std::map<uintptr_t, std::set<ExecutionState *> > statesAt;
+
+    uint64_t nextOrder;
+
+    /// \brief The number of ancestors of the state's interpolation tree node
+    /// that are completed when the state terminates
+    static unsigned closingDepth(ExecutionState *state);
+
+    void erase(ExecutionState *state);
+
+    void refresh(ExecutionState *state);
+
+    /// \brief Mark stale the states whose priority changes when the node of a
+    /// terminated state is removed from the interpolation tree
+    void markRemoval(TxTreeNode *node);
+
+  public:
+    InterpolationSearcher() : nextOrder(0) {}
+
+    ExecutionState &selectState();
+    void update(ExecutionState *current,
+                const std::vector<ExecutionState *> &addedStates,
+                const std::vector<ExecutionState *> &removedStates);
+    bool empty() { return priorities.empty(); }
+    void printName(llvm::raw_ostream &os) {
+      os << "InterpolationSearcher\n";
+    }
+
+    virtual std::vector<ExecutionState *> getStates();
+  };
+
   class BFSSearcher : public Searcher {
     std::deque<ExecutionState*> states;
 
@@ -25,6 +25,7 @@
 #include "CoreStats.h"
 #include "Executor.h"
 #include "MemoryManager.h"
+#include "TxTree.h"
 #include "UserSearcher.h"
 
 #if LLVM_VERSION_CODE > LLVM_VERSION(3, 2)
@@ -75,6 +76,11 @@ cl::opt<bool>
 OutputStats("output-stats", cl::init(true),
             cl::desc("Write running stats trace file (default=on)"));
 
+cl::opt<bool> OutputTxStats(
+    "output-txstats", cl::init(true),
+    cl::desc("Write running interpolation stats trace file run.txstats, "
+             "when interpolation and -output-stats are enabled (default=on)"));
+
 cl::opt<bool> OutputIStats(
     "output-istats", cl::init(true),
     cl::desc(
@@ -179,11 +185,15 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
     objectFilename(_objectFilename),
     statsFile(0),
     istatsFile(0),
+    txStatsFile(0),
     startWallTime(util::getWallTime()),
     numBranches(0),
     fullBranches(0),
     partialBranches(0),
-    updateMinDistToUncovered(_updateMinDistToUncovered) {
+    updateMinDistToUncovered(_updateMinDistToUncovered),
+    lastSubsumptionChecks(0),
+    lastSubsumedStates(0),
+    lastSubsumptionCheckTime(0) {
 
   if (StatsWriteAfterInstructions > 0 && StatsWriteInterval > 0)
     klee_error("Both options --stats-write-interval and "
@@ -244,6 +254,11 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
     statsFile = executor.interpreterHandler->openOutputFile("run.stats");
     assert(statsFile && "unable to open statistics trace file");
     writeStatsHeader();
+    if (OutputTxStats && INTERPOLATION_ENABLED) {
+      txStatsFile = executor.interpreterHandler->openOutputFile("run.txstats");
+      assert(txStatsFile && "unable to open interpolation statistics file");
+      writeTxStatsHeader();
+    }
     writeStatsLine();
 
     if (StatsWriteInterval > 0)
@@ -270,6 +285,8 @@ StatsTracker::~StatsTracker() {
     delete statsFile;
   if (istatsFile)
     delete istatsFile;
+  if (txStatsFile)
+    delete txStatsFile;
 }
 
 void StatsTracker::done() {
@@ -416,6 +433,13 @@ void StatsTracker::writeStatsHeader() {
              << "'CexCacheTime',"
              << "'ForkTime',"
              << "'ResolveTime',"
+             << "'SubsumedStates',"
+             << "'TableEntries',"
+             << "'StateMemory',"
+             << "'TxTreeMemory',"
+             << "'TxTableMemory',"
+             << "'ObjectBytesCopied',"
+             << "'PeakRSS',"
 #ifdef DEBUG
 	     << "'ArrayHashTime',"
 #endif
@@ -428,11 +452,22 @@ double StatsTracker::elapsed() {
 }
 
 void StatsTracker::writeStatsLine() {
+  // The memory is accounted separately for the states, the interpolation tree
+  // with its dependency information, and the subsumption table
+  uint64_t totalMemory = util::GetTotalMallocUsage() +
+                         executor.memory->getUsedDeterministicSize();
+  uint64_t txTreeMemory = 0, txTableMemory = 0;
+  if (INTERPOLATION_ENABLED) {
+    txTreeMemory = TxTree::getApproximateSize();
+    txTableMemory = TxSubsumptionTable::getApproximateSize();
+  }
+  uint64_t stateMemory = totalMemory - std::min(totalMemory,
+                                                txTreeMemory + txTableMemory);
+
   *statsFile << "(" << stats::instructions << "," << fullBranches << ","
              << partialBranches << "," << numBranches << ","
              << util::getUserTime() << "," << executor.states.size() << ","
-             << util::GetTotalMallocUsage() +
-                    executor.memory->getUsedDeterministicSize() << ","
+             << totalMemory << ","
              << stats::queries << "," << stats::queryConstructs << ","
              << 0 // was numObjects
              << "," << elapsed() << "," << stats::coveredInstructions << ","
@@ -441,12 +476,72 @@ void StatsTracker::writeStatsLine() {
              << stats::solverTime / 1000000. << ","
              << stats::cexCacheTime / 1000000. << ","
              << stats::forkTime / 1000000. << ","
-             << stats::resolveTime / 1000000.
+             << stats::resolveTime / 1000000. << ","
+             << TxSubsumptionTable::getSubsumedStateCount() << ","
+             << TxSubsumptionTable::getEntryCount() << ","
+             << stateMemory << "," << txTreeMemory << "," << txTableMemory
+             << "," << stats::objectBytesCopied << ","
+             << util::GetPeakResidentSetSize()
 #ifdef DEBUG
              << "," << stats::arrayHashTime / 1000000.
 #endif
              << ")\n";
   statsFile->flush();
+
+  if (txStatsFile)
+    writeTxStatsLine(txTreeMemory, txTableMemory);
+}
+
+void StatsTracker::writeTxStatsHeader() {
+  *txStatsFile << "('WallTime',"
+               << "'Instructions',"
+               << "'SubsumptionChecks',"
+               << "'SubsumedStates',"
+               << "'SubsumptionQueries',"
+               << "'SubsumptionCheckTime',"
+               << "'IntervalChecks',"
+               << "'IntervalHitRatio',"
+               << "'IntervalCheckLatency',"
+               << "'TableEntries',"
+               << "'ProgramPoints',"
+               << "'MaxProgramPointEntries',"
+               << "'TxTreeMemory',"
+               << "'TxTableMemory',"
+               << "'TxSlabMemory',"
+               << ")\n";
+  txStatsFile->flush();
+}
+
+void StatsTracker::writeTxStatsLine(uint64_t txTreeMemory,
+                                    uint64_t txTableMemory) {
+  uint64_t checks = TxTree::subsumptionCheckCount;
+  uint64_t subsumed = TxSubsumptionTable::getSubsumedStateCount();
+  uint64_t checkTime = TxTree::subsumptionCheckTime;
+
+  // The hit ratio (percent) and the average latency of a subsumption check
+  // (milliseconds) within the interval since the previous line
+  uint64_t intervalChecks = checks - lastSubsumptionChecks;
+  double hitRatio = 0, checkLatency = 0;
+  if (intervalChecks) {
+    hitRatio = (subsumed - lastSubsumedStates) * 100. / intervalChecks;
+    checkLatency =
+        (checkTime - lastSubsumptionCheckTime) / 1000. / intervalChecks;
+  }
+  lastSubsumptionChecks = checks;
+  lastSubsumedStates = subsumed;
+  lastSubsumptionCheckTime = checkTime;
+
+  *txStatsFile << "(" << elapsed() << "," << stats::instructions << ","
+               << checks << "," << subsumed << ","
+               << stats::subsumptionQueryCount << ","
+               << checkTime / 1000000. << "," << intervalChecks << ","
+               << hitRatio << "," << checkLatency << ","
+               << TxSubsumptionTable::getEntryCount() << ","
+               << TxSubsumptionTable::getProgramPointCount() << ","
+               << TxSubsumptionTable::getMaxProgramPointEntryCount() << ","
+               << txTreeMemory << "," << txTableMemory << ","
+               << TxSlabAllocatorBase::getSlabBytes() << ")\n";
+  txStatsFile->flush();
 }
 
 void StatsTracker::updateStateStatistics(uint64_t addend) {
@@ -37,7 +37,7 @@ namespace klee {
     Executor &executor;
     std::string objectFilename;
 
-    llvm::raw_fd_ostream *statsFile, *istatsFile;
+    llvm::raw_fd_ostream *statsFile, *istatsFile, *txStatsFile;
     double startWallTime;
     
     unsigned numBranches;
@@ -47,6 +47,11 @@ namespace klee {
 
     bool updateMinDistToUncovered;
 
+    /// The subsumption counters at the previous line of run.txstats, to
+    /// compute the hit ratio and the check latency of each interval
+    uint64_t lastSubsumptionChecks, lastSubsumedStates;
+    uint64_t lastSubsumptionCheckTime;
+
   public:
     static bool useStatistics();
 
@@ -54,6 +59,8 @@ namespace klee {
     void updateStateStatistics(uint64_t addend);
     void writeStatsHeader();
     void writeStatsLine();
+    void writeTxStatsHeader();
+    void writeTxStatsLine(uint64_t txTreeMemory, uint64_t txTableMemory);
     void writeIStats();
 
   public:
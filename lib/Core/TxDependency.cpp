@@ -45,6 +45,12 @@
 using namespace klee;
 
 namespace klee {
+TxSlabAllocator<TxDependency> TxDependency::allocator("TxDependency");
+
+uint64_t TxDependency::concreteOperandCount = 0;
+
+uint64_t TxDependency::allocatedSize = 0;
+
 bool TxDependency::isMainArgument(const llvm::Value *loc) {
   const llvm::Argument *vArg = llvm::dyn_cast<llvm::Argument>(loc);
 
@@ -60,12 +66,12 @@ bool TxDependency::isMainArgument(const llvm::Value *loc) {
 ref<TxStateValue>
 TxDependency::registerNewTxStateValue(llvm::Value *value,
                                       ref<TxStateValue> vvalue) {
-  valuesMap[value].push_back(vvalue);
+  store->registerValue(valuesMap, value, vvalue);
   return vvalue;
 }
 
 ref<TxStateValue> TxDependency::getLatestValue(
-    llvm::Value *value, const std::vector<llvm::Instruction *> &callHistory,
+    llvm::Value *value, const TxCallHistory *callHistory,
     ref<Expr> valueExpr, bool allowInconsistency) {
   assert(value && !valueExpr.isNull() && "value cannot be null");
 
@@ -84,43 +90,51 @@ ref<TxStateValue> TxDependency::getLatestValueNoConstantCheck(
     llvm::Value *value, ref<Expr> valueExpr, bool allowInconsistency) const {
   assert(value && "value cannot be null");
 
-  std::map<llvm::Value *, std::vector<ref<TxStateValue> > >::const_iterator
-  valuesMapIter = valuesMap.find(value);
-
-  if (valuesMapIter != valuesMap.end()) {
-    if (!valueExpr.isNull()) {
-      // Slight complication here that the latest version of an LLVM
-      // value may not be at the end of the vector; it is possible other
-      // values in a call stack has been appended to the vector, before
-      // the function returned, so the end part of the vector contains
-      // local values in a call already returned. To resolve this issue,
-      // here we naively search for values with equivalent expression.
-      const std::vector<ref<TxStateValue> > &allValues = valuesMapIter->second;
-
-      // In case this was for adding constraints, simply assume the
-      // latest value is the one without checking for its consistency. This is
-      // due to the difficulty in that the constraint in valueExpr is already
-      // processed into a different syntax (a negation of the original value).
-      if (allowInconsistency)
-        return allValues.back();
-
-      for (std::vector<ref<TxStateValue> >::const_reverse_iterator
-               it = allValues.rbegin(),
-               ie = allValues.rend();
-           it != ie; ++it) {
-        ref<Expr> e = (*it)->getExpression();
-        if (e == valueExpr)
-          return *it;
-      }
-    } else {
-      return valuesMapIter->second.back();
+  if (valueExpr.isNull())
+    return findLatestValue(value);
+
+  for (const TxDependency *dependency = this; dependency;
+       dependency = dependency->parent) {
+    const std::vector<ref<TxStateValue> > *allValues =
+        dependency->findLocalValues(value);
+    if (!allValues)
+      continue;
+
+    // Slight complication here that the latest version of an LLVM
+    // value may not be at the end of the vector; it is possible other
+    // values in a call stack has been appended to the vector, before
+    // the function returned, so the end part of the vector contains
+    // local values in a call already returned. To resolve this issue,
+    // here we naively search for values with equivalent expression.
+
+    // In case this was for adding constraints, simply assume the
+    // latest value is the one without checking for its consistency. This is
+    // due to the difficulty in that the constraint in valueExpr is already
+    // processed into a different syntax (a negation of the original value).
+    if (allowInconsistency)
+      return allValues->back();
+
+    for (std::vector<ref<TxStateValue> >::const_reverse_iterator
+             it = allValues->rbegin(),
+             ie = allValues->rend();
+         it != ie; ++it) {
+      ref<Expr> e = (*it)->getExpression();
+      if (e == valueExpr)
+        return *it;
     }
   }
 
-  if (parent)
-    return parent->getLatestValueNoConstantCheck(value, valueExpr,
-                                                 allowInconsistency);
+  return 0;
+}
 
+ref<TxStateValue> TxDependency::findLatestValue(llvm::Value *value) const {
+  for (const TxDependency *dependency = this; dependency;
+       dependency = dependency->parent) {
+    const std::vector<ref<TxStateValue> > *values =
+        dependency->findLocalValues(value);
+    if (values && !values->empty())
+      return values->back();
+  }
   return 0;
 }
 
@@ -148,6 +162,31 @@ ref<TxStateValue> TxDependency::getLatestValueForMarking(llvm::Value *val,
   return value;
 }
 
+bool TxDependency::isConcreteOperand(const llvm::Value *value) {
+  // Pointer constants, such as the address of a global variable, are
+  // allocations that the interpolant may refer to.
+  if (value->getType()->isPointerTy())
+    return false;
+  return llvm::isa<llvm::ConstantInt>(value) ||
+         llvm::isa<llvm::ConstantFP>(value) ||
+         llvm::isa<llvm::UndefValue>(value);
+}
+
+ref<TxStateValue>
+TxDependency::getLatestOperandValue(llvm::Value *value,
+                                    const TxCallHistory *callHistory,
+                                    ref<Expr> valueExpr) {
+  // A concrete operand is a source of no dependency, and evaluating it would
+  // register a new value for every execution of the instruction. Its value
+  // is only created where it is stored into memory, bound to a call or
+  // returned, in which case it is evaluated by getLatestValue.
+  if (ConcreteFastPath && isConcreteOperand(value)) {
+    ++concreteOperandCount;
+    return 0;
+  }
+  return getLatestValue(value, callHistory, valueExpr);
+}
+
 void TxDependency::addDependency(ref<TxStateValue> source,
                                  ref<TxStateValue> target) {
   if (source.isNull() || target.isNull())
@@ -178,6 +217,27 @@ void TxDependency::addTwoDependencies(ref<TxStateValue> source1,
   }
 }
 
+void TxDependency::addOperandDependencies(ref<TxStateValue> source1,
+                                          ref<TxStateValue> source2,
+                                          ref<TxStateValue> target) {
+  if (!ConcreteFastPath || (!source1.isNull() && !source2.isNull())) {
+    addTwoDependencies(source1, source2, target);
+    return;
+  }
+
+  // The other operand is concrete and not a pointer, as in the case of
+  // addTwoDependencies with one non-pointer source.
+  ref<TxStateValue> source = source1.isNull() ? source2 : source1;
+  if (source.isNull() || target.isNull())
+    return;
+
+  if (source->isPointer()) {
+    addDependencyOfPossiblePointer(source, target);
+  } else {
+    addDependencyToNonPointer(source, target);
+  }
+}
+
 void TxDependency::addDependencyOfPossiblePointer(ref<TxStateValue> source,
                                                   ref<TxStateValue> target) {
   if (source.isNull() || target.isNull())
@@ -234,7 +294,7 @@ void TxDependency::addDependencyWithOffset(ref<TxStateValue> source,
 }
 
 void TxDependency::addDependencyViaExternalFunction(
-    const std::vector<llvm::Instruction *> &callHistory,
+    const TxCallHistory *callHistory,
     ref<TxStateValue> source, ref<TxStateValue> target) {
   if (source.isNull() || target.isNull())
     return;
@@ -280,7 +340,7 @@ void TxDependency::addDependencyToNonPointer(ref<TxStateValue> source,
 }
 
 void TxDependency::populateArgumentValuesList(
-    llvm::CallInst *site, const std::vector<llvm::Instruction *> &callHistory,
+    llvm::CallInst *site, const TxCallHistory *callHistory,
     std::vector<ref<Expr> > &arguments,
     std::vector<ref<TxStateValue> > &argumentValuesList) {
   unsigned numArgs = site->getCalledFunction()->arg_size();
@@ -303,9 +363,9 @@ void TxDependency::populateArgumentValuesList(
 TxDependency::TxDependency(
     TxDependency *parent, llvm::DataLayout *_targetData,
     std::map<const llvm::GlobalValue *, ref<ConstantExpr> > *_globalAddresses)
-    : parent(parent), left(0), right(0), targetData(_targetData),
-      globalAddresses(_globalAddresses) {
-
+    : parent(parent), left(0), right(0), approximateSize(0),
+      targetData(_targetData), globalAddresses(_globalAddresses) {
+  account(sizeof(TxDependency) + sizeof(TxPathCondition));
 
   if (parent) {
     pathCondition = TxPathCondition::create(parent->pathCondition);
@@ -330,21 +390,20 @@ TxDependency::TxDependency(
 
 TxDependency::~TxDependency() {
   // Delete valuesMap
-  for (std::map<llvm::Value *, std::vector<ref<TxStateValue> > >::iterator
-           it = valuesMap.begin(),
-           ie = valuesMap.end();
+  for (TxValuesMap::iterator it = valuesMap.begin(), ie = valuesMap.end();
        it != ie; ++it) {
     it->second.clear();
   }
   delete pathCondition;
   delete store;
   valuesMap.clear();
+  allocatedSize -= approximateSize;
 }
 
 TxDependency *TxDependency::cdr() const { return parent; }
 
 void TxDependency::execute(llvm::Instruction *instr,
-                           const std::vector<llvm::Instruction *> &callHistory,
+                           const TxCallHistory *callHistory,
                            std::vector<ref<Expr> > &args,
                            bool symbolicExecutionError) {
   // The basic design principle that we need to be careful here
@@ -835,9 +894,9 @@ void TxDependency::execute(llvm::Instruction *instr,
     switch (instr->getOpcode()) {
     case llvm::Instruction::Select: {
       ref<TxStateValue> op1 =
-          getLatestValue(instr->getOperand(1), callHistory, op1Expr);
+          getLatestOperandValue(instr->getOperand(1), callHistory, op1Expr);
       ref<TxStateValue> op2 =
-          getLatestValue(instr->getOperand(2), callHistory, op2Expr);
+          getLatestOperandValue(instr->getOperand(2), callHistory, op2Expr);
       ref<TxStateValue> newValue =
           getNewTxStateValue(instr, callHistory, result);
 
@@ -846,7 +905,7 @@ void TxDependency::execute(llvm::Instruction *instr,
       } else if (result == op2Expr) {
         addDependency(op2, newValue);
       } else {
-        addTwoDependencies(op1, op2, newValue);
+        addOperandDependencies(op1, op2, newValue);
       }
       break;
     }
@@ -873,9 +932,9 @@ void TxDependency::execute(llvm::Instruction *instr,
     case llvm::Instruction::FCmp:
     case llvm::Instruction::InsertValue: {
       ref<TxStateValue> op1 =
-          getLatestValue(instr->getOperand(0), callHistory, op1Expr);
+          getLatestOperandValue(instr->getOperand(0), callHistory, op1Expr);
       ref<TxStateValue> op2 =
-          getLatestValue(instr->getOperand(1), callHistory, op2Expr);
+          getLatestOperandValue(instr->getOperand(1), callHistory, op2Expr);
       ref<TxStateValue> newValue;
 
       if (op1.isNull() &&
@@ -889,9 +948,13 @@ void TxDependency::execute(llvm::Instruction *instr,
         op2 = getNewTxStateValue(instr->getOperand(1), callHistory, op2Expr);
       }
 
-      if (!op1.isNull() || !op2.isNull()) {
+      // The result of a concrete operand is still created, so that the
+      // instructions using it find a value as before.
+      if (!op1.isNull() || !op2.isNull() ||
+          isConcreteOperand(instr->getOperand(0)) ||
+          isConcreteOperand(instr->getOperand(1))) {
         newValue = getNewTxStateValue(instr, callHistory, result);
-        addTwoDependencies(op1, op2, newValue);
+        addOperandDependencies(op1, op2, newValue);
       }
       break;
     }
@@ -930,7 +993,7 @@ void TxDependency::execute(llvm::Instruction *instr,
 
 void TxDependency::executeMakeSymbolic(
     llvm::Instruction *instr,
-    const std::vector<llvm::Instruction *> &callHistory, ref<Expr> address,
+    const TxCallHistory *callHistory, ref<Expr> address,
     const Array *array) {
   llvm::Value *pointer = instr->getOperand(0);
 
@@ -957,7 +1020,7 @@ void TxDependency::executeMakeSymbolic(
 
 void
 TxDependency::executePHI(llvm::Instruction *instr, unsigned int incomingBlock,
-                         const std::vector<llvm::Instruction *> &callHistory,
+                         const TxCallHistory *callHistory,
                          ref<Expr> valueExpr, bool symbolicExecutionError) {
   llvm::PHINode *node = llvm::dyn_cast<llvm::PHINode>(instr);
   llvm::Value *llvmArgValue = node->getIncomingValue(incomingBlock);
@@ -975,7 +1038,7 @@ TxDependency::executePHI(llvm::Instruction *instr, unsigned int incomingBlock,
 
 bool TxDependency::executeMemoryOperation(
     llvm::Instruction *instr,
-    const std::vector<llvm::Instruction *> &callHistory,
+    const TxCallHistory *callHistory,
     std::vector<ref<Expr> > &args, bool inBounds, bool symbolicExecutionError) {
   bool ret = false;
   if (inBounds)
@@ -1032,7 +1095,7 @@ bool TxDependency::executeMemoryOperation(
 
 void
 TxDependency::bindCallArguments(llvm::Instruction *i,
-                                std::vector<llvm::Instruction *> &callHistory,
+                                const TxCallHistory *&callHistory,
                                 std::vector<ref<Expr> > &arguments) {
   llvm::CallInst *site = llvm::dyn_cast<llvm::CallInst>(i);
 
@@ -1046,11 +1109,14 @@ TxDependency::bindCallArguments(llvm::Instruction *i,
   if (!callee)
     return;
 
+  uint64_t capacity = argumentValuesList.capacity();
   argumentValuesList.clear();
   populateArgumentValuesList(site, callHistory, arguments, argumentValuesList);
+  account((argumentValuesList.capacity() - capacity) *
+          sizeof(ref<TxStateValue>));
 
   unsigned index = 0;
-  callHistory.push_back(i);
+  callHistory = callHistory->push(i);
   for (llvm::Function::ArgumentListType::iterator
            it = callee->getArgumentList().begin(),
            ie = callee->getArgumentList().end();
@@ -1069,7 +1135,7 @@ TxDependency::bindCallArguments(llvm::Instruction *i,
 
 void
 TxDependency::bindReturnValue(llvm::CallInst *site,
-                              std::vector<llvm::Instruction *> &callHistory,
+                              const TxCallHistory *&callHistory,
                               llvm::Instruction *i, ref<Expr> returnValue) {
   llvm::ReturnInst *retInst = llvm::dyn_cast<llvm::ReturnInst>(i);
   if (site && retInst &&
@@ -1077,9 +1143,7 @@ TxDependency::bindReturnValue(llvm::CallInst *site,
       ) {
     ref<TxStateValue> value =
         getLatestValue(retInst->getReturnValue(), callHistory, returnValue);
-    if (!callHistory.empty()) {
-      callHistory.pop_back();
-    }
+    callHistory = callHistory->pop();
     if (!value.isNull())
       addDependency(value, getNewTxStateValue(site, callHistory, returnValue));
   }
@@ -1130,6 +1194,8 @@ void TxDependency::recursivelyMarkGlobalVars(ref<TxStoreEntry> se) {
     }
     if (!isIn) {
       markedGlobal.insert(se);
+      // A rough per-node overhead of a std::set element
+      account(4 * sizeof(void *) + sizeof(ref<TxStoreEntry>));
     }
   }
   if (parent) {
@@ -1212,7 +1278,7 @@ void TxDependency::memoryBoundViolationInterpolation(llvm::Instruction *inst,
 }
 
 inline ref<TxStateValue> TxDependency::createConstantValue(
-    llvm::Value *value, const std::vector<llvm::Instruction *> &callHistory,
+    llvm::Value *value, const TxCallHistory *callHistory,
     ref<Expr> expr) {
   if (value->getType()->isPointerTy()) {
     llvm::Type *ty = value->getType()->getPointerElementType();
@@ -1223,12 +1289,12 @@ inline ref<TxStateValue> TxDependency::createConstantValue(
 }
 
 ref<TxStateValue> TxDependency::evalConstant(
-    llvm::Constant *c, const std::vector<llvm::Instruction *> &callHistory) {
+    llvm::Constant *c, const TxCallHistory *callHistory) {
   if (llvm::ConstantExpr *ce = llvm::dyn_cast<llvm::ConstantExpr>(c)) {
     return evalConstantExpr(ce, callHistory);
   } else {
     // We use empty call history for constants, since they are in a sense global
-    const std::vector<llvm::Instruction *> emptyCallHistory;
+    const TxCallHistory *emptyCallHistory = TxCallHistory::getEmpty();
 
     if (const llvm::ConstantInt *ci = llvm::dyn_cast<llvm::ConstantInt>(c)) {
       return createConstantValue(c, emptyCallHistory,
@@ -1306,7 +1372,7 @@ ref<TxStateValue> TxDependency::evalConstant(
 
 ref<TxStateValue> TxDependency::evalConstantExpr(
     llvm::ConstantExpr *ce,
-    const std::vector<llvm::Instruction *> &callHistory) {
+    const TxCallHistory *callHistory) {
   LLVM_TYPE_Q llvm::Type *type = ce->getType();
 
   ref<TxStateValue> op1(0), op2(0), op3(0);
@@ -22,6 +22,7 @@
 #include "TxStore.h"
 
 #include "klee/Config/Version.h"
+#include "klee/Internal/ADT/TxSlabAllocator.h"
 #include "klee/Internal/Module/TxValues.h"
 
 #if LLVM_VERSION_CODE >= LLVM_VERSION(3, 3)
@@ -171,6 +172,9 @@ namespace klee {
 /// \see TxStateValue
 /// \see TxStateAddress
 class TxDependency {
+  /// \brief The slab allocator of the objects of this class
+  static TxSlabAllocator<TxDependency> allocator;
+
   /// \brief The path condition manager
   TxPathCondition *pathCondition;
 
@@ -184,7 +188,20 @@ class TxDependency {
   std::vector<ref<TxStateValue> > argumentValuesList;
 
   /// \brief The store of the versioned values
-  std::map<llvm::Value *, std::vector<ref<TxStateValue> > > valuesMap;
+  TxValuesMap valuesMap;
+
+  /// \brief The approximate number of bytes used by this node and its global
+  /// markings. The versioned values are accounted with the store.
+  uint64_t approximateSize;
+
+  /// \brief The sum of the approximate sizes of all live nodes
+  static uint64_t allocatedSize;
+
+  /// \brief Add to the approximate size of this node
+  void account(uint64_t size) {
+    approximateSize += size;
+    allocatedSize += size;
+  }
 
   /// \brief The data layout of the analysis target program
   llvm::DataLayout *targetData;
@@ -208,7 +225,7 @@ class TxDependency {
   /// new instruction, as a value for the instruction.
   ref<TxStateValue>
   getNewTxStateValue(llvm::Value *value,
-                     const std::vector<llvm::Instruction *> &callHistory,
+                     const TxCallHistory *callHistory,
                      ref<Expr> valueExpr) {
     return registerNewTxStateValue(
         value,
@@ -219,7 +236,7 @@ class TxDependency {
   /// absolute address
   ref<TxStateValue>
   getNewPointerValue(llvm::Value *loc,
-                     const std::vector<llvm::Instruction *> &callHistory,
+                     const TxCallHistory *callHistory,
                      ref<Expr> address, uint64_t size) {
     ref<TxStateValue> vvalue =
         TxStateValue::create(store->getDepth(), loc, callHistory, address);
@@ -232,13 +249,13 @@ class TxDependency {
   /// copied from Executor::evalConstant.
   ref<TxStateValue>
   evalConstant(llvm::Constant *c,
-               const std::vector<llvm::Instruction *> &callHistory);
+               const TxCallHistory *callHistory);
 
   /// \brief Get a KLEE expression from a constant expression. This was
   /// shamelessly copied from Executor::evalConstantExpr.
   ref<TxStateValue>
   evalConstantExpr(llvm::ConstantExpr *ce,
-                   const std::vector<llvm::Instruction *> &callHistory);
+                   const TxCallHistory *callHistory);
 
   /// \brief Gets the latest version of the location, but without checking
   /// for whether the value is constant or not.
@@ -250,18 +267,36 @@ class TxDependency {
   /// one.
   inline ref<TxStateValue>
   createConstantValue(llvm::Value *value,
-                      const std::vector<llvm::Instruction *> &callHistory,
+                      const TxCallHistory *callHistory,
                       ref<Expr> expr);
 
   /// \brief Gets the latest pointer value for marking
   ref<TxStateValue> getLatestValueForMarking(llvm::Value *val, ref<Expr> expr);
 
+  /// \brief Tests if a value is an integer or floating-point constant, which
+  /// has no dependency and carries no allocation
+  static bool isConcreteOperand(const llvm::Value *value);
+
+  /// \brief Gets the latest version of an operand of an arithmetic,
+  /// comparison or select instruction. With -concrete-fast-path, this is null
+  /// for a concrete operand, for which no value is created.
+  ref<TxStateValue> getLatestOperandValue(llvm::Value *value,
+                                          const TxCallHistory *callHistory,
+                                          ref<Expr> valueExpr);
+
   /// \brief Add flow dependency between source and target value
   void addDependency(ref<TxStateValue> source, ref<TxStateValue> target);
 
   void addTwoDependencies(ref<TxStateValue> source1, ref<TxStateValue> source2,
                           ref<TxStateValue> target);
 
+  /// \brief Add flow dependency from the operands of an instruction of two
+  /// operands to its result, where a null source is a concrete operand with
+  /// -concrete-fast-path
+  void addOperandDependencies(ref<TxStateValue> source1,
+                              ref<TxStateValue> source2,
+                              ref<TxStateValue> target);
+
   /// \brief Add flow dependency between source and target value
   void addDependencyOfPossiblePointer(ref<TxStateValue> source,
                                       ref<TxStateValue> target);
@@ -278,7 +313,7 @@ class TxDependency {
   /// is checked for memory access validity at the current index, meaning that
   /// we assumed all memory access within the external function is valid.
   void addDependencyViaExternalFunction(
-      const std::vector<llvm::Instruction *> &callHistory,
+      const TxCallHistory *callHistory,
       ref<TxStateValue> source, ref<TxStateValue> target);
 
   /// \brief Add a flow dependency from a pointer value to a non-pointer
@@ -288,13 +323,13 @@ class TxDependency {
 
   /// \brief Record the expressions of a call's arguments
   void populateArgumentValuesList(
-      llvm::CallInst *site, const std::vector<llvm::Instruction *> &callHistory,
+      llvm::CallInst *site, const TxCallHistory *callHistory,
       std::vector<ref<Expr> > &arguments,
       std::vector<ref<TxStateValue> > &argumentValuesList);
 
   void getStoredExpressions(
       const TxStore *referenceStore,
-      const std::vector<llvm::Instruction *> &callHistory,
+      const TxCallHistory *callHistory,
       const std::map<ref<Expr>, ref<Expr> > &substitution,
       std::set<const Array *> &replacements, bool coreOnly, bool leftRetrieval,
       TxStore::TopStateStore &__internalStore,
@@ -308,7 +343,7 @@ class TxDependency {
 
   void getStoredCoreExpressions(
       const TxStore *referenceStore,
-      const std::vector<llvm::Instruction *> &callHistory,
+      const TxCallHistory *callHistory,
       const std::map<ref<Expr>, ref<Expr> > &substitution,
       std::set<const Array *> &replacements, bool coreOnly, bool leftRetrieval,
       TxStore::TopInterpolantStore &concretelyAddressedStore,
@@ -323,6 +358,10 @@ class TxDependency {
   }
 
 public:
+  /// \brief The number of concrete operands for which no value was created
+  /// with -concrete-fast-path
+  static uint64_t concreteOperandCount;
+
   /// \brief This is for dynamic setting up of debug messages.
   int debugSubsumptionLevel;
 
@@ -335,8 +374,21 @@ public:
 
   ~TxDependency();
 
+  static void *operator new(size_t size) { return allocator.allocate(size); }
+
+  static void operator delete(void *p, size_t size) {
+    allocator.deallocate(p, size);
+  }
+
   std::set<ref<TxStoreEntry> > &getMarkedGlobal() { return markedGlobal; }
 
+  /// \brief The approximate number of bytes used by the dependency
+  /// information of all live nodes, including their stores. The values
+  /// themselves, which are shared between nodes, are not counted.
+  static uint64_t getAllocatedSize() {
+    return allocatedSize + TxStore::getAllocatedSize();
+  }
+
   bool isEntryInParent(ref<TxStoreEntry> se) {
     if (!parent)
       return false;
@@ -381,7 +433,7 @@ public:
   ///
   /// \sa TxStore#getStoredExpressions()
   void getParentStoredExpressions(
-      const std::vector<llvm::Instruction *> &callHistory,
+      const TxCallHistory *callHistory,
       const std::map<ref<Expr>, ref<Expr> > &substitution,
       std::set<const Array *> &replacements, bool coreOnly, bool &leftRetrieval,
       TxStore::TopStateStore &__internalStore,
@@ -429,7 +481,7 @@ public:
   ///
   /// \sa TxStore#getStoredExpressions()
   void getParentStoredCoreExpressions(
-      const std::vector<llvm::Instruction *> &callHistory,
+      const TxCallHistory *callHistory,
       const std::map<ref<Expr>, ref<Expr> > &substitution,
       std::set<const Array *> &replacements, bool coreOnly,
       TxStore::TopInterpolantStore &concretelyAddressedStore,
@@ -450,28 +502,36 @@ public:
         symbolicallyAddressedHistoricalStore);
   }
 
-  std::map<llvm::Value *, std::vector<ref<TxStateValue> > > getvaluesMap() {
-    return valuesMap;
+  /// \brief The versions of the value created at this node, the latest last,
+  /// or null if none were. This does not look at the ancestors.
+  const std::vector<ref<TxStateValue> > *
+  findLocalValues(llvm::Value *value) const {
+    TxValuesMap::const_iterator it = valuesMap.find(value);
+    return it == valuesMap.end() ? 0 : &it->second;
   }
 
+  /// \brief The latest version of the value created at this node or, failing
+  /// that, at the nearest ancestor, or null if none were.
+  ref<TxStateValue> findLatestValue(llvm::Value *value) const;
+
   ref<TxStateValue>
   getLatestValue(llvm::Value *value,
-                 const std::vector<llvm::Instruction *> &callHistory,
+                 const TxCallHistory *callHistory,
                  ref<Expr> valueExpr, bool allowInconsistency = false);
 
   /// \brief Abstract dependency state transition with argument(s)
   void execute(llvm::Instruction *instr,
-               const std::vector<llvm::Instruction *> &callHistory,
+               const TxCallHistory *callHistory,
                std::vector<ref<Expr> > &args, bool symbolicExecutionError);
 
   /// \brief Execution of klee_make_symbolic
   void executeMakeSymbolic(llvm::Instruction *instr,
-                           const std::vector<llvm::Instruction *> &callHistory,
+                           const TxCallHistory *callHistory,
                            ref<Expr> address, const Array *array);
 
   /// \brief Build dependencies from PHI node
   void executePHI(llvm::Instruction *instr, unsigned int incomingBlock,
-                  const std::vector<llvm::Instruction *> &callHistory,
+                  const TxCallHistory *callHistory,
                   ref<Expr> valueExpr, bool symbolicExecutionError);
 
   /// \brief Execute memory operation (load/store). Returns true if memory
@@ -482,18 +542,18 @@ public:
   /// load / store instruction is processed.
   bool
   executeMemoryOperation(llvm::Instruction *instr,
-                         const std::vector<llvm::Instruction *> &callHistory,
+                         const TxCallHistory *callHistory,
                          std::vector<ref<Expr> > &args, bool inBounds,
                          bool symbolicExecutionError);
 
   /// \brief Record call arguments in a function call
   void bindCallArguments(llvm::Instruction *instr,
-                         std::vector<llvm::Instruction *> &callHistory,
+                         const TxCallHistory *&callHistory,
                          std::vector<ref<Expr> > &arguments);
 
   /// \brief This propagates the dependency due to the return value of a call
   void bindReturnValue(llvm::CallInst *site,
-                       std::vector<llvm::Instruction *> &callHistory,
+                       const TxCallHistory *&callHistory,
                        llvm::Instruction *inst, ref<Expr> returnValue);
 
   /// \brief Given an LLVM value and the expression it is associated with,
@@ -547,7 +607,7 @@ public:
   /// \brief Add constraint onto the path condition
   ref<TxPCConstraint>
   addConstraint(ref<Expr> constraint, llvm::Value *condition,
-                std::vector<llvm::Instruction *> &callHistory) {
+                const TxCallHistory *&callHistory) {
     return pathCondition->addConstraint(
         constraint, getLatestValue(condition, callHistory, constraint, true));
   }
@@ -0,0 +1,750 @@
+//===-- TxInterpolantDatabase.cpp - Persistent subsumption table ---------===//
+//
+//               The Tracer-X KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the implementations of the class for saving the
+/// subsumption table into a file and preloading it in a later run on the same
+/// module.
+///
+//===----------------------------------------------------------------------===//
+
+#include "TxInterpolantDatabase.h"
+
+#include "TxTree.h"
+
+#include "expr/Parser.h"
+#include "klee/Constraints.h"
+#include "klee/ExprBuilder.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+#include "klee/Internal/Support/ModuleUtil.h"
+#include "klee/util/ArrayCache.h"
+#include "klee/util/ExprPPrinter.h"
+#include "klee/util/ExprVisitor.h"
+
+#if LLVM_VERSION_CODE >= LLVM_VERSION(3, 3)
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Function.h>
+#else
+#include <llvm/BasicBlock.h>
+#include <llvm/Function.h>
+#endif
+#include <llvm/Support/raw_ostream.h>
+
+#include <fstream>
+#include <sstream>
+
+using namespace klee;
+
+namespace {
+
+/// \brief Replaces the symbolic arrays created by the parser with the arrays
+/// of the same name and size in the array cache of the run. The cache returns
+/// the same array when the run later creates it, hence the loaded
+/// interpolants mention the arrays of the states they are checked against.
+class ArrayRebinder : public ExprVisitor {
+  ArrayCache &arrayCache;
+
+  std::map<const Array *, const Array *> arrays;
+
+protected:
+  Action visitRead(const ReadExpr &re) {
+    std::vector<const UpdateNode *> nodes;
+    for (const UpdateNode *un = re.updates.head; un; un = un->next)
+      nodes.push_back(un);
+
+    UpdateList updates(rebind(re.updates.root), 0);
+    for (std::vector<const UpdateNode *>::reverse_iterator it = nodes.rbegin(),
+                                                           ie = nodes.rend();
+         it != ie; ++it) {
+      updates.extend(visit((*it)->index), visit((*it)->value));
+    }
+    return Action::changeTo(ReadExpr::create(updates, visit(re.index)));
+  }
+
+public:
+  ArrayRebinder(ArrayCache &_arrayCache) : arrayCache(_arrayCache) {}
+
+  const Array *rebind(const Array *array) {
+    // Constant arrays are not shared by name, and stay owned by the parser
+    if (!array->isSymbolicArray())
+      return array;
+
+    std::map<const Array *, const Array *>::iterator it = arrays.find(array);
+    if (it != arrays.end())
+      return it->second;
+
+    const Array *ret = arrayCache.CreateArray(array->name, array->size, 0, 0,
+                                              array->domain, array->range);
+    arrays[array] = ret;
+    return ret;
+  }
+};
+}
+
+std::vector<expr::Parser *> TxInterpolantDatabase::parsers;
+
+std::vector<llvm::MemoryBuffer *> TxInterpolantDatabase::buffers;
+
+bool TxInterpolantDatabase::hasStores(const TxSubsumptionTableEntry *entry) {
+  return !entry->concretelyAddressedStore.empty() ||
+         !entry->symbolicallyAddressedStore.empty() ||
+         !entry->concretelyAddressedHistoricalStore.empty() ||
+         !entry->symbolicallyAddressedHistoricalStore.empty();
+}
+
+bool TxInterpolantDatabase::writeEntry(
+    std::ostream &stream, const TxSubsumptionTableEntry *entry,
+    std::map<llvm::Instruction *, std::string> &idCache,
+    std::vector<ref<Expr> > &exprs) {
+  if (!entry->markedGlobal.empty() || !entry->wpInterpolant.isNull())
+    return false;
+
+  stream << "entry";
+  writeInstruction(
+      stream, reinterpret_cast<llvm::Instruction *>(entry->programPoint),
+      idCache);
+  writeInstruction(
+      stream, reinterpret_cast<llvm::Instruction *>(entry->prevProgramPoint),
+      idCache);
+  writeCallHistory(stream, entry->callHistory, idCache);
+
+  stream << " " << !entry->interpolant.isNull();
+  if (!entry->interpolant.isNull())
+    exprs.push_back(entry->interpolant);
+
+  stream << " " << entry->phiValues.size();
+  for (std::map<llvm::Value *, std::vector<ref<Expr> > >::const_iterator
+           it = entry->phiValues.begin(),
+           ie = entry->phiValues.end();
+       it != ie; ++it) {
+    if (!writeValue(stream, it->first, idCache))
+      return false;
+    stream << " " << it->second.size();
+    exprs.insert(exprs.end(), it->second.begin(), it->second.end());
+  }
+
+  return writeStore(stream, entry->concretelyAddressedStore, idCache, exprs) &&
+         writeStore(stream, entry->symbolicallyAddressedStore, idCache,
+                    exprs) &&
+         writeStore(stream, entry->concretelyAddressedHistoricalStore, idCache,
+                    exprs) &&
+         writeStore(stream, entry->symbolicallyAddressedHistoricalStore,
+                    idCache, exprs);
+}
+
+TxSubsumptionTableEntry *
+TxInterpolantDatabase::readEntry(std::istream &stream, llvm::Module *module,
+                                 std::deque<ref<Expr> > &exprs,
+                                 const std::set<const Array *> &existentials) {
+  std::string tag;
+  llvm::Instruction *programPoint, *prevProgramPoint;
+  const TxCallHistory *callHistory;
+  bool hasInterpolant;
+  unsigned long phiCount;
+  if (!(stream >> tag) || tag != "entry" ||
+      !readInstruction(stream, module, programPoint) || !programPoint ||
+      !readInstruction(stream, module, prevProgramPoint) ||
+      !readCallHistory(stream, module, callHistory) ||
+      !(stream >> hasInterpolant))
+    return 0;
+
+  ref<Expr> interpolant;
+  if (hasInterpolant) {
+    if (exprs.empty())
+      return 0;
+    interpolant = exprs.front();
+    exprs.pop_front();
+  }
+
+  std::map<llvm::Value *, std::vector<ref<Expr> > > phiValues;
+  if (!(stream >> phiCount))
+    return 0;
+  for (unsigned long i = 0; i < phiCount; ++i) {
+    llvm::Value *phi;
+    unsigned long valueCount;
+    if (!readValue(stream, module, phi) || !phi || !(stream >> valueCount) ||
+        exprs.size() < valueCount)
+      return 0;
+    std::vector<ref<Expr> > &values = phiValues[phi];
+    values.insert(values.end(), exprs.begin(), exprs.begin() + valueCount);
+    exprs.erase(exprs.begin(), exprs.begin() + valueCount);
+  }
+
+  TxSubsumptionTableEntry *entry = new TxSubsumptionTableEntry(
+      reinterpret_cast<uintptr_t>(programPoint),
+      reinterpret_cast<uintptr_t>(prevProgramPoint), callHistory, interpolant,
+      existentials);
+  entry->phiValues = phiValues;
+  if (!readStore(stream, module, exprs, entry->concretelyAddressedStore) ||
+      !readStore(stream, module, exprs, entry->symbolicallyAddressedStore) ||
+      !readStore(stream, module, exprs,
+                 entry->concretelyAddressedHistoricalStore) ||
+      !readStore(stream, module, exprs,
+                 entry->symbolicallyAddressedHistoricalStore)) {
+    delete entry;
+    return 0;
+  }
+  return entry;
+}
+
+void TxInterpolantDatabase::writeInstruction(
+    std::ostream &stream, llvm::Instruction *inst,
+    std::map<llvm::Instruction *, std::string> &idCache) {
+  if (!inst) {
+    stream << " - 0 0";
+    return;
+  }
+
+  std::map<llvm::Instruction *, std::string>::iterator cached =
+      idCache.find(inst);
+  if (cached != idCache.end()) {
+    stream << cached->second;
+    return;
+  }
+
+  llvm::BasicBlock *bb = inst->getParent();
+  llvm::Function *f = bb->getParent();
+
+  unsigned blockIndex = 0;
+  for (llvm::Function::iterator it = f->begin(); &(*it) != bb; ++it)
+    ++blockIndex;
+
+  unsigned instIndex = 0;
+  for (llvm::BasicBlock::iterator it = bb->begin(); &(*it) != inst; ++it)
+    ++instIndex;
+
+  std::ostringstream id;
+  id << " " << f->getName().str() << " " << blockIndex << " " << instIndex;
+  idCache[inst] = id.str();
+  stream << id.str();
+}
+
+bool TxInterpolantDatabase::readInstruction(std::istream &stream,
+                                            llvm::Module *module,
+                                            llvm::Instruction *&inst) {
+  std::string functionName;
+  unsigned blockIndex, instIndex;
+  if (!(stream >> functionName >> blockIndex >> instIndex))
+    return false;
+
+  inst = 0;
+  if (functionName == "-")
+    return true;
+
+  llvm::Function *f = module->getFunction(functionName);
+  if (!f)
+    return false;
+
+  llvm::Function::iterator bit = f->begin(), bie = f->end();
+  for (; bit != bie && blockIndex > 0; ++bit)
+    --blockIndex;
+  if (bit == bie)
+    return false;
+
+  llvm::BasicBlock::iterator it = bit->begin(), ie = bit->end();
+  for (; it != ie && instIndex > 0; ++it)
+    --instIndex;
+  if (it == ie)
+    return false;
+
+  inst = &(*it);
+  return true;
+}
+
+bool TxInterpolantDatabase::writeValue(
+    std::ostream &stream, llvm::Value *value,
+    std::map<llvm::Instruction *, std::string> &idCache) {
+  if (!value) {
+    stream << " -";
+  } else if (llvm::Instruction *inst =
+                 llvm::dyn_cast<llvm::Instruction>(value)) {
+    stream << " i";
+    writeInstruction(stream, inst, idCache);
+  } else if (llvm::GlobalValue *global =
+                 llvm::dyn_cast<llvm::GlobalValue>(value)) {
+    if (!global->hasName())
+      return false;
+    stream << " g " << global->getName().str();
+  } else if (llvm::Argument *arg = llvm::dyn_cast<llvm::Argument>(value)) {
+    stream << " a " << arg->getParent()->getName().str() << " "
+           << arg->getArgNo();
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool TxInterpolantDatabase::readValue(std::istream &stream,
+                                      llvm::Module *module,
+                                      llvm::Value *&value) {
+  std::string kind;
+  if (!(stream >> kind))
+    return false;
+
+  value = 0;
+  if (kind == "-")
+    return true;
+
+  if (kind == "i") {
+    llvm::Instruction *inst;
+    if (!readInstruction(stream, module, inst) || !inst)
+      return false;
+    value = inst;
+    return true;
+  }
+
+  std::string name;
+  if (!(stream >> name))
+    return false;
+
+  if (kind == "g") {
+    value = module->getNamedValue(name);
+    return value != 0;
+  }
+
+  unsigned argNo;
+  llvm::Function *f = module->getFunction(name);
+  if (kind != "a" || !(stream >> argNo) || !f || argNo >= f->arg_size())
+    return false;
+  llvm::Function::arg_iterator it = f->arg_begin();
+  for (; argNo > 0; --argNo)
+    ++it;
+  value = &(*it);
+  return true;
+}
+
+void TxInterpolantDatabase::writeCallHistory(
+    std::ostream &stream, const TxCallHistory *callHistory,
+    std::map<llvm::Instruction *, std::string> &idCache) {
+  std::vector<llvm::Instruction *> sites;
+  callHistory->getCallSites(sites);
+  stream << " " << sites.size();
+  for (std::vector<llvm::Instruction *>::const_iterator it = sites.begin(),
+                                                        ie = sites.end();
+       it != ie; ++it) {
+    writeInstruction(stream, *it, idCache);
+  }
+}
+
+bool TxInterpolantDatabase::readCallHistory(std::istream &stream,
+                                            llvm::Module *module,
+                                            const TxCallHistory *&callHistory) {
+  unsigned long callCount;
+  if (!(stream >> callCount))
+    return false;
+
+  callHistory = TxCallHistory::getEmpty();
+  for (unsigned long i = 0; i < callCount; ++i) {
+    llvm::Instruction *site;
+    if (!readInstruction(stream, module, site) || !site)
+      return false;
+    callHistory = callHistory->push(site);
+  }
+  return true;
+}
+
+bool TxInterpolantDatabase::writeAllocation(
+    std::ostream &stream, ref<TxAllocationInfo> allocInfo,
+    std::map<llvm::Instruction *, std::string> &idCache,
+    std::vector<ref<Expr> > &exprs) {
+  ref<TxAllocationContext> context = allocInfo->getContext();
+  if (!context->getValue() ||
+      !writeValue(stream, context->getValue(), idCache))
+    return false;
+  writeCallHistory(stream, context->getCallHistory(), idCache);
+  stream << " " << allocInfo->getSize();
+  exprs.push_back(allocInfo->getBase());
+  return true;
+}
+
+bool TxInterpolantDatabase::readAllocation(std::istream &stream,
+                                           llvm::Module *module,
+                                           std::deque<ref<Expr> > &exprs,
+                                           ref<TxAllocationInfo> &allocInfo) {
+  llvm::Value *site;
+  const TxCallHistory *callHistory;
+  uint64_t size;
+  if (!readValue(stream, module, site) || !site ||
+      !readCallHistory(stream, module, callHistory) || !(stream >> size) ||
+      exprs.empty())
+    return false;
+
+  ref<TxAllocationContext> context =
+      TxAllocationContext::create(site, callHistory);
+  allocInfo = TxAllocationInfo::create(context, exprs.front(), size);
+  exprs.pop_front();
+  return true;
+}
+
+bool TxInterpolantDatabase::writeStore(
+    std::ostream &stream, const TxStore::LowerInterpolantStore &store,
+    std::map<llvm::Instruction *, std::string> &idCache,
+    std::vector<ref<Expr> > &exprs) {
+  stream << " " << store.size();
+  for (TxStore::LowerInterpolantStore::const_iterator it = store.begin(),
+                                                      ie = store.end();
+       it != ie; ++it) {
+    ref<TxInterpolantValue> value = it->second;
+    if (!writeAllocation(stream, it->first->getAllocationInfo(), idCache,
+                         exprs) ||
+        !writeValue(stream, value->getValue(), idCache))
+      return false;
+    exprs.push_back(it->first->getOffset());
+    exprs.push_back(value->getExpression());
+    stream << " " << !value->useBound();
+
+    const std::map<ref<TxAllocationInfo>, std::set<uint64_t> > &bounds =
+        value->getAllocationBounds();
+    stream << " " << bounds.size();
+    for (std::map<ref<TxAllocationInfo>, std::set<uint64_t> >::const_iterator
+             it1 = bounds.begin(),
+             ie1 = bounds.end();
+         it1 != ie1; ++it1) {
+      if (!writeAllocation(stream, it1->first, idCache, exprs))
+        return false;
+      stream << " " << it1->second.size();
+      for (std::set<uint64_t>::const_iterator it2 = it1->second.begin(),
+                                              ie2 = it1->second.end();
+           it2 != ie2; ++it2) {
+        stream << " " << *it2;
+      }
+    }
+
+    const std::map<ref<TxAllocationInfo>, std::set<ref<Expr> > > &offsets =
+        value->getAllocationOffsets();
+    stream << " " << offsets.size();
+    for (std::map<ref<TxAllocationInfo>,
+                  std::set<ref<Expr> > >::const_iterator it1 = offsets.begin(),
+                                                         ie1 = offsets.end();
+         it1 != ie1; ++it1) {
+      if (!writeAllocation(stream, it1->first, idCache, exprs))
+        return false;
+      stream << " " << it1->second.size();
+      exprs.insert(exprs.end(), it1->second.begin(), it1->second.end());
+    }
+  }
+  return true;
+}
+
+bool TxInterpolantDatabase::readStore(std::istream &stream,
+                                      llvm::Module *module,
+                                      std::deque<ref<Expr> > &exprs,
+                                      TxStore::LowerInterpolantStore &store) {
+  unsigned long variableCount;
+  if (!(stream >> variableCount))
+    return false;
+
+  for (unsigned long i = 0; i < variableCount; ++i) {
+    ref<TxAllocationInfo> allocInfo;
+    llvm::Value *value;
+    bool doNotUseBound;
+    unsigned long boundCount, offsetCount;
+    if (!readAllocation(stream, module, exprs, allocInfo) ||
+        !readValue(stream, module, value) || exprs.size() < 2)
+      return false;
+    ref<TxVariable> variable = TxVariable::create(allocInfo, exprs[0]);
+    ref<Expr> expr = exprs[1];
+    exprs.erase(exprs.begin(), exprs.begin() + 2);
+
+    std::map<ref<TxAllocationInfo>, std::set<uint64_t> > bounds;
+    if (!(stream >> doNotUseBound >> boundCount))
+      return false;
+    for (unsigned long j = 0; j < boundCount; ++j) {
+      ref<TxAllocationInfo> boundAllocInfo;
+      unsigned long count;
+      if (!readAllocation(stream, module, exprs, boundAllocInfo) ||
+          !(stream >> count))
+        return false;
+      std::set<uint64_t> &boundSet = bounds[boundAllocInfo];
+      for (unsigned long k = 0; k < count; ++k) {
+        uint64_t bound;
+        if (!(stream >> bound))
+          return false;
+        boundSet.insert(bound);
+      }
+    }
+
+    std::map<ref<TxAllocationInfo>, std::set<ref<Expr> > > offsets;
+    if (!(stream >> offsetCount))
+      return false;
+    for (unsigned long j = 0; j < offsetCount; ++j) {
+      ref<TxAllocationInfo> offsetAllocInfo;
+      unsigned long count;
+      if (!readAllocation(stream, module, exprs, offsetAllocInfo) ||
+          !(stream >> count) || exprs.size() < count)
+        return false;
+      offsets[offsetAllocInfo].insert(exprs.begin(), exprs.begin() + count);
+      exprs.erase(exprs.begin(), exprs.begin() + count);
+    }
+
+    store[variable] = TxInterpolantValue::create(value, expr, doNotUseBound,
+                                                 bounds, offsets);
+  }
+  return true;
+}
+
+bool TxInterpolantDatabase::writeStore(
+    std::ostream &stream, const TxStore::TopInterpolantStore &store,
+    std::map<llvm::Instruction *, std::string> &idCache,
+    std::vector<ref<Expr> > &exprs) {
+  stream << " " << store.size();
+  for (TxStore::TopInterpolantStore::const_iterator it = store.begin(),
+                                                    ie = store.end();
+       it != ie; ++it) {
+    if (!it->first->getValue() ||
+        !writeValue(stream, it->first->getValue(), idCache))
+      return false;
+    writeCallHistory(stream, it->first->getCallHistory(), idCache);
+    if (!writeStore(stream, it->second, idCache, exprs))
+      return false;
+  }
+  return true;
+}
+
+bool TxInterpolantDatabase::readStore(std::istream &stream,
+                                      llvm::Module *module,
+                                      std::deque<ref<Expr> > &exprs,
+                                      TxStore::TopInterpolantStore &store) {
+  unsigned long contextCount;
+  if (!(stream >> contextCount))
+    return false;
+
+  for (unsigned long i = 0; i < contextCount; ++i) {
+    llvm::Value *site;
+    const TxCallHistory *callHistory;
+    TxStore::LowerInterpolantStore lowerStore;
+    if (!readValue(stream, module, site) || !site ||
+        !readCallHistory(stream, module, callHistory) ||
+        !readStore(stream, module, exprs, lowerStore) || lowerStore.empty())
+      return false;
+    store[TxAllocationContext::create(site, callHistory)] = lowerStore;
+  }
+  return true;
+}
+
+void TxInterpolantDatabase::save(const std::string &fileName,
+                                 llvm::Module *module) {
+  std::ofstream out(fileName.c_str());
+  if (!out) {
+    klee_warning("unable to write interpolant database %s", fileName.c_str());
+    return;
+  }
+
+  // The header line of each entry and the expressions it mentions
+  std::map<llvm::Instruction *, std::string> idCache;
+  std::vector<TxSubsumptionTableEntry *> saved;
+  std::vector<std::vector<ref<Expr> > > savedExprs;
+  std::string headers;
+  for (std::list<TxSubsumptionTableEntry *>::const_iterator
+           it = TxSubsumptionTable::evictionQueue.begin(),
+           ie = TxSubsumptionTable::evictionQueue.end();
+       it != ie; ++it) {
+    std::ostringstream header;
+    std::vector<ref<Expr> > exprs;
+    if (!writeEntry(header, *it, idCache, exprs))
+      continue;
+    header << "\n";
+    headers += header.str();
+    saved.push_back(*it);
+    savedExprs.push_back(exprs);
+  }
+
+  unsigned long skipped =
+      TxSubsumptionTable::evictionQueue.size() - saved.size();
+  if (skipped) {
+    klee_message("Skipped %lu subsumption table entries with global markings, "
+                 "weakest preconditions or values without stable identifiers, "
+                 "which are not saved",
+                 skipped);
+  }
+
+  out << "txdb " << version << " " << hashModule(module) << "\n";
+  out << saved.size() << "\n";
+  out << headers;
+
+  // The expressions of the entries, in the same order as the headers
+  std::string queries;
+  llvm::raw_string_ostream stream(queries);
+  ConstraintManager noConstraints;
+  ref<Expr> falseExpr = ConstantExpr::alloc(0, Expr::Bool);
+  for (unsigned i = 0; i < saved.size(); ++i) {
+    std::vector<const Array *> existentials(saved[i]->existentials.begin(),
+                                            saved[i]->existentials.end());
+    const std::vector<ref<Expr> > &exprs = savedExprs[i];
+    ExprPPrinter::printQuery(
+        stream, noConstraints, falseExpr, exprs.empty() ? 0 : &exprs[0],
+        exprs.empty() ? 0 : &exprs[0] + exprs.size(),
+        existentials.empty() ? 0 : &existentials[0],
+        existentials.empty() ? 0 : &existentials[0] + existentials.size());
+  }
+  out << stream.str();
+
+  unsigned long withStores = 0;
+  for (std::vector<TxSubsumptionTableEntry *>::const_iterator
+           it = saved.begin(),
+           ie = saved.end();
+       it != ie; ++it) {
+    if (hasStores(*it))
+      ++withStores;
+  }
+  klee_message("Saved %lu of %lu subsumption table entries (%lu with stores) "
+               "to %s",
+               (unsigned long)saved.size(),
+               (unsigned long)TxSubsumptionTable::evictionQueue.size(),
+               withStores, fileName.c_str());
+}
+
+bool TxInterpolantDatabase::load(const std::string &fileName,
+                                 llvm::Module *module,
+                                 ArrayCache &arrayCache) {
+  std::ifstream in(fileName.c_str());
+  if (!in) {
+    klee_warning("unable to read interpolant database %s", fileName.c_str());
+    return false;
+  }
+
+  std::string magic;
+  unsigned fileVersion;
+  uint64_t moduleHash;
+  if (!(in >> magic >> fileVersion >> moduleHash) || magic != "txdb" ||
+      fileVersion != version) {
+    klee_warning("%s is not an interpolant database of this version",
+                 fileName.c_str());
+    return false;
+  }
+  if (moduleHash != hashModule(module)) {
+    klee_warning("interpolant database %s was saved for a different module, "
+                 "ignoring",
+                 fileName.c_str());
+    return false;
+  }
+
+  unsigned long entryCount;
+  if (!(in >> entryCount)) {
+    klee_warning("malformed interpolant database %s", fileName.c_str());
+    return false;
+  }
+
+  // The header of each entry takes one line, which is parsed once the
+  // expressions it mentions are
+  std::vector<std::string> headers(entryCount);
+  in >> std::ws;
+  for (unsigned long i = 0; i < entryCount; ++i) {
+    if (!std::getline(in, headers[i])) {
+      klee_warning("malformed interpolant database %s", fileName.c_str());
+      return false;
+    }
+  }
+
+  // The rest of the file consists of the expressions of the entries in KQuery
+  // format
+  std::string queries((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+#if LLVM_VERSION_CODE < LLVM_VERSION(3, 5)
+  llvm::MemoryBuffer *buffer =
+      llvm::MemoryBuffer::getMemBufferCopy(queries, fileName);
+#else
+  llvm::MemoryBuffer *buffer =
+      llvm::MemoryBuffer::getMemBufferCopy(queries, fileName).release();
+#endif
+  ExprBuilder *builder = createDefaultExprBuilder();
+  expr::Parser *parser = expr::Parser::Create(fileName, buffer, builder, true);
+
+  std::vector<TxSubsumptionTableEntry *> loaded;
+  std::vector<expr::Decl *> decls;
+  ArrayRebinder rebinder(arrayCache);
+  while (loaded.size() < entryCount) {
+    expr::Decl *decl = parser->ParseTopLevelDecl();
+    if (!decl || parser->GetNumErrors())
+      break;
+    decls.push_back(decl);
+
+    expr::QueryCommand *query = llvm::dyn_cast<expr::QueryCommand>(decl);
+    if (!query)
+      continue;
+
+    std::deque<ref<Expr> > exprs;
+    for (std::vector<ref<Expr> >::const_iterator it = query->Values.begin(),
+                                                 ie = query->Values.end();
+         it != ie; ++it) {
+      exprs.push_back(rebinder.visit(*it));
+    }
+    std::set<const Array *> existentials;
+    for (std::vector<const Array *>::const_iterator
+             it = query->Objects.begin(),
+             ie = query->Objects.end();
+         it != ie; ++it) {
+      existentials.insert(rebinder.rebind(*it));
+    }
+
+    std::istringstream header(headers[loaded.size()]);
+    TxSubsumptionTableEntry *entry =
+        readEntry(header, module, exprs, existentials);
+    if (!entry || !exprs.empty()) {
+      delete entry;
+      break;
+    }
+    loaded.push_back(entry);
+  }
+
+  bool success = !parser->GetNumErrors() && loaded.size() == entryCount;
+
+  for (std::vector<expr::Decl *>::iterator it = decls.begin(),
+                                           ie = decls.end();
+       it != ie; ++it) {
+    delete *it;
+  }
+  delete builder;
+
+  if (!success) {
+    for (std::vector<TxSubsumptionTableEntry *>::iterator
+             it = loaded.begin(),
+             ie = loaded.end();
+         it != ie; ++it) {
+      delete *it;
+    }
+    delete parser;
+    delete buffer;
+    klee_warning("malformed interpolant database %s", fileName.c_str());
+    return false;
+  }
+
+  // The parser owns the constant arrays of the interpolants
+  parsers.push_back(parser);
+  buffers.push_back(buffer);
+
+  unsigned long withStores = 0;
+  for (std::vector<TxSubsumptionTableEntry *>::iterator it = loaded.begin(),
+                                                        ie = loaded.end();
+       it != ie; ++it) {
+    if (hasStores(*it))
+      ++withStores;
+    TxSubsumptionTable::insert((*it)->programPoint, (*it)->callHistory, *it);
+  }
+
+  klee_message("Loaded %lu subsumption table entries (%lu with stores) from %s",
+               (unsigned long)loaded.size(), withStores, fileName.c_str());
+  return true;
+}
+
+void TxInterpolantDatabase::deallocate() {
+  for (std::vector<expr::Parser *>::iterator it = parsers.begin(),
+                                             ie = parsers.end();
+       it != ie; ++it) {
+    delete *it;
+  }
+  parsers.clear();
+
+  for (std::vector<llvm::MemoryBuffer *>::iterator it = buffers.begin(),
+                                                   ie = buffers.end();
+       it != ie; ++it) {
+    delete *it;
+  }
+  buffers.clear();
+}
@@ -0,0 +1,180 @@
+//===-- TxInterpolantDatabase.h - Persistent subsumption table --*- C++ -*-===//
+//
+//               The Tracer-X KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the declarations of the class for saving the subsumption
+/// table into a file and preloading it in a later run on the same module.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_TXINTERPOLANTDATABASE_H
+#define KLEE_TXINTERPOLANTDATABASE_H
+
+#include "TxStore.h"
+
+#include "klee/Config/Version.h"
+#include "klee/Expr.h"
+
+#if LLVM_VERSION_CODE >= LLVM_VERSION(3, 3)
+#include <llvm/IR/Instruction.h>
+#include <llvm/IR/Module.h>
+#else
+#include <llvm/Instruction.h>
+#include <llvm/Module.h>
+#endif
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <deque>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace klee {
+
+namespace expr {
+class Parser;
+}
+
+class ArrayCache;
+
+class TxSubsumptionTableEntry;
+
+/// \brief The interpolant database: a file of subsumption table entries.
+///
+/// Program points, call sites and the other LLVM values mentioned by an entry
+/// are identified by the name of their function and the indices of their
+/// basic block and instruction, or by their name in case of globals, which
+/// are stable across runs on the same module. The store entries are keyed by
+/// the allocation site and call history of their allocation. The
+/// interpolants, the expressions of the stores and the existentially
+/// quantified arrays are written as KQuery queries, one per entry. The
+/// database records a hash of the module, and a database of a different module
+/// is rejected when loading.
+///
+/// Entries with global markings or weakest precondition are not saved, since
+/// they refer to the state of a run, and so are entries mentioning a value
+/// that has no stable identifier.
+class TxInterpolantDatabase {
+  static const unsigned version = 2;
+
+  /// \brief The parsers of the loaded databases, which own the constant
+  /// arrays of the loaded interpolants
+  static std::vector<expr::Parser *> parsers;
+
+  /// \brief The buffers parsed by the parsers
+  static std::vector<llvm::MemoryBuffer *> buffers;
+
+  /// \brief Tests if the entry has a non-empty store
+  static bool hasStores(const TxSubsumptionTableEntry *entry);
+
+  /// \brief Write the header line of an entry, and collect the expressions of
+  /// the entry in the order they are mentioned in the header.
+  ///
+  /// \return false if the entry cannot be saved into the database, true
+  /// otherwise.
+  static bool writeEntry(std::ostream &stream,
+                         const TxSubsumptionTableEntry *entry,
+                         std::map<llvm::Instruction *, std::string> &idCache,
+                         std::vector<ref<Expr> > &exprs);
+
+  /// \brief Create an entry from its header line written by writeEntry and
+  /// its expressions
+  ///
+  /// \return the entry, or null if the header is malformed.
+  static TxSubsumptionTableEntry *
+  readEntry(std::istream &stream, llvm::Module *module,
+            std::deque<ref<Expr> > &exprs,
+            const std::set<const Array *> &existentials);
+
+  /// \brief Write the stable identifier of an instruction, or "-" for null
+  static void
+  writeInstruction(std::ostream &stream, llvm::Instruction *inst,
+                   std::map<llvm::Instruction *, std::string> &idCache);
+
+  /// \brief Read a stable instruction identifier written by writeInstruction
+  ///
+  /// \return false if the identifier is malformed or the instruction does not
+  /// exist in the module, true otherwise.
+  static bool readInstruction(std::istream &stream, llvm::Module *module,
+                              llvm::Instruction *&inst);
+
+  /// \brief Write the stable identifier of an instruction, a global, a
+  /// function argument or null
+  ///
+  /// \return false if the value has no stable identifier, true otherwise.
+  static bool writeValue(std::ostream &stream, llvm::Value *value,
+                         std::map<llvm::Instruction *, std::string> &idCache);
+
+  /// \brief Read a stable value identifier written by writeValue
+  static bool readValue(std::istream &stream, llvm::Module *module,
+                        llvm::Value *&value);
+
+  static void
+  writeCallHistory(std::ostream &stream, const TxCallHistory *callHistory,
+                   std::map<llvm::Instruction *, std::string> &idCache);
+
+  static bool readCallHistory(std::istream &stream, llvm::Module *module,
+                              const TxCallHistory *&callHistory);
+
+  /// \brief Write an allocation: its allocation site, call history and size.
+  /// The base address is collected into the expressions.
+  static bool
+  writeAllocation(std::ostream &stream, ref<TxAllocationInfo> allocInfo,
+                  std::map<llvm::Instruction *, std::string> &idCache,
+                  std::vector<ref<Expr> > &exprs);
+
+  static bool readAllocation(std::istream &stream, llvm::Module *module,
+                             std::deque<ref<Expr> > &exprs,
+                             ref<TxAllocationInfo> &allocInfo);
+
+  /// \brief Write a store, as a sequence of variables, each of an allocation
+  /// and an offset expression, and their values, each of an LLVM value, an
+  /// expression, and the offsets and offset bounds of a pointer value.
+  static bool
+  writeStore(std::ostream &stream, const TxStore::LowerInterpolantStore &store,
+             std::map<llvm::Instruction *, std::string> &idCache,
+             std::vector<ref<Expr> > &exprs);
+
+  static bool readStore(std::istream &stream, llvm::Module *module,
+                        std::deque<ref<Expr> > &exprs,
+                        TxStore::LowerInterpolantStore &store);
+
+  /// \brief Write a store of allocation contexts to stores
+  static bool
+  writeStore(std::ostream &stream, const TxStore::TopInterpolantStore &store,
+             std::map<llvm::Instruction *, std::string> &idCache,
+             std::vector<ref<Expr> > &exprs);
+
+  static bool readStore(std::istream &stream, llvm::Module *module,
+                        std::deque<ref<Expr> > &exprs,
+                        TxStore::TopInterpolantStore &store);
+
+public:
+  /// \brief Save the current subsumption table into a file.
+  static void save(const std::string &fileName, llvm::Module *module);
+
+  /// \brief Load the entries of a file into the subsumption table.
+  ///
+  /// The symbolic arrays of the interpolants are created in the array cache
+  /// of the run, such that they are the arrays later made symbolic by the run.
+  ///
+  /// \return true if the database was loaded, false if it is missing,
+  /// malformed, or saved for a different module.
+  static bool load(const std::string &fileName, llvm::Module *module,
+                   ArrayCache &arrayCache);
+
+  /// \brief Release the arrays of the loaded interpolants. This should be
+  /// called after the subsumption table is cleared.
+  static void deallocate();
+};
+}
+
+#endif
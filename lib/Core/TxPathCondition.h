@@ -17,6 +17,8 @@
 #define KLEE_TXPATHCONDITION_H
 
 #include "klee/Constraints.h"
+#include "klee/Internal/ADT/ImmutableMap.h"
+#include "klee/Internal/ADT/TxSlabAllocator.h"
 #include "klee/util/TxPrintUtil.h"
 #include "klee/Internal/Module/TxValues.h"
 
@@ -28,6 +30,9 @@ public:
   unsigned refCount;
 
 private:
+  /// \brief The slab allocator of the objects of this class
+  static TxSlabAllocator<TxPCConstraint> allocator;
+
   /// \brief KLEE expression
   ref<Expr> constraint;
 
@@ -54,6 +59,12 @@ public:
 
   ~TxPCConstraint();
 
+  static void *operator new(size_t size) { return allocator.allocate(size); }
+
+  static void operator delete(void *p, size_t size) {
+    allocator.deallocate(p, size);
+  }
+
   ref<Expr> packInterpolant(std::set<const Array *> &replacements);
 
   uint64_t getDepth() const { return depth; }
@@ -66,8 +77,14 @@ public:
 };
 
 class TxPathCondition {
-  /// \brief The path condition, with the levels each one is introduced
-  std::map<ref<Expr>, ref<TxPCConstraint> > pcDepth;
+  /// \brief The slab allocator of the objects of this class
+  static TxSlabAllocator<TxPathCondition> allocator;
+
+  typedef ImmutableMap<ref<Expr>, ref<TxPCConstraint> > PCDepthMap;
+
+  /// \brief The path condition, with the levels each one is introduced. This
+  /// is a persistent map shared with the parent path condition.
+  PCDepthMap pcDepth;
 
   /// \brief Store elements used by left path
   std::set<ref<TxPCConstraint> > usedByLeftPath;
@@ -87,6 +104,12 @@ class TxPathCondition {
 public:
   ~TxPathCondition() {}
 
+  static void *operator new(size_t size) { return allocator.allocate(size); }
+
+  static void operator delete(void *p, size_t size) {
+    allocator.deallocate(p, size);
+  }
+
   static TxPathCondition *create(TxPathCondition *src) {
     TxPathCondition *ret = new TxPathCondition();
     if (!src) {
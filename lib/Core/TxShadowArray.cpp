@@ -16,23 +16,77 @@
 
 #include "TxShadowArray.h"
 
+#include <algorithm>
+
 using namespace klee;
 
 namespace klee {
 
 std::map<const Array *, const Array *> TxShadowArray::shadowArray;
 
-UpdateNode *
-TxShadowArray::getShadowUpdate(const UpdateNode *source,
-                             std::set<const Array *> &replacements) {
-  if (!source)
-    return 0;
+std::map<const Expr *, TxShadowArray::ShadowExpr> TxShadowArray::exprCache;
+
+std::map<const UpdateNode *, TxShadowArray::ShadowUpdate>
+TxShadowArray::updateCache;
+
+std::set<TxShadowArray::ArraySet> TxShadowArray::arraySets;
+
+const TxShadowArray::ArraySet *TxShadowArray::unite(const ArraySet *s1,
+                                                    const ArraySet *s2) {
+  if (!s1 || s1 == s2)
+    return s2;
+  if (!s2)
+    return s1;
+  if (std::includes(s1->begin(), s1->end(), s2->begin(), s2->end()))
+    return s1;
+  if (std::includes(s2->begin(), s2->end(), s1->begin(), s1->end()))
+    return s2;
 
-  return new UpdateNode(getShadowUpdate(source->next, replacements),
-                        getShadowExpression(source->index, replacements),
-                        getShadowExpression(source->value, replacements));
+  ArraySet u(*s1);
+  u.insert(s2->begin(), s2->end());
+  return &(*arraySets.insert(u).first);
 }
 
+UpdateList TxShadowArray::getShadowUpdate(const UpdateList &updates,
+                                          const ArraySet *&replacements) {
+  std::map<const Array *, const Array *>::const_iterator it =
+      shadowArray.find(updates.root);
+  const Array *replacementArray = it != shadowArray.end() ? it->second : 0;
+
+  // Collect the nodes up to the longest suffix already shadowed. This is
+  // iterative as update lists can be very long.
+  std::vector<const UpdateNode *> pending;
+  const UpdateNode *shadowHead = 0;
+  replacements = 0;
+  for (const UpdateNode *un = updates.head; un; un = un->next) {
+    std::map<const UpdateNode *, ShadowUpdate>::iterator cit =
+        updateCache.find(un);
+    if (cit != updateCache.end()) {
+      shadowHead = cit->second.shadow.head;
+      replacements = cit->second.replacements;
+      break;
+    }
+    pending.push_back(un);
+  }
+
+  for (std::vector<const UpdateNode *>::reverse_iterator
+           it = pending.rbegin(),
+           ie = pending.rend();
+       it != ie; ++it) {
+    const ArraySet *indexReplacements = 0, *valueReplacements = 0;
+    ref<Expr> index = getShadow((*it)->index, indexReplacements);
+    ref<Expr> value = getShadow((*it)->value, valueReplacements);
+    shadowHead = new UpdateNode(shadowHead, index, value);
+    replacements =
+        unite(unite(replacements, indexReplacements), valueReplacements);
+    updateCache.insert(std::make_pair(
+        *it, ShadowUpdate(UpdateList(updates.root, *it),
+                          UpdateList(replacementArray, shadowHead),
+                          replacements)));
+  }
+
+  return UpdateList(replacementArray, shadowHead);
+}
 ref<Expr> TxShadowArray::createBinaryOfSameKind(ref<Expr> originalExpr,
                                               ref<Expr> newLhs,
                                               ref<Expr> newRhs) {
@@ -51,55 +105,76 @@ void TxShadowArray::addShadowArrayMap(const Array *source, const Array *target)
 ref<Expr>
 TxShadowArray::getShadowExpression(ref<Expr> expr,
                                  std::set<const Array *> &replacements) {
+  if (exprCache.size() + updateCache.size() > maxCacheSize)
+    clearCache();
+
+  const ArraySet *shadowReplacements = 0;
+  ref<Expr> ret = getShadow(expr, shadowReplacements);
+  if (shadowReplacements)
+    replacements.insert(shadowReplacements->begin(),
+                        shadowReplacements->end());
+  return ret;
+}
+
+void TxShadowArray::clearCache() {
+  exprCache.clear();
+  updateCache.clear();
+  arraySets.clear();
+}
+
+ref<Expr> TxShadowArray::getShadow(ref<Expr> expr,
+                                   const ArraySet *&replacements) {
+  replacements = 0;
+  if (llvm::isa<ConstantExpr>(expr))
+    return expr;
+
+  std::map<const Expr *, ShadowExpr>::iterator cit = exprCache.find(expr.get());
+  if (cit != exprCache.end()) {
+    replacements = cit->second.replacements;
+    return cit->second.shadow;
+  }
+
   ref<Expr> ret;
+  const ArraySet *r0 = 0, *r1 = 0, *r2 = 0;
 
   switch (expr->getKind()) {
   case Expr::Read: {
     ReadExpr *readExpr = llvm::dyn_cast<ReadExpr>(expr);
-    const Array *replacementArray = shadowArray[readExpr->updates.root];
-
-    if (std::find(replacements.begin(), replacements.end(), replacementArray) ==
-        replacements.end()) {
-      replacements.insert(replacementArray);
-    }
-
-    UpdateList newUpdates(
-        replacementArray,
-        getShadowUpdate(readExpr->updates.head, replacements));
-    ret = ReadExpr::create(newUpdates,
-                           getShadowExpression(readExpr->index, replacements));
-    break;
-  }
-  case Expr::Constant: {
-    ret = expr;
+    UpdateList newUpdates = getShadowUpdate(readExpr->updates, r0);
+    ArraySet root;
+    root.insert(newUpdates.root);
+    r2 = &(*arraySets.insert(root).first);
+    ret = ReadExpr::create(newUpdates, getShadow(readExpr->index, r1));
     break;
   }
   case Expr::Select: {
-    ret =
-        SelectExpr::create(getShadowExpression(expr->getKid(0), replacements),
-                           getShadowExpression(expr->getKid(1), replacements),
-                           getShadowExpression(expr->getKid(2), replacements));
+    ret = SelectExpr::create(getShadow(expr->getKid(0), r0),
+                             getShadow(expr->getKid(1), r1),
+                             getShadow(expr->getKid(2), r2));
     break;
   }
   case Expr::Extract: {
     ExtractExpr *extractExpr = llvm::dyn_cast<ExtractExpr>(expr);
-    ret =
-        ExtractExpr::create(getShadowExpression(expr->getKid(0), replacements),
-                            extractExpr->offset, extractExpr->width);
+    ret = ExtractExpr::create(getShadow(expr->getKid(0), r0),
+                              extractExpr->offset, extractExpr->width);
     break;
   }
   case Expr::ZExt: {
     CastExpr *castExpr = llvm::dyn_cast<CastExpr>(expr);
-    ret = ZExtExpr::create(getShadowExpression(expr->getKid(0), replacements),
+    ret = ZExtExpr::create(getShadow(expr->getKid(0), r0),
                            castExpr->getWidth());
     break;
   }
   case Expr::SExt: {
     CastExpr *castExpr = llvm::dyn_cast<CastExpr>(expr);
-    ret = SExtExpr::create(getShadowExpression(expr->getKid(0), replacements),
+    ret = SExtExpr::create(getShadow(expr->getKid(0), r0),
                            castExpr->getWidth());
     break;
   }
+  case Expr::Not: {
+    ret = NotExpr::create(getShadow(expr->getKid(0), r0));
+    break;
+  }
   case Expr::Concat:
   case Expr::Add:
   case Expr::Sub:
@@ -108,7 +183,6 @@ TxShadowArray::getShadowExpression(ref<Expr> expr,
   case Expr::SDiv:
   case Expr::URem:
   case Expr::SRem:
-  case Expr::Not:
   case Expr::And:
   case Expr::Or:
   case Expr::Xor:
@@ -125,19 +199,24 @@ TxShadowArray::getShadowExpression(ref<Expr> expr,
   case Expr::Sle:
   case Expr::Sgt:
   case Expr::Sge: {
-    ret = createBinaryOfSameKind(
-        expr, getShadowExpression(expr->getKid(0), replacements),
-        getShadowExpression(expr->getKid(1), replacements));
+    ret = createBinaryOfSameKind(expr, getShadow(expr->getKid(0), r0),
+                                 getShadow(expr->getKid(1), r1));
     break;
   }
   case Expr::NotOptimized: {
-    ret = NotOptimizedExpr::create(getShadowExpression(expr->getKid(0), replacements));
+    ret = NotOptimizedExpr::create(getShadow(expr->getKid(0), r0));
     break;
   }
   default:
     assert(!"unhandled Expr type");
   }
 
+  replacements = unite(unite(r0, r1), r2);
+
+  ShadowExpr &entry = exprCache[expr.get()];
+  entry.source = expr;
+  entry.shadow = ret;
+  entry.replacements = replacements;
   return ret;
 }
 
@@ -23,11 +23,51 @@ namespace klee {
 
   /// \brief Implements the replacement mechanism for replacing variables, used in
   /// replacing free with bound variables.
+  ///
+  /// The shadow of an expression is computed once per run for each node of
+  /// the expression DAG and each node of the update lists, such that shared
+  /// subexpressions and update list suffixes are not rebuilt.
   class TxShadowArray {
+    typedef std::set<const Array *> ArraySet;
+
+    /// \brief The shadow of a node, together with the shadow arrays it
+    /// contains, or null if there is none.
+    struct ShadowExpr {
+      /// \brief The original node, referenced to keep the cache key alive
+      ref<Expr> source;
+      ref<Expr> shadow;
+      const ArraySet *replacements;
+    };
+
+    struct ShadowUpdate {
+      UpdateList source;
+      UpdateList shadow;
+      const ArraySet *replacements;
+
+      ShadowUpdate(const UpdateList &_source, const UpdateList &_shadow,
+                   const ArraySet *_replacements)
+          : source(_source), shadow(_shadow), replacements(_replacements) {}
+    };
+
+    /// \brief The maximum number of cached nodes, above which the caches are
+    /// cleared before the next shadowing
+    static const unsigned maxCacheSize = 100000;
+
     static std::map<const Array *, const Array *> shadowArray;
 
-    static UpdateNode *getShadowUpdate(const UpdateNode *chain,
-				       std::set<const Array *> &replacements);
+    static std::map<const Expr *, ShadowExpr> exprCache;
+
+    static std::map<const UpdateNode *, ShadowUpdate> updateCache;
+
+    /// \brief The distinct sets of shadow arrays, shared by the cache entries
+    static std::set<ArraySet> arraySets;
+
+    static const ArraySet *unite(const ArraySet *s1, const ArraySet *s2);
+
+    static UpdateList getShadowUpdate(const UpdateList &updates,
+                                      const ArraySet *&replacements);
+
+    static ref<Expr> getShadow(ref<Expr> expr, const ArraySet *&replacements);
 
   public:
     static ref<Expr> createBinaryOfSameKind(ref<Expr> originalExpr,
@@ -38,6 +78,9 @@ namespace klee {
     static ref<Expr> getShadowExpression(ref<Expr> expr,
 					 std::set<const Array *> &replacements);
 
+    /// \brief Release the cached shadow expressions
+    static void clearCache();
+
     static std::string getShadowName(std::string name) {
       return "__shadow__" + name;
     }
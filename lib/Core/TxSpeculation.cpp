@@ -15,58 +15,95 @@
 
 #include "TxSpeculation.h"
 
+#include "klee/Internal/Support/ModuleUtil.h"
+
 using namespace klee;
 
 std::string TxSpeculationHelper::WHITESPACE = " \n\r\t\f\v";
 
-bool TxSpeculationHelper::isStateSpeculable(ExecutionState &current) {
-  if (current.stack.back().kf->function->getName().substr(0, 5) == "klee_" ||
-      current.stack.back().kf->function->getName().substr(0, 3) == "tx_") {
-    return false;
-  }
+llvm::DenseMap<const llvm::BasicBlock *, TxSpeculationHelper::BlockProfile>
+TxSpeculationHelper::profiles;
 
-  if (isa<llvm::BranchInst>(current.prevPC->inst)) {
-    llvm::BranchInst *bi = dyn_cast<llvm::BranchInst>(current.prevPC->inst);
-    llvm::BasicBlock *bb = dyn_cast<llvm::BasicBlock>(bi->getOperand(1));
-    if (isa<llvm::CallInst>(bb->getInstList().front())) {
-      llvm::CallInst *ci = dyn_cast<llvm::CallInst>(&bb->getInstList().front());
-      std::string str;
-      llvm::raw_string_ostream os(str);
-      ci->getCalledValue()->print(os);
-      //      llvm::outs() << "os: " << os.str() << "\n";
-      //      llvm::outs() << "assert fail = " <<
-      //      (os.str().find("@__assert_fail") != std::string::npos) << "\n";
-      if (os.str().find("@__assert_fail") != std::string::npos) {
-        return false;
-      }
-    }
-  }
-  return true;
+std::map<std::string, unsigned> TxSpeculationHelper::variableIds;
+
+TxVariableSet TxSpeculationHelper::avoidance;
+
+unsigned TxSpeculationHelper::getVariableId(const std::string &name) {
+  std::map<std::string, unsigned>::iterator it = variableIds.find(name);
+  if (it != variableIds.end())
+    return it->second;
+
+  unsigned id = variableIds.size();
+  variableIds[name] = id;
+  return id;
 }
 
-bool TxSpeculationHelper::isOverlap(std::set<std::string> &s1,
-                                    std::set<std::string> &s2) {
-  for (std::set<std::string>::iterator it1 = s1.begin(), ie1 = s1.end();
-       it1 != ie1; ++it1) {
-    for (std::set<std::string>::iterator it2 = s2.begin(), ie2 = s2.end();
-         it2 != ie2; ++it2) {
-      if (*it1 == *it2) {
-        return true;
+void TxSpeculationHelper::buildProfiles(llvm::Module *module) {
+  profiles.clear();
+  for (llvm::Module::iterator f = module->begin(), fe = module->end(); f != fe;
+       ++f) {
+    for (llvm::Function::iterator bb = f->begin(), bbe = f->end(); bb != bbe;
+         ++bb) {
+      llvm::BranchInst *bi =
+          llvm::dyn_cast<llvm::BranchInst>(bb->getTerminator());
+      if (!bi)
+        continue;
+
+      BlockProfile &profile = profiles[&*bb];
+
+      // The false successor is the operand 1 of a conditional branch
+      if (bi->isConditional()) {
+        llvm::BasicBlock *succ =
+            llvm::dyn_cast<llvm::BasicBlock>(bi->getOperand(1));
+        if (llvm::CallInst *ci =
+                llvm::dyn_cast<llvm::CallInst>(&succ->front())) {
+          llvm::Value *callee = ci->getCalledValue()->stripPointerCasts();
+          profile.assertFailSuccessor =
+              llvm::isa<llvm::Function>(callee) &&
+              callee->getName() == "__assert_fail";
+        }
+      }
+
+      std::set<std::string> names;
+      collectVariableNames(bi, names);
+      for (std::set<std::string>::const_iterator it = names.begin(),
+                                                 ie = names.end();
+           it != ie; ++it) {
+        profile.variables.insert(getVariableId(*it));
       }
     }
   }
-  return false;
 }
 
-bool TxSpeculationHelper::isIndependent(
-    std::set<std::string> &vars,
-    std::map<int, std::set<std::string> > &avoidance) {
-  for (std::map<int, std::set<std::string> >::iterator it = avoidance.begin(),
-                                                       ie = avoidance.end();
+void TxSpeculationHelper::clearAvoidance() { avoidance = TxVariableSet(); }
+
+void TxSpeculationHelper::addAvoidance(const std::set<std::string> &variables) {
+  for (std::set<std::string>::const_iterator it = variables.begin(),
+                                             ie = variables.end();
        it != ie; ++it) {
-    if (isOverlap(it->second, vars)) {
+    avoidance.insert(getVariableId(*it));
+  }
+}
+
+bool TxSpeculationHelper::isStateSpeculable(ExecutionState &current) {
+  if (current.stack.back().kf->function->getName().substr(0, 5) == "klee_" ||
+      current.stack.back().kf->function->getName().substr(0, 3) == "tx_") {
+    return false;
+  }
+
+  if (llvm::isa<llvm::BranchInst>(current.prevPC->inst)) {
+    llvm::DenseMap<const llvm::BasicBlock *, BlockProfile>::const_iterator it =
+        profiles.find(current.prevPC->inst->getParent());
+    if (it != profiles.end() && it->second.assertFailSuccessor)
       return false;
-    }
   }
   return true;
 }
+
+bool TxSpeculationHelper::isIndependent(llvm::Instruction *branch) {
+  llvm::DenseMap<const llvm::BasicBlock *, BlockProfile>::const_iterator it =
+      profiles.find(branch->getParent());
+  if (it == profiles.end())
+    return true;
+  return !it->second.variables.intersects(avoidance);
+}
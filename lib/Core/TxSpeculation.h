@@ -18,25 +18,84 @@
 
 #include "klee/ExecutionState.h"
 #include "klee/Internal/Module/KModule.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
 #include <iostream>
 #include <map>
 #include <vector>
 
 namespace klee {
 
+/// \brief A set of variables, represented as a bitset over the ids of the
+/// variable names interned by TxSpeculationHelper
+class TxVariableSet {
+  std::vector<uint64_t> words;
+
+public:
+  void insert(unsigned id) {
+    unsigned word = id / 64;
+    if (word >= words.size())
+      words.resize(word + 1, 0);
+    words[word] |= ((uint64_t)1) << (id % 64);
+  }
+
+  bool intersects(const TxVariableSet &other) const {
+    unsigned size = std::min(words.size(), other.words.size());
+    for (unsigned i = 0; i < size; ++i) {
+      if (words[i] & other.words[i])
+        return true;
+    }
+    return false;
+  }
+};
+
 /// \brief Implements the speculation mode
 class TxSpeculationHelper {
+  /// \brief The speculation profile of a basic block terminated by a branch,
+  /// computed once for the module such that deciding speculation at a branch
+  /// does not allocate.
+  struct BlockProfile {
+    /// \brief The first instruction of the false successor is a call to
+    /// __assert_fail
+    bool assertFailSuccessor;
+
+    /// \brief The variables the branch condition depends on
+    TxVariableSet variables;
+
+    BlockProfile() : assertFailSuccessor(false) {}
+  };
+
+  static llvm::DenseMap<const llvm::BasicBlock *, BlockProfile> profiles;
+
+  /// \brief The ids of the interned variable names
+  static std::map<std::string, unsigned> variableIds;
+
+  /// \brief The union of the variables to avoid in all basic blocks
+  static TxVariableSet avoidance;
+
+  static unsigned getVariableId(const std::string &name);
+
 public:
   static std::string WHITESPACE;
-  static bool isStateSpeculable(ExecutionState &current);
 
-  static bool isIndependent(std::set<std::string> &vars,
-                            std::map<int, std::set<std::string> > &avoidance);
+  /// \brief Compute the speculation profiles of the basic blocks of the module
+  static void buildProfiles(llvm::Module *module);
+
+  /// \brief Clear the variables to avoid
+  static void clearAvoidance();
+
+  /// \brief Add to the variables to avoid, e.g., the dependency set of a
+  /// basic block
+  static void addAvoidance(const std::set<std::string> &variables);
+
+  static bool isStateSpeculable(ExecutionState &current);
 
-  static bool isOverlap(std::set<std::string> &s1, std::set<std::string> &s2);
+  /// \brief Tests if the condition of the branch does not depend on any of the
+  /// variables to avoid
+  static bool isIndependent(llvm::Instruction *branch);
 
   static std::string ltrim(const std::string &s) {
     size_t start = s.find_first_not_of(WHITESPACE);
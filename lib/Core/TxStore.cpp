@@ -24,6 +24,13 @@ using namespace klee;
 
 namespace klee {
 
+TxSlabAllocator<TxStore> TxStore::allocator("TxStore");
+
+uint64_t TxStore::allocatedSize = 0;
+
+// A rough per-node overhead of a map element
+static const uint64_t mapNodeSize = 4 * sizeof(void *);
+
 ref<TxStoreEntry>
 TxStore::MiddleStateStore::find(ref<TxStateAddress> loc) const {
   ref<TxStoreEntry> ret;
@@ -117,9 +124,11 @@ ref<TxStoreEntry> TxStore::MiddleStateStore::updateStore(
 
   ret = ref<TxStoreEntry>(new TxStoreEntry(loc, address, value, store, _depth));
   if (loc->hasConstantAddress()) {
-    concretelyAddressedStore[loc->getAsVariable()] = ret;
+    concretelyAddressedStore = concretelyAddressedStore.replace(
+        std::make_pair(loc->getAsVariable(), ret));
   } else {
-    symbolicallyAddressedStore[loc->getAsVariable()] = ret;
+    symbolicallyAddressedStore = symbolicallyAddressedStore.replace(
+        std::make_pair(loc->getAsVariable(), ret));
   }
   return ret;
 }
@@ -265,7 +274,7 @@ ref<TxStoreEntry> TxStore::find(ref<TxAllocationContext> alc,
 
 void TxStore::getStoredExpressions(
     const TxStore *referenceStore,
-    const std::vector<llvm::Instruction *> &callHistory,
+    const TxCallHistory *callHistory,
     const std::map<ref<Expr>, ref<Expr> > &substitution,
     std::set<const Array *> &replacements, bool coreOnly, bool leftRetrieval,
     TopStateStore &__internalStore,
@@ -278,7 +287,7 @@ void TxStore::getStoredExpressions(
 
 void TxStore::getStoredCoreExpressions(
     const TxStore *referenceStore,
-    const std::vector<llvm::Instruction *> &callHistory,
+    const TxCallHistory *callHistory,
     const std::map<ref<Expr>, ref<Expr> > &substitution,
     std::set<const Array *> &replacements, bool coreOnly, bool leftRetrieval,
     TopInterpolantStore &_concretelyAddressedStore,
@@ -305,8 +314,8 @@ TxStore::getAddressofLatestCopyLLVMValue(llvm::Value *val) {
       if (!foundValue) {
         address = temp;
         foundValue = true;
-      } else if (temp->getCallHistory().size() >
-                 address->getCallHistory().size()) {
+      } else if (temp->getCallHistory()->size() >
+                 address->getCallHistory()->size()) {
         address = temp;
       }
     }
@@ -408,7 +417,7 @@ inline void TxStore::symbolicToInterpolant(
 
 void TxStore::getConcreteStore(
     const TxStore *referenceStore,
-    const std::vector<llvm::Instruction *> &callHistory,
+    const TxCallHistory *callHistory,
     const std::map<ref<Expr>, ref<Expr> > &substitution,
     std::set<const Array *> &replacements, bool coreOnly, bool leftRetrieval,
     TopInterpolantStore &_concretelyAddressedStore,
@@ -463,7 +472,7 @@ void TxStore::getConcreteStore(
 
 void TxStore::getSymbolicStore(
     const TxStore *referenceStore,
-    const std::vector<llvm::Instruction *> &callHistory,
+    const TxCallHistory *callHistory,
     const std::map<ref<Expr>, ref<Expr> > &substitution,
     std::set<const Array *> &replacements, bool coreOnly, bool leftRetrieval,
     TopInterpolantStore &_symbolicallyAddressedStore,
@@ -515,8 +524,26 @@ void TxStore::getSymbolicStore(
   }
 }
 
+void TxStore::registerValue(TxValuesMap &valuesMap, llvm::Value *value,
+                            ref<TxStateValue> version) {
+  uint64_t mapSize = valuesMap.getMemorySize();
+  std::vector<ref<TxStateValue> > &versions = valuesMap[value];
+  uint64_t capacity = versions.capacity();
+  versions.push_back(version);
+  account(valuesMap.getMemorySize() - mapSize +
+          (versions.capacity() - capacity) * sizeof(ref<TxStateValue>));
+}
+
+void TxStore::accountUpdate() {
+  // The new entry, the element of the lower store which points to it, and the
+  // element of the top store which points to the lower store
+  account(sizeof(TxStoreEntry) + 2 * mapNodeSize +
+          sizeof(std::pair<ref<TxVariable>, ref<TxStoreEntry> >) +
+          sizeof(std::pair<ref<TxAllocationContext>, MiddleStateStore>));
+}
+
 void TxStore::updateStoreWithLoadedValue(
-    std::map<llvm::Value *, std::vector<ref<TxStateValue> > > &valuesMap,
+    TxValuesMap &valuesMap,
     ref<TxStateAddress> loc, ref<TxStateValue> address,
     ref<TxStateValue> value) {
   updateStore(valuesMap, loc, address, value);
@@ -524,7 +551,7 @@ void TxStore::updateStoreWithLoadedValue(
 }
 
 void TxStore::updateStore(
-    std::map<llvm::Value *, std::vector<ref<TxStateValue> > > &valuesMap,
+    TxValuesMap &valuesMap,
     ref<TxStateAddress> location, ref<TxStateValue> address,
     ref<TxStateValue> value) {
   if (location.isNull())
@@ -535,18 +562,22 @@ void TxStore::updateStore(
   markUsed(value->getAllowBoundEntryList());
   markUsed(value->getDisableBoundEntryList());
 
-  TopStateStore::iterator middleStoreIter =
-      internalStore.find(location->getContext());
+  const std::pair<ref<TxAllocationContext>, MiddleStateStore> *middleStorePair =
+      internalStore.lookup(location->getContext());
 
-  if (middleStoreIter != internalStore.end()) {
-    MiddleStateStore &middleStore = middleStoreIter->second;
+  if (middleStorePair) {
+    // The middle store may be shared with other nodes, hence we update a copy
+    MiddleStateStore middleStore(middleStorePair->second);
     if (middleStore.hasAllocationInfo(location->getAllocationInfo())) {
       if (value->getDepth() < depth) {
         value = value->copy(depth);
-        valuesMap[value->getValue()].push_back(value);
+        registerValue(valuesMap, value->getValue(), value);
       }
       ref<TxStoreEntry> entry =
           middleStore.updateStore(this, location, address, value, depth);
+      internalStore = internalStore.replace(
+          std::make_pair(location->getContext(), middleStore));
+      accountUpdate();
       if (!entry.isNull()) {
         // We want to renew the table entry list, so we first remove the old
         // ones
@@ -560,22 +591,35 @@ void TxStore::updateStore(
       return;
     }
 
-    // Here we save the old store
-    concretelyAddressedHistoricalStore.insert(middleStore.concreteBegin(),
-                                              middleStore.concreteEnd());
-    symbolicallyAddressedHistoricalStore.insert(middleStore.symbolicBegin(),
-                                                middleStore.symbolicEnd());
+    // Here we save the old store, keeping existing historical elements
+    for (LowerStateStore::const_iterator it = middleStore.concreteBegin(),
+                                         ie = middleStore.concreteEnd();
+         it != ie; ++it) {
+      concretelyAddressedHistoricalStore =
+          concretelyAddressedHistoricalStore.insert(*it);
+      account(mapNodeSize +
+              sizeof(std::pair<ref<TxVariable>, ref<TxStoreEntry> >));
+    }
+    for (LowerStateStore::const_iterator it = middleStore.symbolicBegin(),
+                                         ie = middleStore.symbolicEnd();
+         it != ie; ++it) {
+      symbolicallyAddressedHistoricalStore =
+          symbolicallyAddressedHistoricalStore.insert(*it);
+      account(mapNodeSize +
+              sizeof(std::pair<ref<TxVariable>, ref<TxStoreEntry> >));
+    }
   }
 
-  MiddleStateStore newMiddleStateStore(location->getAllocationInfo());
-  internalStore[location->getContext()] = newMiddleStateStore;
-  MiddleStateStore &middleStateStore = internalStore[location->getContext()];
+  MiddleStateStore middleStateStore(location->getAllocationInfo());
   if (value->getDepth() < depth) {
     value = value->copy(depth);
-    valuesMap[value->getValue()].push_back(value);
+    registerValue(valuesMap, value->getValue(), value);
   }
   ref<TxStoreEntry> entry =
       middleStateStore.updateStore(this, location, address, value, depth);
+  internalStore = internalStore.replace(
+      std::make_pair(location->getContext(), middleStateStore));
+  accountUpdate();
   if (!entry.isNull()) {
     // We associate this value with the store entry, signifying that the entry
     // is important whenever the value is used. This is used for computing the
@@ -610,6 +654,7 @@ void TxStore::markUsed(const std::set<ref<TxStoreEntry> > &entryList) {
             current->usedByLeftPath.find(*it);
         if (usedEntryIter == current->usedByLeftPath.end()) {
           current->usedByLeftPath.insert(*it);
+          current->account(mapNodeSize + sizeof(ref<TxStoreEntry>));
         } else {
           break;
         }
@@ -618,6 +663,7 @@ void TxStore::markUsed(const std::set<ref<TxStoreEntry> > &entryList) {
             current->usedByRightPath.find(*it);
         if (usedEntryIter == current->usedByRightPath.end()) {
           current->usedByRightPath.insert(*it);
+          current->account(mapNodeSize + sizeof(ref<TxStoreEntry>));
         } else {
           break;
         }
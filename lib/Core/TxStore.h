@@ -17,6 +17,8 @@
 #ifndef KLEE_TXSTORE_H
 #define KLEE_TXSTORE_H
 
+#include "klee/Internal/ADT/ImmutableMap.h"
+#include "klee/Internal/ADT/TxSlabAllocator.h"
 #include "klee/Internal/Module/TxValues.h"
 #include "klee/util/Ref.h"
 
@@ -25,6 +27,9 @@
 namespace klee {
 
 class TxStore {
+  /// \brief The slab allocator of the objects of this class
+  static TxSlabAllocator<TxStore> allocator;
+
 public:
   class MiddleStateStore;
 
@@ -32,8 +37,13 @@ public:
   LowerInterpolantStore;
   typedef std::map<ref<TxAllocationContext>, LowerInterpolantStore>
   TopInterpolantStore;
-  typedef std::map<ref<TxVariable>, ref<TxStoreEntry> > LowerStateStore;
-  typedef std::map<ref<TxAllocationContext>, MiddleStateStore> TopStateStore;
+
+  /// The state stores are persistent (structurally shared) maps, such that
+  /// creating the store of a child node is a constant-time operation, and an
+  /// update only allocates the path from the root to the updated element.
+  typedef ImmutableMap<ref<TxVariable>, ref<TxStoreEntry> > LowerStateStore;
+  typedef ImmutableMap<ref<TxAllocationContext>, MiddleStateStore>
+  TopStateStore;
 
   class MiddleStateStore {
   private:
@@ -49,12 +59,11 @@ public:
     MiddleStateStore(ref<TxAllocationInfo> _allocInfo)
         : allocInfo(_allocInfo) {}
 
-    /// \brief The copy constructor
-    MiddleStateStore(const MiddleStateStore &obj) {
-      concretelyAddressedStore = obj.concretelyAddressedStore;
-      symbolicallyAddressedStore = obj.symbolicallyAddressedStore;
-      allocInfo = obj.allocInfo;
-    }
+    /// \brief The copy constructor, which shares the underlying stores
+    MiddleStateStore(const MiddleStateStore &obj)
+        : concretelyAddressedStore(obj.concretelyAddressedStore),
+          symbolicallyAddressedStore(obj.symbolicallyAddressedStore),
+          allocInfo(obj.allocInfo) {}
 
     LowerStateStore::const_iterator concreteBegin() const {
       return concretelyAddressedStore.begin();
@@ -135,6 +144,23 @@ private:
   /// \brief The parent and left and right children of this store
   TxStore *parent, *left, *right;
 
+  /// \brief The approximate number of bytes allocated by the updates of this
+  /// store, not counting the parts shared with the parent store
+  uint64_t approximateSize;
+
+  /// \brief The sum of the approximate sizes of all live stores
+  static uint64_t allocatedSize;
+
+  /// \brief Add to the approximate size of this store
+  void account(uint64_t size) {
+    approximateSize += size;
+    allocatedSize += size;
+  }
+
+  /// \brief Account for the elements of the state stores allocated by an
+  /// update of #internalStore
+  void accountUpdate();
+
   void concreteToInterpolant(ref<TxVariable> variable, ref<TxStoreEntry> entry,
                              const std::map<ref<Expr>, ref<Expr> > &substition,
                              std::set<const Array *> &replacements,
@@ -149,7 +175,7 @@ private:
 
   void getConcreteStore(
       const TxStore *referenceStore,
-      const std::vector<llvm::Instruction *> &callHistory,
+      const TxCallHistory *callHistory,
       const std::map<ref<Expr>, ref<Expr> > &substitution,
       std::set<const Array *> &replacements, bool coreOnly, bool leftRetrieval,
       TopInterpolantStore &_concretelyAddressedStore,
@@ -157,7 +183,7 @@ private:
 
   void getSymbolicStore(
       const TxStore *referenceStore,
-      const std::vector<llvm::Instruction *> &callHistory,
+      const TxCallHistory *callHistory,
       const std::map<ref<Expr>, ref<Expr> > &substitution,
       std::set<const Array *> &replacements, bool coreOnly, bool leftRetrieval,
       TopInterpolantStore &_symbolicallyAddressedStore,
@@ -178,19 +204,34 @@ private:
                                 const std::string &reason, bool &boundUpdated);
 
   /// \brief Constructor for an empty store.
-  TxStore() : depth(0), parent(0), left(0), right(0) {}
+  TxStore() : depth(0), parent(0), left(0), right(0), approximateSize(0) {
+    account(sizeof(TxStore));
+  }
 
 public:
-  ~TxStore() {}
+  ~TxStore() { allocatedSize -= approximateSize; }
+
+  /// \brief The approximate number of bytes used by all live stores,
+  /// maintained as they are updated
+  static uint64_t getAllocatedSize() { return allocatedSize; }
+
+  /// \brief Append a version of an LLVM value to the versioned values of the
+  /// node of this store, accounting for the memory it takes with the store
+  void registerValue(TxValuesMap &valuesMap, llvm::Value *value,
+                     ref<TxStateValue> version);
+
+  static void *operator new(size_t size) { return allocator.allocate(size); }
+
+  static void operator delete(void *p, size_t size) {
+    allocator.deallocate(p, size);
+  }
 
   bool isInInternalStateStore(ref<TxAllocationContext> ctx) {
-    TopStateStore::iterator middleStoreIter = internalStore.find(ctx);
-    if (middleStoreIter == internalStore.end()) {
-      return false;
-    }
-    return true;
+    return internalStore.count(ctx);
   }
 
+  /// \brief Create the store of a child node. The stores of the parent are
+  /// shared and not copied.
   static TxStore *create(TxStore *src) {
     TxStore *ret = new TxStore();
     if (!src) {
@@ -240,7 +281,7 @@ public:
   /// of the store, otherwise, we assume it is requested by the right child of
   /// the store.
   void getStoredExpressions(
-      const TxStore *store, const std::vector<llvm::Instruction *> &callHistory,
+      const TxStore *store, const TxCallHistory *callHistory,
       const std::map<ref<Expr>, ref<Expr> > &substitution,
       std::set<const Array *> &replacements, bool coreOnly, bool leftRetrieval,
       TopStateStore &__internalStore,
@@ -263,7 +304,7 @@ public:
   /// of the store, otherwise, we assume it is requested by the right child of
   /// the store.
   void getStoredCoreExpressions(
-      const TxStore *store, const std::vector<llvm::Instruction *> &callHistory,
+      const TxStore *store, const TxCallHistory *callHistory,
       const std::map<ref<Expr>, ref<Expr> > &substitution,
       std::set<const Array *> &replacements, bool coreOnly, bool leftRetrieval,
       TopInterpolantStore &_concretelyAddressedStore,
@@ -276,13 +317,13 @@ public:
   /// \brief Newly relate a location with its stored value, when the value is
   /// loaded from the location
   void updateStoreWithLoadedValue(
-      std::map<llvm::Value *, std::vector<ref<TxStateValue> > > &valuesMap,
+      TxValuesMap &valuesMap,
       ref<TxStateAddress> loc, ref<TxStateValue> address,
       ref<TxStateValue> value);
 
   /// \brief Newly relate an location with its stored value
   void updateStore(
-      std::map<llvm::Value *, std::vector<ref<TxStateValue> > > &valuesMap,
+      TxValuesMap &valuesMap,
       ref<TxStateAddress> location, ref<TxStateValue> address,
       ref<TxStateValue> value);
 
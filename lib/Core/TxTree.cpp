@@ -20,6 +20,7 @@
 #include "TxDependency.h"
 #include "TxShadowArray.h"
 #include "Memory.h"
+#include <algorithm>
 #include <fstream>
 #include <klee/CommandLine.h>
 #include <klee/Expr.h>
@@ -27,6 +28,7 @@
 #include <klee/Solver.h>
 #include <klee/SolverStats.h>
 #include <klee/util/ExprPPrinter.h>
+#include <klee/util/ExprUtil.h>
 #include <klee/util/TxExprUtil.h>
 #include <klee/util/TxPrintUtil.h>
 #include <vector>
@@ -41,13 +43,13 @@
 
 using namespace klee;
 
-Statistic TxSubsumptionTableEntry::concretelyAddressedStoreExpressionBuildTime(
-    "concretelyAddressedStoreExpressionBuildTime", "concreteStoreTime");
-Statistic
+TxTimerStatistic
+TxSubsumptionTableEntry::concretelyAddressedStoreExpressionBuildTime(
+    "concretelyAddressedStoreExpressionBuildTime");
+TxTimerStatistic
 TxSubsumptionTableEntry::symbolicallyAddressedStoreExpressionBuildTime(
-    "symbolicallyAddressedStoreExpressionBuildTime", "symbolicStoreTime");
-Statistic TxSubsumptionTableEntry::solverAccessTime("solverAccessTime",
-                                                    "solverAccessTime");
+    "symbolicallyAddressedStoreExpressionBuildTime");
+TxTimerStatistic TxSubsumptionTableEntry::solverAccessTime("solverAccessTime");
 
 int debugSubsumptionLevel_g=0;
 void setDebugSubsumptionLevelTxTree(int debugSubsumptionLevel)
@@ -56,8 +58,9 @@ void setDebugSubsumptionLevelTxTree(int debugSubsumptionLevel)
 }
 
 TxSubsumptionTableEntry::TxSubsumptionTableEntry(
-    TxTreeNode *node, const std::vector<llvm::Instruction *> &callHistory)
-    : programPoint(node->getProgramPoint()),
+    TxTreeNode *node, const TxCallHistory *callHistory)
+    : callHistory(callHistory), attemptCount(0), hitCount(0), loaded(false),
+      approximateSize(0), container(0), programPoint(node->getProgramPoint()),
       nodeSequenceNumber(node->getNodeSequenceNumber()) {
   std::map<ref<Expr>, ref<Expr> > substitution;
   existentials.clear();
@@ -78,8 +81,184 @@ TxSubsumptionTableEntry::TxSubsumptionTableEntry(
     wpInterpolant = node->generateWPInterpolant();
 }
 
+TxSubsumptionTableEntry::TxSubsumptionTableEntry(
+    uintptr_t _programPoint, uintptr_t _prevProgramPoint,
+    const TxCallHistory *_callHistory, ref<Expr> _interpolant,
+    const std::set<const Array *> &_existentials)
+    : interpolant(_interpolant), existentials(_existentials),
+      callHistory(_callHistory), prevProgramPoint(_prevProgramPoint),
+      attemptCount(0), hitCount(0), loaded(true), approximateSize(0),
+      container(0), programPoint(_programPoint), nodeSequenceNumber(0) {}
+
 TxSubsumptionTableEntry::~TxSubsumptionTableEntry() {}
 
+#ifdef ENABLE_Z3
+Z3Solver *TxSubsumptionTableEntry::quantifiedQuerySolver = 0;
+
+void TxSubsumptionTableEntry::endQuantifiedQuerySession() {
+  if (quantifiedQuerySolver)
+    quantifiedQuerySolver->endSession();
+}
+
+void TxSubsumptionTableEntry::deleteQuantifiedQuerySolver() {
+  delete quantifiedQuerySolver;
+  quantifiedQuerySolver = 0;
+}
+#endif
+
+void TxSubsumptionTableEntry::Signature::addContext(
+    ref<TxAllocationContext> context) {
+  uint64_t h = reinterpret_cast<uintptr_t>(context->getValue());
+  h = h * 31 + context->getCallHistory()->getId();
+
+  // Mix the bits as pointers are aligned and close to each other
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+
+  const unsigned filterBits = FilterWords * 64;
+  unsigned bit1 = h % filterBits;
+  unsigned bit2 = (h >> 32) % filterBits;
+  contextFilter[bit1 / 64] |= (1ULL << (bit1 % 64));
+  contextFilter[bit2 / 64] |= (1ULL << (bit2 % 64));
+  ++contextCount;
+}
+
+TxSubsumptionTableEntry::Signature TxSubsumptionTableEntry::Signature::create(
+    ExecutionState &state, const TxStore::TopStateStore &__internalStore,
+    const TxStore::LowerStateStore &__concretelyAddressedHistoricalStore,
+    const TxStore::LowerStateStore &__symbolicallyAddressedHistoricalStore) {
+  Signature ret;
+  for (TxStore::TopStateStore::const_iterator it = __internalStore.begin(),
+                                              ie = __internalStore.end();
+       it != ie; ++it) {
+    ret.addContext(it->first);
+  }
+  ret.historicalCount = __concretelyAddressedHistoricalStore.size() +
+                        __symbolicallyAddressedHistoricalStore.size();
+  if (isa<llvm::PHINode>(state.pc->inst))
+    ret.prevProgramPoint = reinterpret_cast<uintptr_t>(state.prevPC->inst);
+  return ret;
+}
+
+bool TxSubsumptionTableEntry::Signature::mayMatch(
+    const Signature &stateSignature) const {
+  if (stateSignature.prevProgramPoint &&
+      stateSignature.prevProgramPoint != prevProgramPoint)
+    return false;
+
+  if (contextCount > stateSignature.contextCount ||
+      historicalCount > stateSignature.historicalCount)
+    return false;
+
+  for (unsigned i = 0; i < FilterWords; ++i) {
+    if (contextFilter[i] & ~stateSignature.contextFilter[i])
+      return false;
+  }
+  return true;
+}
+
+void TxSubsumptionTableEntry::computeSignature() {
+  signature = Signature();
+
+  // The concretely- and symbolically-addressed stores may share allocation
+  // contexts, which we count only once.
+  for (TxStore::TopInterpolantStore::const_iterator
+           it = concretelyAddressedStore.begin(),
+           ie = concretelyAddressedStore.end();
+       it != ie; ++it) {
+    signature.addContext(it->first);
+  }
+  for (TxStore::TopInterpolantStore::const_iterator
+           it = symbolicallyAddressedStore.begin(),
+           ie = symbolicallyAddressedStore.end();
+       it != ie; ++it) {
+    if (concretelyAddressedStore.find(it->first) ==
+        concretelyAddressedStore.end())
+      signature.addContext(it->first);
+  }
+
+  // Each historical element has to be found in either of the historical
+  // stores of the state, but the same variable may be in both of ours.
+  signature.historicalCount =
+      std::max(concretelyAddressedHistoricalStore.size(),
+               symbolicallyAddressedHistoricalStore.size());
+  signature.prevProgramPoint = prevProgramPoint;
+}
+
+uint64_t TxSubsumptionTableEntry::computeApproximateSize() const {
+  // A rough per-node overhead of a std::map element
+  const uint64_t mapNodeSize = 4 * sizeof(void *);
+  const uint64_t storeElementSize =
+      mapNodeSize + sizeof(ref<TxVariable>) + sizeof(ref<TxInterpolantValue>) +
+      sizeof(TxInterpolantValue);
+
+  uint64_t size = sizeof(TxSubsumptionTableEntry);
+
+  std::vector<ref<Expr> > worklist;
+  worklist.push_back(interpolant);
+  worklist.push_back(wpInterpolant);
+
+  size += (concretelyAddressedHistoricalStore.size() +
+           symbolicallyAddressedHistoricalStore.size()) *
+          storeElementSize;
+  for (TxStore::LowerInterpolantStore::const_iterator
+           it = concretelyAddressedHistoricalStore.begin(),
+           ie = concretelyAddressedHistoricalStore.end();
+       it != ie; ++it) {
+    worklist.push_back(it->second->getExpression());
+  }
+  for (TxStore::LowerInterpolantStore::const_iterator
+           it = symbolicallyAddressedHistoricalStore.begin(),
+           ie = symbolicallyAddressedHistoricalStore.end();
+       it != ie; ++it) {
+    worklist.push_back(it->second->getExpression());
+  }
+
+  const TxStore::TopInterpolantStore *stores[2] = {
+    &concretelyAddressedStore, &symbolicallyAddressedStore
+  };
+  for (unsigned i = 0; i < 2; ++i) {
+    for (TxStore::TopInterpolantStore::const_iterator
+             it = stores[i]->begin(),
+             ie = stores[i]->end();
+         it != ie; ++it) {
+      size += mapNodeSize + sizeof(TxStore::LowerInterpolantStore) +
+              it->second.size() * storeElementSize;
+      for (TxStore::LowerInterpolantStore::const_iterator
+               it1 = it->second.begin(),
+               ie1 = it->second.end();
+           it1 != ie1; ++it1) {
+        worklist.push_back(it1->second->getExpression());
+      }
+    }
+  }
+
+  size += (existentials.size() + markedGlobal.size()) * mapNodeSize;
+  for (std::map<llvm::Value *, std::vector<ref<Expr> > >::const_iterator
+           it = phiValues.begin(),
+           ie = phiValues.end();
+       it != ie; ++it) {
+    size += mapNodeSize + it->second.size() * sizeof(ref<Expr>);
+    worklist.insert(worklist.end(), it->second.begin(), it->second.end());
+  }
+
+  // Expressions are hash-consed and shared, hence we count each node once
+  std::set<const Expr *> visited;
+  while (!worklist.empty()) {
+    ref<Expr> e = worklist.back();
+    worklist.pop_back();
+    if (e.isNull() || !visited.insert(e.get()).second)
+      continue;
+    size += sizeof(BinaryExpr);
+    for (unsigned i = 0, n = e->getNumKids(); i < n; ++i) {
+      worklist.push_back(e->getKid(i));
+    }
+  }
+
+  return size;
+}
+
 ref<Expr> TxSubsumptionTableEntry::makeConstraint(
     ExecutionState &state, ref<TxInterpolantValue> tabledValue,
     ref<TxInterpolantValue> stateValue, ref<Expr> tabledOffset,
@@ -808,7 +987,7 @@ bool TxSubsumptionTableEntry::subsumed(
     bool leftRetrieval, TxStore::TopStateStore &__internalStore,
     TxStore::LowerStateStore &__concretelyAddressedHistoricalStore,
     TxStore::LowerStateStore &__symbolicallyAddressedHistoricalStore,
-    int debugSubsumptionLevel) {
+    int debugSubsumptionLevel, DeferredCheck *deferred) {
 setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
 #ifdef ENABLE_Z3
 
@@ -924,7 +1103,7 @@ setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
        it != phiValues.end(); ++it) {
     if (isa<llvm::PHINode>((*it).first)) {
       llvm::Instruction *phi = dyn_cast<llvm::Instruction>((*it).first);
-      std::vector<ref<Expr> > values = (*it).second;
+      const std::vector<ref<Expr> > &values = (*it).second;
       if (values.empty())
         continue;
 #if LLVM_VERSION_CODE >= LLVM_VERSION(3, 0)
@@ -935,11 +1114,10 @@ setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
 
       if (state.txTreeNode->getParent() &&
           state.txTreeNode->getParent()->getDependency()) {
-        std::map<llvm::Value *, std::vector<ref<TxStateValue> > > valuesMap =
-            state.txTreeNode->getParent()->getDependency()->getvaluesMap();
-        std::vector<ref<TxStateValue> > txStateVal =
-            valuesMap[dyn_cast<llvm::Value>(inputArg)];
-        if (txStateVal.empty()) {
+        const std::vector<ref<TxStateValue> > *txStateVal =
+            state.txTreeNode->getParent()->getDependency()->findLocalValues(
+                inputArg);
+        if (!txStateVal || txStateVal->empty()) {
           if (debugSubsumptionLevel >= 1) {
             std::string msg;
             std::string padding(makeTabs(1));
@@ -952,7 +1130,8 @@ setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
           }
           return false;
         }
-        if (txStateVal.back()->getExpression().compare(values.back()) != 0) {
+        if (txStateVal->back()->getExpression().compare(values.back()) !=
+            0) {
           if (debugSubsumptionLevel >= 1) {
             std::string msg;
             std::string padding(makeTabs(1));
@@ -1027,7 +1206,7 @@ setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
   std::map<ref<TxStateValue>, std::set<uint64_t> > corePointerValues;
 
   {
-    TimerStatIncrementer t(concretelyAddressedStoreExpressionBuildTime);
+    TxTimerStatIncrementer t(concretelyAddressedStoreExpressionBuildTime);
 
     // Build constraints from concrete-address interpolant store
     for (TxStore::TopInterpolantStore::const_iterator
@@ -1053,7 +1232,7 @@ setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
         return false;
       }
 
-      TxStore::MiddleStateStore &m = mIt->second;
+      const TxStore::MiddleStateStore &m = mIt->second;
 
       for (TxStore::LowerInterpolantStore::const_iterator
                it2 = tabledConcreteMap.begin(),
@@ -1323,7 +1502,7 @@ setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
   }
 
   {
-    TimerStatIncrementer t(symbolicallyAddressedStoreExpressionBuildTime);
+    TxTimerStatIncrementer t(symbolicallyAddressedStoreExpressionBuildTime);
     // Build constraints from symbolic-address interpolant store
     for (TxStore::TopInterpolantStore::const_iterator
              it1 = symbolicallyAddressedStore.begin(),
@@ -1348,7 +1527,7 @@ setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
         return false;
       }
 
-      TxStore::MiddleStateStore &m = mIt->second;
+      const TxStore::MiddleStateStore &m = mIt->second;
 
       ref<Expr> conjunction;
 
@@ -1482,7 +1661,7 @@ setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
   ref<Expr> expr; // The query expression
 
   {
-    TimerStatIncrementer t(solverAccessTime);
+    TxTimerStatIncrementer t(solverAccessTime);
 
     // Here we build the query expression, after which it is always a
     // conjunction of the interpolant and the state equality constraints. Here
@@ -1609,18 +1788,45 @@ setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
                              state.constraints, expr,debugSubsumptionLevel).c_str()); /*Added 'debugSubsumptionLevel' variable in 'constructQuery' function for Pretty Print*/
           }
 
+          uint64_t fingerprint = 0;
+          if (isKnownQueryFailure(state.constraints, expr, fingerprint)) {
+            if (debugSubsumptionLevel >= 1) {
+              klee_message("#%lu=>#%lu: Check failure as the query failed "
+                           "before",
+                           state.txTreeNode->getNodeSequenceNumber(),
+                           nodeSequenceNumber);
+            }
+            return false;
+          }
+
+          if (deferred) {
+            deferred->query = expr;
+            deferred->fingerprint = fingerprint;
+            deferred->coreValues = coreValues;
+            deferred->corePointerValues = corePointerValues;
+            return false;
+          }
+
           if (llvm::isa<ExistsExpr>(expr)) {
-            // We instantiate a new Z3 solver to make sure that we use Z3
+            // We use a dedicated Z3 solver to make sure that we use Z3
             // without pre-solving optimizations. It would be nice in the future
             // to just run solver->evaluate so that the optimizations can be
             // used, but this requires handling of quantified expressions by
             // KLEE's pre-solving procedure, which does not exist currently.
-            Z3Solver *z3solver = new Z3Solver();
-            z3solver->setCoreSolverTimeout(timeout);
-            success = z3solver->directComputeValidity(
-                Query(state.constraints, expr), result, unsatCore);
-            z3solver->setCoreSolverTimeout(0);
-            delete z3solver;
+            // The state constraints are asserted only once for all the
+            // entries checked against the state, and only validity is
+            // needed here, so the falsity of the query is not computed.
+            if (!quantifiedQuerySolver)
+              quantifiedQuerySolver = new Z3Solver();
+            if (!quantifiedQuerySolver->inSession())
+              quantifiedQuerySolver->startSession(state.constraints);
+
+            bool isValid = false;
+            quantifiedQuerySolver->setCoreSolverTimeout(timeout);
+            success = quantifiedQuerySolver->sessionComputeTruth(expr, isValid,
+                                                                 unsatCore);
+            quantifiedQuerySolver->setCoreSolverTimeout(0);
+            result = isValid ? Solver::True : Solver::Unknown;
           } else {
             solver->setTimeout(timeout);
             success = solver->evaluate(state, expr, result, unsatCore);
@@ -1628,6 +1834,9 @@ setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
           }
 
           if (!success || result != Solver::True) {
+            // A timeout is not remembered, as it may depend on the load
+            if (success)
+              recordQueryFailure(fingerprint);
             if (debugSubsumptionLevel >= 1) {
               klee_message("#%lu=>#%lu: Check failure as solved did not decide "
                            "validity of existentially-quantified query",
@@ -1644,6 +1853,24 @@ setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
                        TxPrettyExpressionBuilder::constructQuery(
                            state.constraints, expr, debugSubsumptionLevel).c_str());/*Added 'debugSubsumptionLevel' variable in 'constructQuery' function for Pretty Print*/
         }
+        uint64_t fingerprint = 0;
+        if (isKnownQueryFailure(state.constraints, expr, fingerprint)) {
+          if (debugSubsumptionLevel >= 1) {
+            klee_message("#%lu=>#%lu: Check failure as the query failed before",
+                         state.txTreeNode->getNodeSequenceNumber(),
+                         nodeSequenceNumber);
+          }
+          return false;
+        }
+
+        if (deferred) {
+          deferred->query = expr;
+          deferred->fingerprint = fingerprint;
+          deferred->coreValues = coreValues;
+          deferred->corePointerValues = corePointerValues;
+          return false;
+        }
+
         // We call the solver in the standard way if the
         // formula is unquantified.
         solver->setTimeout(timeout);
@@ -1651,6 +1878,8 @@ setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
         solver->setTimeout(0);
 
         if (!success || result != Solver::True) {
+          if (success)
+            recordQueryFailure(fingerprint);
           if (debugSubsumptionLevel >= 1) {
             klee_message(
                 "#%lu=>#%lu: Check failure as solved did not decide validity",
@@ -1717,6 +1946,30 @@ setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
   return false;
 }
 
+void TxSubsumptionTableEntry::completeDeferred(
+    ExecutionState &state, DeferredCheck &deferred,
+    const std::vector<ref<Expr> > &unsatCore, int debugSubsumptionLevel) {
+  if (debugSubsumptionLevel >= 1) {
+    std::string msg = "";
+    if (!deferred.corePointerValues.empty()) {
+      msg += " (with successful memory bound checks)";
+    }
+    klee_message("#%lu=>#%lu: Check success as parallel solver decided "
+                 "validity%s",
+                 state.txTreeNode->getNodeSequenceNumber(), nodeSequenceNumber,
+                 msg.c_str());
+  }
+
+  state.txTreeNode->unsatCoreInterpolation(unsatCore);
+  interpolateValues(state, deferred.coreValues, deferred.corePointerValues,
+                    debugSubsumptionLevel);
+  if (WPInterpolant) {
+    // In case a node is subsumed, the WP Expr is stored at the parent node.
+    // This is crucial for generating WP Expr at the parent node.
+    state.txTreeNode->setWPatSubsumption(wpInterpolant);
+  }
+}
+
 ref<Expr> TxSubsumptionTableEntry::getInterpolant() const {
   return interpolant;
 }
@@ -1937,6 +2190,133 @@ void TxSubsumptionTableEntry::printWP(llvm::raw_ostream &stream,
   stream << "]\n";
 }
 
+uint64_t TxSubsumptionTableEntry::signatureRejectionCount = 0;
+
+uint64_t TxSubsumptionTableEntry::failureCacheLookupCount = 0;
+
+uint64_t TxSubsumptionTableEntry::failureCacheHitCount = 0;
+
+namespace {
+/// \brief The partition of a path condition into the groups of constraints
+/// sharing arrays, directly or through other constraints. A subsumption check
+/// fingerprints many queries against the same path condition, and the path
+/// conditions of successive checks mostly extend each other, hence the
+/// partition is kept and extended with the constraints added since the last
+/// fingerprint.
+class ConstraintGroups {
+  /// \brief The constraints partitioned, in the order of the path condition
+  std::vector<ref<Expr> > constraints;
+
+  /// \brief The union-find forest of the constraint indices
+  std::vector<unsigned> parent;
+
+  /// \brief The index of the first constraint on each array
+  std::map<const Array *, unsigned> arrayConstraint;
+
+  unsigned find(unsigned i) {
+    while (parent[i] != i) {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+    return i;
+  }
+
+  void add(ref<Expr> constraint) {
+    unsigned index = constraints.size();
+    constraints.push_back(constraint);
+    parent.push_back(index);
+
+    std::vector<const Array *> objects;
+    findSymbolicObjects(constraint, objects);
+    for (std::vector<const Array *>::iterator it = objects.begin(),
+                                              ie = objects.end();
+         it != ie; ++it) {
+      std::pair<std::map<const Array *, unsigned>::iterator, bool> inserted =
+          arrayConstraint.insert(std::make_pair(*it, index));
+      if (!inserted.second) {
+        unsigned root = find(inserted.first->second);
+        if (root != find(index))
+          parent[find(index)] = root;
+      }
+    }
+  }
+
+public:
+  /// \brief Partition the constraints, reusing the partition of the previous
+  /// call when it is of a prefix of the constraints
+  void update(const ConstraintManager &path) {
+    bool prefix = path.size() >= constraints.size();
+    ConstraintManager::constraint_iterator it = path.begin();
+    for (unsigned i = 0; prefix && i < constraints.size(); ++i, ++it)
+      prefix = it->get() == constraints[i].get();
+    if (!prefix) {
+      constraints.clear();
+      parent.clear();
+      arrayConstraint.clear();
+      it = path.begin();
+    }
+    for (ConstraintManager::constraint_iterator ie = path.end(); it != ie;
+         ++it)
+      add(*it);
+  }
+
+  /// \brief Hash the query and the constraints of the groups of its arrays,
+  /// in the order of the path condition
+  uint64_t hash(ref<Expr> query) {
+    std::vector<const Array *> objects;
+    findSymbolicObjects(query, objects);
+    std::set<unsigned> groups;
+    for (std::vector<const Array *>::iterator it = objects.begin(),
+                                              ie = objects.end();
+         it != ie; ++it) {
+      std::map<const Array *, unsigned>::iterator found =
+          arrayConstraint.find(*it);
+      if (found != arrayConstraint.end())
+        groups.insert(find(found->second));
+    }
+
+    uint64_t hash = query->hash();
+    if (groups.empty())
+      return hash;
+    for (unsigned i = 0; i < constraints.size(); ++i) {
+      if (groups.find(find(i)) != groups.end())
+        hash = hash * 1000003 + constraints[i]->hash();
+    }
+    return hash;
+  }
+};
+}
+
+uint64_t
+TxSubsumptionTableEntry::fingerprintQuery(const ConstraintManager &constraints,
+                                          ref<Expr> query) {
+  static ConstraintGroups groups;
+  groups.update(constraints);
+  return groups.hash(query);
+}
+
+bool TxSubsumptionTableEntry::isKnownQueryFailure(
+    const ConstraintManager &constraints, ref<Expr> query,
+    uint64_t &fingerprint) {
+  if (!SubsumptionFailureCache)
+    return false;
+
+  ++failureCacheLookupCount;
+  fingerprint = fingerprintQuery(constraints, query);
+  if (failedQueryFingerprints.find(fingerprint) ==
+      failedQueryFingerprints.end())
+    return false;
+
+  ++failureCacheHitCount;
+  return true;
+}
+
+void TxSubsumptionTableEntry::recordQueryFailure(uint64_t fingerprint) {
+  if (SubsumptionFailureCache &&
+      failedQueryFingerprints.size() < maxFailedQueryFingerprints)
+    failedQueryFingerprints.insert(fingerprint);
+}
+
 void TxSubsumptionTableEntry::printStat(std::stringstream &stream) {
   stream << "KLEE: done:     Time for actual solver calls in subsumption check "
             "(ms) = " << ((double)stats::subsumptionQueryTime.getValue()) / 1000
@@ -1952,139 +2332,248 @@ void TxSubsumptionTableEntry::printStat(std::stringstream &stream) {
                 1000 << "\n";
   stream << "KLEE: done:     Solver access time (ms) = "
          << ((double)solverAccessTime.getValue()) / 1000 << "\n";
+  stream << "KLEE: done:     Number of solver calls for subsumption check "
+            "skipped by failure cache (lookups) = " << failureCacheHitCount
+         << " (" << failureCacheLookupCount << ")\n";
+  stream << "KLEE: done:     Number of table entries rejected by signature = "
+         << signatureRejectionCount << "\n";
+  stream << "KLEE: done:     Number of interned call histories = "
+         << TxCallHistory::getInternedCount() << "\n";
 }
 
 /**/
 
-void TxSubsumptionTable::CallHistoryIndexedTable::Node::print(
-    llvm::raw_ostream &stream) const {
-  print(stream, 0,debugSubsumptionLevel_g);
+TxSubsumptionTable::CallHistoryIndexedTable::~CallHistoryIndexedTable() {
+  for (std::map<uint64_t, std::deque<TxSubsumptionTableEntry *> >::iterator
+           it = entryLists.begin(),
+           ie = entryLists.end();
+       it != ie; ++it) {
+    for (std::deque<TxSubsumptionTableEntry *>::iterator
+             it1 = it->second.begin(),
+             ie1 = it->second.end();
+         it1 != ie1; ++it1) {
+      delete (*it1);
+    }
+  }
 }
 
-void TxSubsumptionTable::CallHistoryIndexedTable::Node::print(
-    llvm::raw_ostream &stream, const unsigned paddingAmount, int debugSubsumptionLevel) const {
-  print(stream, makeTabs(paddingAmount),debugSubsumptionLevel);
+std::deque<TxSubsumptionTableEntry *> *
+TxSubsumptionTable::CallHistoryIndexedTable::insert(
+    const TxCallHistory *callHistory, TxSubsumptionTableEntry *entry) {
+  std::deque<TxSubsumptionTableEntry *> &entryList =
+      entryLists[callHistory->getId()];
+  entryList.push_back(entry);
+  return &entryList;
 }
 
-void TxSubsumptionTable::CallHistoryIndexedTable::Node::print(
-    llvm::raw_ostream &stream, const std::string &prefix, int debugSubsumptionLevel) const {
-  std::string tabsNext = appendTab(prefix);
+bool TxSubsumptionTable::CallHistoryIndexedTable::find(
+    const TxCallHistory *callHistory,
+    std::vector<TxSubsumptionTableEntry *> &entries) const {
+  for (const TxCallHistory *prefix = callHistory;; prefix = prefix->pop()) {
+    std::map<uint64_t, std::deque<TxSubsumptionTableEntry *> >::const_iterator
+    it = entryLists.find(prefix->getId());
+    if (it != entryLists.end()) {
+      entries.insert(entries.end(), it->second.rbegin(), it->second.rend());
+    }
+    if (prefix->empty())
+      break;
+  }
+  return !entries.empty();
+}
 
-  stream << "\n";
-  stream << tabsNext << "Call history-indexed table tree node\n";
-  if (id) {
-    stream << tabsNext << "node Id = " << reinterpret_cast<uintptr_t>(id)
-           << "\n";
-  } else {
-    stream << tabsNext << "node Id = (root)\n";
+bool TxSubsumptionTable::CallHistoryIndexedTable::hasEntries(
+    const TxCallHistory *callHistory) const {
+  for (const TxCallHistory *prefix = callHistory;; prefix = prefix->pop()) {
+    std::map<uint64_t, std::deque<TxSubsumptionTableEntry *> >::const_iterator
+    it = entryLists.find(prefix->getId());
+    if (it != entryLists.end() && !it->second.empty())
+      return true;
+    if (prefix->empty())
+      return false;
   }
-  stream << tabsNext << "Entries:\n";
-  for (EntryIterator it = entryList.rbegin(), ie = entryList.rend(); it != ie;
-       ++it) {
-    (*it)->print(stream, tabsNext, debugSubsumptionLevel);
-    stream << "\n";
+}
+
+uint64_t TxSubsumptionTable::CallHistoryIndexedTable::size() const {
+  uint64_t ret = 0;
+  for (std::map<uint64_t,
+                std::deque<TxSubsumptionTableEntry *> >::const_iterator
+           it = entryLists.begin(),
+           ie = entryLists.end();
+       it != ie; ++it) {
+    ret += it->second.size();
   }
-  for (std::map<llvm::Instruction *, Node *>::const_iterator it = next.begin(),
-                                                             ie = next.end();
+  return ret;
+}
+
+void TxSubsumptionTable::CallHistoryIndexedTable::print(
+    llvm::raw_ostream &stream) const {
+  std::string tabsNext = appendTab("");
+  for (std::map<uint64_t, std::deque<TxSubsumptionTableEntry *> >::const_iterator
+           it = entryLists.begin(),
+           ie = entryLists.end();
        it != ie; ++it) {
-    stream << tabsNext << "Next call:\n";
-    it->second->print(stream, appendTab(prefix), debugSubsumptionLevel); ///***
     stream << "\n";
+    stream << tabsNext << "Call history id = " << it->first << "\n";
+    stream << tabsNext << "Entries:\n";
+    for (EntryIterator it1 = it->second.rbegin(), ie1 = it->second.rend();
+         it1 != ie1; ++it1) {
+      (*it1)->print(stream, tabsNext, debugSubsumptionLevel_g);
+      stream << "\n";
+    }
   }
 }
 
 /**/
 
-void TxSubsumptionTable::CallHistoryIndexedTable::clearTree(Node *node) {
-  for (std::map<llvm::Instruction *, Node *>::iterator it = node->next.begin(),
-                                                       ie = node->next.end();
-       it != ie; ++it) {
-    clearTree(it->second);
-    delete it->second;
-  }
+std::map<uintptr_t, TxSubsumptionTable::CallHistoryIndexedTable *>
+TxSubsumptionTable::instance;
 
-  for (std::deque<TxSubsumptionTableEntry *>::iterator
-           it = node->entryList.begin(),
-           ie = node->entryList.end();
-       it != ie; ++it) {
-    delete (*it);
+std::list<TxSubsumptionTableEntry *> TxSubsumptionTable::evictionQueue;
+
+uint64_t TxSubsumptionTable::currentSize = 0;
+
+uint64_t TxSubsumptionTable::peakSize = 0;
+
+uint64_t TxSubsumptionTable::peakEntryCount = 0;
+
+uint64_t TxSubsumptionTable::entryLimitEvictionCount = 0;
+
+uint64_t TxSubsumptionTable::memoryLimitEvictionCount = 0;
+
+uint64_t TxSubsumptionTable::unusedEvictionCount = 0;
+
+uint64_t TxSubsumptionTable::memoryPressureEvictionCount = 0;
+
+uint64_t TxSubsumptionTable::evictedSize = 0;
+
+uint64_t TxSubsumptionTable::subsumedStateCount = 0;
+
+uint64_t TxSubsumptionTable::loadedEntryHitCount = 0;
+
+#ifdef ENABLE_Z3
+Z3ParallelSolver *TxSubsumptionTable::parallelSolver = 0;
+
+double TxSubsumptionTable::usefulParallelTime = 0;
+
+double TxSubsumptionTable::wastedParallelTime = 0;
+
+uint64_t TxSubsumptionTable::parallelBatchCount = 0;
+#endif
+
+bool TxSubsumptionTable::overLimit(bool &dueToEntryLimit) {
+#ifdef ENABLE_Z3
+  if (MaxFailSubsumption > 0 &&
+      evictionQueue.size() > (uint64_t)MaxFailSubsumption) {
+    dueToEntryLimit = true;
+    return true;
+  }
+  if (MaxSubsumptionTableMemory > 0 &&
+      currentSize > ((uint64_t)MaxSubsumptionTableMemory << 20)) {
+    dueToEntryLimit = false;
+    return true;
   }
+#endif
+  return false;
 }
 
-void TxSubsumptionTable::CallHistoryIndexedTable::insert(
-    const std::vector<llvm::Instruction *> &callHistory,
-    TxSubsumptionTableEntry *entry) {
-  Node *current = root;
+TxSubsumptionTableEntry *
+TxSubsumptionTable::selectVictim(TxSubsumptionTableEntry *keep) {
+  std::list<TxSubsumptionTableEntry *>::iterator it = evictionQueue.begin(),
+                                                 ie = evictionQueue.end();
+  if (it != ie && *it == keep)
+    ++it;
+  if (it == ie)
+    return 0;
 
-  for (std::vector<llvm::Instruction *>::const_iterator
-           it = callHistory.begin(),
-           ie = callHistory.end();
-       it != ie; ++it) {
-    llvm::Instruction *call = *it;
-    std::map<llvm::Instruction *, Node *>::const_iterator it1 =
-        current->next.find(call);
-    if (it1 == current->next.end()) {
-      Node *newNode = new Node(call);
-      current->next[*it] = newNode;
-      current = newNode;
-    } else {
-      current = it1->second;
+#ifdef ENABLE_Z3
+  if (SubsumptionEvictionToUse == EVICT_HIT_RATIO) {
+    // Linear scan: the cost is negligible compared to a single subsumption
+    // check. The ratio is smoothed such that entries that have never been
+    // checked are preferred over entries that have only been failing.
+    // Ties are resolved in favor of evicting the older entry.
+    TxSubsumptionTableEntry *victim = 0;
+    double victimRatio = 0.0;
+    for (; it != ie; ++it) {
+      if (*it == keep)
+        continue;
+      double ratio = ((double)(*it)->hitCount + 1.0) /
+                     ((double)(*it)->attemptCount + 2.0);
+      if (!victim || ratio < victimRatio) {
+        victim = *it;
+        victimRatio = ratio;
+      }
     }
+    return victim;
   }
-  current->entryList.push_back(entry);
+#endif
+
+  // For both EVICT_OLDEST and EVICT_LRU the queue is kept in eviction order
+  return *it;
 }
 
-std::pair<TxSubsumptionTable::EntryIterator, TxSubsumptionTable::EntryIterator>
-TxSubsumptionTable::CallHistoryIndexedTable::find(
-    const std::vector<llvm::Instruction *> &callHistory, bool &found) const {
-  Node *current = root;
-  std::pair<EntryIterator, EntryIterator> ret;
+void TxSubsumptionTable::evict(TxSubsumptionTableEntry *entry) {
+  std::deque<TxSubsumptionTableEntry *>::iterator it = std::find(
+      entry->container->begin(), entry->container->end(), entry);
+  assert(it != entry->container->end() && "entry not found in the table");
+  entry->container->erase(it);
+  evictionQueue.erase(entry->evictionPosition);
 
-  for (std::vector<llvm::Instruction *>::const_iterator
-           it = callHistory.begin(),
-           ie = callHistory.end();
-       it != ie; ++it) {
-    llvm::Instruction *call = *it;
-    std::map<llvm::Instruction *, Node *>::const_iterator it1 =
-        current->next.find(call);
-    if (it1 == current->next.end()) {
-      found = false;
-      return ret;
-    }
-    current = it1->second;
-  }
-  found = true;
-  return std::pair<EntryIterator, EntryIterator>(current->entryList.rbegin(),
-                                                 current->entryList.rend());
+  currentSize -= entry->approximateSize;
+  evictedSize += entry->approximateSize;
+  if (!entry->hitCount)
+    ++unusedEvictionCount;
+
+  TxTreeGraph::removeTableEntryMapping(entry);
+  delete entry;
 }
 
-void TxSubsumptionTable::CallHistoryIndexedTable::printNode(
-    llvm::raw_ostream &stream, Node *n, std::string edges, int debugSubsumptionLevel) const {
-  for (std::map<llvm::Instruction *, Node *>::const_iterator
-           it = n->next.begin(),
-           ie = n->next.end();
+uint64_t TxSubsumptionTable::getMaxProgramPointEntryCount() {
+  uint64_t ret = 0;
+  for (std::map<uintptr_t, CallHistoryIndexedTable *>::const_iterator
+           it = instance.begin(),
+           ie = instance.end();
        it != ie; ++it) {
-    stream << "\n";
-    it->second->print(stream, edges + "    ",  debugSubsumptionLevel); //*******
-    stream << "\n";
-    printNode(stream, it->second, edges + "    ", debugSubsumptionLevel);
+    ret = std::max(ret, it->second->size());
   }
+  return ret;
 }
 
-void TxSubsumptionTable::CallHistoryIndexedTable::print(
-    llvm::raw_ostream &stream) const {
-  root->print(stream);
-  printNode(stream, root, "",debugSubsumptionLevel_g);
+uint64_t TxSubsumptionTable::evictUnused(uint64_t bytes) {
+  uint64_t released = 0;
+  std::list<TxSubsumptionTableEntry *>::iterator it = evictionQueue.begin();
+  while (it != evictionQueue.end() && released < bytes) {
+    TxSubsumptionTableEntry *entry = *it;
+    ++it;
+    if (entry->hitCount)
+      continue;
+    released += entry->approximateSize;
+    ++memoryPressureEvictionCount;
+    evict(entry);
+  }
+  return released;
 }
 
-/**/
+void TxSubsumptionTable::recordAttempt(TxSubsumptionTableEntry *entry,
+                                       bool success) {
+  ++(entry->attemptCount);
+  if (!success)
+    return;
+  ++(entry->hitCount);
+  if (entry->loaded)
+    ++loadedEntryHitCount;
 
-std::map<uintptr_t, TxSubsumptionTable::CallHistoryIndexedTable *>
-TxSubsumptionTable::instance;
+#ifdef ENABLE_Z3
+  // Move the entry to the back of the queue, i.e., the most-recently hit
+  if (SubsumptionEvictionToUse == EVICT_LRU) {
+    evictionQueue.splice(evictionQueue.end(), evictionQueue,
+                         entry->evictionPosition);
+  }
+#endif
+}
 
 void
 TxSubsumptionTable::insert(uintptr_t id,
-                           const std::vector<llvm::Instruction *> &callHistory,
+                           const TxCallHistory *callHistory,
                            TxSubsumptionTableEntry *entry) {
   CallHistoryIndexedTable *subTable = 0;
 
@@ -2095,12 +2584,34 @@ TxSubsumptionTable::insert(uintptr_t id,
 
   if (it == instance.end()) {
     subTable = new CallHistoryIndexedTable();
-    subTable->insert(callHistory, entry);
     instance[id] = subTable;
-    return;
+  } else {
+    subTable = it->second;
   }
-  subTable = it->second;
-  subTable->insert(callHistory, entry);
+  entry->container = subTable->insert(callHistory, entry);
+  entry->evictionPosition = evictionQueue.insert(evictionQueue.end(), entry);
+
+  entry->computeSignature();
+  entry->approximateSize = entry->computeApproximateSize();
+  currentSize += entry->approximateSize;
+
+  bool dueToEntryLimit;
+  while (overLimit(dueToEntryLimit)) {
+    TxSubsumptionTableEntry *victim = selectVictim(entry);
+    if (!victim)
+      break;
+    if (dueToEntryLimit)
+      ++entryLimitEvictionCount;
+    else
+      ++memoryLimitEvictionCount;
+    evict(victim);
+  }
+
+  // The peaks are of the table within its bounds
+  if (currentSize > peakSize)
+    peakSize = currentSize;
+  if (evictionQueue.size() > peakEntryCount)
+    peakEntryCount = evictionQueue.size();
 }
 
 bool TxSubsumptionTable::check(TimingSolver *solver, ExecutionState &state,
@@ -2120,10 +2631,8 @@ bool TxSubsumptionTable::check(TimingSolver *solver, ExecutionState &state,
   }
   subTable = it->second;
 
-  bool found;
-  std::pair<EntryIterator, EntryIterator> iterPair =
-      subTable->find(txTreeNode->entryCallHistory, found);
-  if (!found) {
+  std::vector<TxSubsumptionTableEntry *> entries;
+  if (!subTable->find(txTreeNode->entryCallHistory, entries)) {
     if (debugSubsumptionLevel >= 1) {
       klee_message("#%lu: Check failure due to entry not found",
                    state.txTreeNode->getNodeSequenceNumber());
@@ -2131,64 +2640,180 @@ bool TxSubsumptionTable::check(TimingSolver *solver, ExecutionState &state,
     return false;
   }
 
-  if (iterPair.first != iterPair.second) {
-
-    TxStore::TopInterpolantStore concretelyAddressedStore;
-    TxStore::TopInterpolantStore symbolicallyAddressedStore;
-    TxStore::LowerInterpolantStore concretelyAddressedHistoricalStore;
-    TxStore::LowerInterpolantStore symbolicallyAddressedHistoricalStore;
-
-    bool leftRetrieval;
-    TxStore::TopStateStore __internalStore;
-    TxStore::LowerStateStore __concretelyAddressedHistoricalStore;
-    TxStore::LowerStateStore __symbolicallyAddressedHistoricalStore;
-
-    txTreeNode->getStoredExpressions(txTreeNode->entryCallHistory,
-                                     leftRetrieval, __internalStore,
-                                     __concretelyAddressedHistoricalStore,
-                                     __symbolicallyAddressedHistoricalStore);
-
-    // Iterate the subsumption table entry with reverse iterator because
-    // the successful subsumption mostly happen in the newest entry.
-    for (EntryIterator it = iterPair.first, ie = iterPair.second; it != ie;
-         ++it) {
-      if ((*it)->subsumed(solver, state, timeout, leftRetrieval,
-                          __internalStore, __concretelyAddressedHistoricalStore,
-                          __symbolicallyAddressedHistoricalStore,
-                          debugSubsumptionLevel)) {
-        // We mark as subsumed such that the node will not be
-        // stored into table (the table already contains a more
-        // general entry).
-        txTreeNode->isSubsumed = true;
-
-        // Mark the node as subsumed, and create a subsumption edge
-        TxTreeGraph::markAsSubsumed(txTreeNode, (*it));
-        return true;
+  bool ret = false;
+  TxStore::TopInterpolantStore concretelyAddressedStore;
+  TxStore::TopInterpolantStore symbolicallyAddressedStore;
+  TxStore::LowerInterpolantStore concretelyAddressedHistoricalStore;
+  TxStore::LowerInterpolantStore symbolicallyAddressedHistoricalStore;
+
+  bool leftRetrieval;
+  TxStore::TopStateStore __internalStore;
+  TxStore::LowerStateStore __concretelyAddressedHistoricalStore;
+  TxStore::LowerStateStore __symbolicallyAddressedHistoricalStore;
+
+  txTreeNode->getStoredExpressions(txTreeNode->entryCallHistory,
+                                   leftRetrieval, __internalStore,
+                                   __concretelyAddressedHistoricalStore,
+                                   __symbolicallyAddressedHistoricalStore);
+
+  TxSubsumptionTableEntry::Signature stateSignature =
+      TxSubsumptionTableEntry::Signature::create(
+          state, __internalStore, __concretelyAddressedHistoricalStore,
+          __symbolicallyAddressedHistoricalStore);
+
+  // The entries passing the signature test, when their queries are solved
+  // in parallel
+  std::vector<TxSubsumptionTableEntry *> candidates;
+
+  // The entries are ordered newest first because the successful
+  // subsumption mostly happen in the newest entry.
+  for (std::vector<TxSubsumptionTableEntry *>::const_iterator
+           it = entries.begin(),
+           ie = entries.end();
+       it != ie; ++it) {
+    if (!(*it)->signature.mayMatch(stateSignature)) {
+      ++TxSubsumptionTableEntry::signatureRejectionCount;
+      if (debugSubsumptionLevel >= 1) {
+        klee_message("#%lu=>#%lu: Check failure due to signature mismatch",
+                     txTreeNode->getNodeSequenceNumber(),
+                     (*it)->nodeSequenceNumber);
       }
+      recordAttempt(*it, false);
+      continue;
+    }
+
+#ifdef ENABLE_Z3
+    if (ParallelSubsumption > 0) {
+      candidates.push_back(*it);
+      continue;
+    }
+#endif
+
+    bool success = (*it)->subsumed(
+        solver, state, timeout, leftRetrieval, __internalStore,
+        __concretelyAddressedHistoricalStore,
+        __symbolicallyAddressedHistoricalStore, debugSubsumptionLevel);
+    recordAttempt(*it, success);
+
+    if (success) {
+      // We mark as subsumed such that the node will not be
+      // stored into table (the table already contains a more
+      // general entry).
+      txTreeNode->isSubsumed = true;
+      ++subsumedStateCount;
+
+      // Mark the node as subsumed, and create a subsumption edge
+      TxTreeGraph::markAsSubsumed(txTreeNode, (*it));
+      ret = true;
+      break;
     }
   }
-  return false;
+#ifdef ENABLE_Z3
+  if (!candidates.empty()) {
+    TxSubsumptionTableEntry *entry = checkInParallel(
+        solver, state, timeout, debugSubsumptionLevel, candidates,
+        leftRetrieval, __internalStore, __concretelyAddressedHistoricalStore,
+        __symbolicallyAddressedHistoricalStore);
+    if (entry) {
+      txTreeNode->isSubsumed = true;
+      ++subsumedStateCount;
+      TxTreeGraph::markAsSubsumed(txTreeNode, entry);
+      ret = true;
+    }
+  }
+
+  // The state constraints asserted for this check are not reused
+  TxSubsumptionTableEntry::endQuantifiedQuerySession();
+#endif
+  return ret;
 }
 
-bool TxSubsumptionTable::hasInterpolation(ExecutionState &state) {
+#ifdef ENABLE_Z3
+TxSubsumptionTableEntry *TxSubsumptionTable::checkInParallel(
+    TimingSolver *solver, ExecutionState &state, double timeout,
+    int debugSubsumptionLevel,
+    const std::vector<TxSubsumptionTableEntry *> &candidates,
+    bool leftRetrieval, TxStore::TopStateStore &__internalStore,
+    TxStore::LowerStateStore &__concretelyAddressedHistoricalStore,
+    TxStore::LowerStateStore &__symbolicallyAddressedHistoricalStore) {
+  if (!parallelSolver)
+    parallelSolver = new Z3ParallelSolver(SubsumptionThreads);
+
+  for (unsigned start = 0; start < candidates.size();
+       start += ParallelSubsumption) {
+    unsigned end = std::min<unsigned>(start + ParallelSubsumption,
+                                      candidates.size());
+
+    // Run the checks up to the solver calls, collecting the queries
+    std::vector<TxSubsumptionTableEntry *> deferredEntries;
+    std::vector<TxSubsumptionTableEntry::DeferredCheck> deferredChecks;
+    std::vector<ref<Expr> > deferredQueries;
+    for (unsigned i = start; i < end; ++i) {
+      TxSubsumptionTableEntry::DeferredCheck deferred;
+      bool success = candidates[i]->subsumed(
+          solver, state, timeout, leftRetrieval, __internalStore,
+          __concretelyAddressedHistoricalStore,
+          __symbolicallyAddressedHistoricalStore, debugSubsumptionLevel,
+          &deferred);
+      if (success) {
+        recordAttempt(candidates[i], true);
+        return candidates[i];
+      }
+      if (deferred.query.isNull()) {
+        // Decided without the solver
+        recordAttempt(candidates[i], false);
+        continue;
+      }
+      deferredEntries.push_back(candidates[i]);
+      deferredChecks.push_back(deferred);
+      deferredQueries.push_back(deferred.query);
+    }
+    if (deferredQueries.empty())
+      continue;
 
-  CallHistoryIndexedTable *subTable = 0;
-  TxTreeNode *txTreeNode = state.txTreeNode;
+    ++parallelBatchCount;
+    std::vector<bool> invalid;
+    std::vector<ref<Expr> > unsatCore;
+    int winner = parallelSolver->findValid(
+        state.constraints, deferredQueries, timeout, usefulParallelTime,
+        wastedParallelTime, invalid, unsatCore);
+    for (int i = 0, n = deferredEntries.size(); i < n; ++i) {
+      // A cancelled or timed out query decided nothing about its entry, hence
+      // neither the attempt nor the failure is recorded
+      if (i == winner || !invalid[i])
+        continue;
+      recordAttempt(deferredEntries[i], false);
+      deferredEntries[i]->recordQueryFailure(deferredChecks[i].fingerprint);
+    }
+    if (winner < 0)
+      continue;
 
-  std::map<uintptr_t, CallHistoryIndexedTable *>::iterator it =
-      instance.find(state.txTreeNode->getProgramPoint());
-  if (it == instance.end()) {
-    return false;
+    // The worker which found the query valid also returned its unsat core,
+    // which completes the check of the winning entry without solving again
+    TxSubsumptionTableEntry *entry = deferredEntries[winner];
+    entry->completeDeferred(state, deferredChecks[winner], unsatCore,
+                            debugSubsumptionLevel);
+    recordAttempt(entry, true);
+    return entry;
   }
-  subTable = it->second;
+  return 0;
+}
+#endif
+
+bool TxSubsumptionTable::hasInterpolation(ExecutionState &state) {
+  return hasEntries(state.txTreeNode->getProgramPoint(),
+                    state.txTreeNode->entryCallHistory);
+}
 
-  bool found;
-  subTable->find(txTreeNode->entryCallHistory, found);
-  if (!found) {
+bool TxSubsumptionTable::hasEntries(uintptr_t programPoint,
+                                    const TxCallHistory *callHistory) {
+  std::map<uintptr_t, CallHistoryIndexedTable *>::iterator it =
+      instance.find(programPoint);
+  if (it == instance.end()) {
     return false;
   }
 
-  return true;
+  return it->second->hasEntries(callHistory);
 }
 
 void TxSubsumptionTable::clear() {
@@ -2201,20 +2826,78 @@ void TxSubsumptionTable::clear() {
       delete it->second;
     }
   }
+  instance.clear();
+  evictionQueue.clear();
+  currentSize = 0;
+#ifdef ENABLE_Z3
+  TxSubsumptionTableEntry::deleteQuantifiedQuerySolver();
+  delete parallelSolver;
+  parallelSolver = 0;
+#endif
+}
+
+void TxSubsumptionTable::printStat(std::stringstream &stream) {
+#ifdef ENABLE_Z3
+  if (ParallelSubsumption > 0) {
+    stream << "KLEE: done:     Parallel subsumption batches = "
+           << parallelBatchCount << "\n";
+    stream << "KLEE: done:     Useful parallel solving time (ms) = "
+           << TxTree::inTwoDecimalPoints(usefulParallelTime * 1000) << "\n";
+    stream << "KLEE: done:     Wasted parallel solving time (ms) = "
+           << TxTree::inTwoDecimalPoints(wastedParallelTime * 1000) << "\n";
+  }
+
+  if (memoryPressureEvictionCount) {
+    stream << "KLEE: done:     Evicted table entries by memory pressure = "
+           << memoryPressureEvictionCount << "\n";
+  }
+
+  if (!LoadInterpolants.empty()) {
+    stream << "KLEE: done:     Subsumptions by loaded table entries = "
+           << loadedEntryHitCount << "\n";
+  }
+
+  if (MaxFailSubsumption <= 0 && !MaxSubsumptionTableMemory)
+    return;
+
+  std::string policy;
+  switch (SubsumptionEvictionToUse) {
+  case EVICT_OLDEST:
+    policy = "oldest";
+    break;
+  case EVICT_LRU:
+    policy = "lru";
+    break;
+  case EVICT_HIT_RATIO:
+    policy = "hit-ratio";
+    break;
+  }
+
+  stream << "KLEE: done:     Table eviction policy = " << policy << "\n";
+  stream << "KLEE: done:     Peak table entries = " << peakEntryCount << "\n";
+  stream << "KLEE: done:     Peak table size (KB) = "
+         << TxTree::inTwoDecimalPoints((double)peakSize / 1024) << "\n";
+  stream << "KLEE: done:     Evicted table entries by entry limit = "
+         << entryLimitEvictionCount << "\n";
+  stream << "KLEE: done:     Evicted table entries by memory budget = "
+         << memoryLimitEvictionCount << "\n";
+  stream << "KLEE: done:     Evicted table entries that never subsumed = "
+         << unusedEvictionCount << "\n";
+  stream << "KLEE: done:     Evicted table size (KB) = "
+         << TxTree::inTwoDecimalPoints((double)evictedSize / 1024) << "\n";
+#endif
 }
 
 /**/
 
-Statistic TxTree::setCurrentINodeTime("SetCurrentINodeTime",
-                                      "SetCurrentINodeTime");
-Statistic TxTree::removeTime("RemoveTime", "RemoveTime");
-Statistic TxTree::subsumptionCheckTime("SubsumptionCheckTime",
-                                       "SubsumptionCheckTime");
-Statistic TxTree::markPathConditionTime("MarkPathConditionTime", "MarkPCTime");
-Statistic TxTree::splitTime("SplitTime", "SplitTime");
-Statistic TxTree::executeOnNodeTime("ExecuteOnNodeTime", "ExecuteOnNodeTime");
-Statistic TxTree::executeMemoryOperationTime("ExecuteMemoryOperationTime",
-                                             "ExecuteMemoryOperationTime");
+TxTimerStatistic TxTree::setCurrentINodeTime("SetCurrentINodeTime");
+TxTimerStatistic TxTree::removeTime("RemoveTime");
+TxTimerStatistic TxTree::subsumptionCheckTime("SubsumptionCheckTime");
+TxTimerStatistic TxTree::markPathConditionTime("MarkPathConditionTime");
+TxTimerStatistic TxTree::splitTime("SplitTime");
+TxTimerStatistic TxTree::executeOnNodeTime("ExecuteOnNodeTime");
+TxTimerStatistic
+TxTree::executeMemoryOperationTime("ExecuteMemoryOperationTime");
 
 double TxTree::entryNumber;
 
@@ -2222,12 +2905,24 @@ double TxTree::programPointNumber;
 
 bool TxTree::symbolicExecutionError = false;
 
+bool TxTree::lazyDependency = false;
+
+bool TxTree::concreteFastPath = false;
+
 uint64_t TxTree::subsumptionCheckCount = 0;
 
+uint64_t TxTree::skippedInstructionCount = 0;
+
 ExecutionState *TxTree::initialStateCopy = 0;
 
 uint64_t TxTree::blockCount = 1;
 
+uint64_t TxTree::unsatCoreCacheLookupCount = 0;
+
+uint64_t TxTree::unsatCoreCacheHitCount = 0;
+
+uint64_t TxTree::unsatCoreCacheEvictionCount = 0;
+
 void TxTree::printTimeStat(std::stringstream &stream) {
   stream << "KLEE: done:     setCurrentINode = "
          << ((double)setCurrentINodeTime.getValue()) / 1000 << "\n";
@@ -2248,6 +2943,8 @@ void TxTree::printTimeStat(std::stringstream &stream) {
 void TxTree::printTableStat(std::stringstream &stream) {
   TxSubsumptionTableEntry::printStat(stream);
 
+  TxSubsumptionTable::printStat(stream);
+
   stream
       << "KLEE: done:     Average table entries per subsumption checkpoint = "
       << inTwoDecimalPoints(entryNumber / programPointNumber) << "\n";
@@ -2258,6 +2955,30 @@ void TxTree::printTableStat(std::stringstream &stream) {
   stream << "KLEE: done:     Average solver calls per subsumption check = "
          << inTwoDecimalPoints((double)stats::subsumptionQueryCount /
                                (double)subsumptionCheckCount) << "\n";
+
+  if (LazyDependency) {
+    stream << "KLEE: done:     Number of instructions recorded for lazy "
+              "dependency computation = "
+           << TxTreeNode::recordedInstructionCount << "\n";
+    stream << "KLEE: done:     Number of recorded instructions never "
+              "replayed = " << TxTreeNode::discardedInstructionCount << "\n";
+  }
+
+  if (ConcreteFastPath) {
+    stream << "KLEE: done:     Number of concrete operands without dependency "
+              "computation = " << TxDependency::concreteOperandCount << "\n";
+    stream << "KLEE: done:     Number of instructions skipped by the "
+              "executor = " << skippedInstructionCount << "\n";
+  }
+
+  if (UnsatCoreCache) {
+    stream << "KLEE: done:     Number of branch evaluations looked up in the "
+              "unsat core cache = " << unsatCoreCacheLookupCount << "\n";
+    stream << "KLEE: done:     Number of branch evaluations answered by the "
+              "unsat core cache = " << unsatCoreCacheHitCount << "\n";
+    stream << "KLEE: done:     Number of unsat cores evicted from the unsat "
+              "core cache = " << unsatCoreCacheEvictionCount << "\n";
+  }
 }
 
 std::string TxTree::inTwoDecimalPoints(const double n) {
@@ -2286,6 +3007,10 @@ std::string TxTree::getInterpolationStat() {
   printTimeStat(stream);
   stream << "\nKLEE: done: TxTreeNode method execution times (ms):\n";
   TxTreeNode::printTimeStat(stream);
+  stream << "\nKLEE: done: Slab allocation counts:\n";
+  TxSlabAllocatorBase::printStat(stream);
+  stream << "\nKLEE: done: Profiling timer call counts and latencies:\n";
+  TxTimerStatistic::printStat(stream);
   // printing node count
   return stream.str();
 }
@@ -2293,7 +3018,8 @@ std::string TxTree::getInterpolationStat() {
 TxTree::TxTree(
     ExecutionState *_root, llvm::DataLayout *_targetData,
     std::map<const llvm::GlobalValue *, ref<ConstantExpr> > *_globalAddresses)
-    : targetData(_targetData), globalAddresses(_globalAddresses) {
+    : targetData(_targetData), globalAddresses(_globalAddresses),
+      unsatCoreCacheSize(0) {
   currentTxTreeNode = 0;
   assert(_targetData && "target data layout not provided");
   if (!_root->txTreeNode) {
@@ -2301,6 +3027,8 @@ TxTree::TxTree(
   }
   root = currentTxTreeNode;
   initialStateCopy = new ExecutionState(*_root);
+  lazyDependency = LazyDependency;
+  concreteFastPath = ConcreteFastPath;
   ;
 }
 
@@ -2318,8 +3046,7 @@ bool TxTree::subsumptionCheck(TimingSolver *solver, ExecutionState &state,
                                state.txTreeNode->getProgramPoint())
     return false;
 
-  int debugSubsumptionLevel =
-      currentTxTreeNode->dependency->debugSubsumptionLevel;
+  int debugSubsumptionLevel = currentTxTreeNode->getDebugSubsumptionLevel();
 
   if (debugSubsumptionLevel >= 2) {
     klee_message("Subsumption check for Node #%lu, Program Point %lu",
@@ -2332,7 +3059,7 @@ bool TxTree::subsumptionCheck(TimingSolver *solver, ExecutionState &state,
 
   ++subsumptionCheckCount; // For profiling
 
-  TimerStatIncrementer t(subsumptionCheckTime);
+  TxTimerStatIncrementer t(subsumptionCheckTime);
 
   return TxSubsumptionTable::check(solver, state, timeout,
                                    debugSubsumptionLevel);
@@ -2341,7 +3068,7 @@ bool TxTree::subsumptionCheck(TimingSolver *solver, ExecutionState &state,
 }
 
 void TxTree::setCurrentINode(ExecutionState &state) {
-  TimerStatIncrementer t(setCurrentINodeTime);
+  TxTimerStatIncrementer t(setCurrentINodeTime);
   currentTxTreeNode = state.txTreeNode;
   currentTxTreeNode->setProgramPoint(state.pc->inst, state.prevPC->inst);
   if (!currentTxTreeNode->nodeSequenceNumber)
@@ -2367,7 +3094,7 @@ void TxTree::removeSpeculationFailedNodes(TxTreeNode *node) {
 void TxTree::remove(ExecutionState *state, TimingSolver *solver, bool dumping) {
 #ifdef ENABLE_Z3
   TxTreeNode *node = state->txTreeNode;
-  TimerStatIncrementer t(removeTime);
+  TxTimerStatIncrementer t(removeTime);
   assert(!node->left && !node->right);
   do {
     TxTreeNode *p = node->parent;
@@ -2388,7 +3115,7 @@ void TxTree::remove(ExecutionState *state, TimingSolver *solver, bool dumping) {
     // should not be used for subsuming.
     if (!dumping && !node->isSubsumed && node->storable &&
         !node->genericEarlyTermination) {
-      int debugSubsumptionLevel = node->dependency->debugSubsumptionLevel;
+      int debugSubsumptionLevel = node->getDebugSubsumptionLevel();
       setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
       if (debugSubsumptionLevel >= 2) {
 	if (debugSubsumptionLevel == 3){ // Printing block info for prettyPrint begin
@@ -2431,6 +3158,11 @@ void TxTree::remove(ExecutionState *state, TimingSolver *solver, bool dumping) {
       }
     }
 
+    // The recorded markings of an infeasibility also mark the values of the
+    // ancestors, whose interpolants are yet to be tabled
+    if (!dumping && node->pendingMarking)
+      node->replayTrace();
+
     if (p) {
       if (!p->genericEarlyTermination)
         p->genericEarlyTermination = node->genericEarlyTermination;
@@ -2449,7 +3181,7 @@ void TxTree::remove(ExecutionState *state, TimingSolver *solver, bool dumping) {
 
 std::pair<TxTreeNode *, TxTreeNode *>
 TxTree::split(TxTreeNode *parent, ExecutionState *left, ExecutionState *right) {
-  TimerStatIncrementer t(splitTime);
+  TxTimerStatIncrementer t(splitTime);
   parent->split(left, right);
   TxTreeGraph::addChildren(parent, parent->left, parent->right);
   std::pair<TxTreeNode *, TxTreeNode *> ret(parent->left, parent->right);
@@ -2458,12 +3190,27 @@ TxTree::split(TxTreeNode *parent, ExecutionState *left, ExecutionState *right) {
 
 void TxTree::markPathCondition(ExecutionState &state,
                                std::vector<ref<Expr> > &unsatCore) {
-  TimerStatIncrementer t(markPathConditionTime);
-  int debugSubsumptionLevel =
-      currentTxTreeNode->dependency->debugSubsumptionLevel;
+  TxTimerStatIncrementer t(markPathConditionTime);
+  currentTxTreeNode->markInfeasibility(
+      llvm::dyn_cast<llvm::BranchInst>(state.prevPC->inst), unsatCore);
+}
+
+void TxTreeNode::markInfeasibility(llvm::BranchInst *binst,
+                                   const std::vector<ref<Expr> > &unsatCore) {
+  if (TxTree::lazyDependency) {
+    TraceRecord &record = newRecord(TraceRecord::Infeasibility, binst);
+    record.argList = unsatCore;
+    pendingMarking = true;
+    return;
+  }
+  replayTrace();
+  applyInfeasibility(binst, unsatCore);
+}
+
+void TxTreeNode::applyInfeasibility(
+    llvm::Instruction *binst, const std::vector<ref<Expr> > &unsatCore) const {
+  int debugSubsumptionLevel = dependency->debugSubsumptionLevel;
   setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
-  llvm::BranchInst *binst =
-      llvm::dyn_cast<llvm::BranchInst>(state.prevPC->inst);
   if (binst) {
     ref<Expr> unknownExpression;
     std::string reason = "";
@@ -2482,29 +3229,118 @@ void TxTree::markPathCondition(ExecutionState &state,
       stream << "]";
       stream.flush();
     }
-    currentTxTreeNode->dependency->markAllValues(binst->getCondition(),
-                                                 unknownExpression, reason);
+    dependency->markAllValues(llvm::cast<llvm::BranchInst>(binst)
+                                  ->getCondition(),
+                              unknownExpression, reason);
   }
 
   // We create path condition marking structure and mark core constraints
-  currentTxTreeNode->unsatCoreInterpolation(unsatCore);
+  dependency->unsatCoreInterpolation(unsatCore);
+}
+
+namespace {
+struct AnyCachedUnsatCore {
+  template <class T> bool operator()(const T &) const { return true; }
+};
+}
+
+bool TxTree::lookupUnsatCore(ExecutionState &state, ref<Expr> condition,
+                             Solver::Validity &result,
+                             std::vector<ref<Expr> > &unsatCore) {
+#ifdef ENABLE_Z3
+  if (!UnsatCoreCache)
+    return false;
+
+  ++unsatCoreCacheLookupCount;
+  UnsatCoreCache::iterator it =
+      unsatCoreCache.find(std::make_pair(state.prevPC->inst, condition));
+  if (it == unsatCoreCache.end())
+    return false;
+
+  // A core whose constraints are all in the path condition still implies the
+  // condition or its negation
+  std::set<ref<Expr> > pathCondition(state.constraints.begin(),
+                                     state.constraints.end());
+  CachedUnsatCore *cached =
+      it->second.cores.findSubset(pathCondition, AnyCachedUnsatCore());
+  if (!cached)
+    return false;
+
+  ++unsatCoreCacheHitCount;
+  result = cached->validity;
+  unsatCore = cached->unsatCore;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void TxTree::storeUnsatCore(ExecutionState &state, ref<Expr> condition,
+                            Solver::Validity result,
+                            const std::vector<ref<Expr> > &unsatCore) {
+#ifdef ENABLE_Z3
+  // Not all solvers in the chain compute unsat cores, and an empty core would
+  // match every path condition, so only non-empty cores are cached.
+  if (!UnsatCoreCache || result == Solver::Unknown || unsatCore.empty())
+    return;
+
+  std::pair<UnsatCoreCache::iterator, bool> inserted = unsatCoreCache.insert(
+      std::make_pair(std::make_pair(state.prevPC->inst, condition),
+                     BranchUnsatCores()));
+  if (inserted.second)
+    unsatCoreCacheOrder.push_back(inserted.first);
+
+  BranchUnsatCores &cores = inserted.first->second;
+  if (cores.size >= maxBranchUnsatCores)
+    return;
+
+  std::set<ref<Expr> > key(unsatCore.begin(), unsatCore.end());
+  if (cores.cores.lookup(key))
+    return;
+
+  CachedUnsatCore cached;
+  cached.validity = result;
+  cached.unsatCore = unsatCore;
+  cores.cores.insert(key, cached);
+  ++cores.size;
+  ++unsatCoreCacheSize;
+
+  // Evict the cores of the oldest branch conditions, but never those of the
+  // condition just stored
+  while (MaxUnsatCoreCache && unsatCoreCacheSize > MaxUnsatCoreCache &&
+         unsatCoreCacheOrder.front() != inserted.first) {
+    UnsatCoreCache::iterator oldest = unsatCoreCacheOrder.front();
+    unsatCoreCacheOrder.pop_front();
+    unsatCoreCacheSize -= oldest->second.size;
+    unsatCoreCacheEvictionCount += oldest->second.size;
+    unsatCoreCache.erase(oldest);
+  }
+#endif
 }
 
 void TxTree::executePHI(llvm::Instruction *instr, unsigned incomingBlock,
                         ref<Expr> valueExpr) {
-  currentTxTreeNode->dependency->executePHI(instr, incomingBlock,
-                                            currentTxTreeNode->callHistory,
-                                            valueExpr, symbolicExecutionError);
+  currentTxTreeNode->executePHI(instr, incomingBlock, valueExpr,
+                                symbolicExecutionError);
   symbolicExecutionError = false;
 }
 
 void TxTree::executeOnNode(TxTreeNode *node, llvm::Instruction *instr,
                            std::vector<ref<Expr> > &args) {
-  TimerStatIncrementer t(executeOnNodeTime);
+  TxTimerStatIncrementer t(executeOnNodeTime);
   node->execute(instr, args, symbolicExecutionError);
   symbolicExecutionError = false;
 }
 
+void TxTree::recordOnNode(TxTreeNode *node, llvm::Instruction *instr,
+                          unsigned argCount, ref<Expr> arg1, ref<Expr> arg2,
+                          ref<Expr> arg3) {
+  TxTimerStatIncrementer t(executeOnNodeTime);
+  node->record(instr, argCount, arg1, arg2, arg3, false,
+               symbolicExecutionError);
+  symbolicExecutionError = false;
+}
+
 bool TxTree::isSpeculationNode() {
   return currentTxTreeNode->isSpeculationNode();
 }
@@ -2586,27 +3422,29 @@ void TxTree::dump() const { this->print(llvm::errs()); }
 /**/
 
 // Statistics
-Statistic TxTreeNode::getInterpolantTime("GetInterpolantTime",
-                                         "GetInterpolantTime");
-Statistic TxTreeNode::getWPInterpolantTime("GetWPInterpolantTime",
-                                           "GetWPInterpolantTime");
-Statistic TxTreeNode::addConstraintTime("AddConstraintTime",
-                                        "AddConstraintTime");
-Statistic TxTreeNode::splitTime("SplitTime", "SplitTime");
-Statistic TxTreeNode::executeTime("ExecuteTime", "ExecuteTime");
-Statistic TxTreeNode::bindCallArgumentsTime("BindCallArgumentsTime",
-                                            "BindCallArgumentsTime");
-Statistic TxTreeNode::bindReturnValueTime("BindReturnValueTime",
-                                          "BindReturnValueTime");
-Statistic TxTreeNode::getStoredExpressionsTime("GetStoredExpressionsTime",
-                                               "GetStoredExpressionsTime");
-Statistic
-TxTreeNode::getStoredCoreExpressionsTime("GetStoredCoreExpressionsTime",
-                                         "GetStoredCoreExpressionsTime");
+TxTimerStatistic TxTreeNode::getInterpolantTime("GetInterpolantTime");
+TxTimerStatistic TxTreeNode::getWPInterpolantTime("GetWPInterpolantTime");
+TxTimerStatistic TxTreeNode::addConstraintTime("AddConstraintTime");
+TxTimerStatistic TxTreeNode::splitTime("NodeSplitTime");
+TxTimerStatistic TxTreeNode::executeTime("ExecuteTime");
+TxTimerStatistic TxTreeNode::bindCallArgumentsTime("BindCallArgumentsTime");
+TxTimerStatistic TxTreeNode::bindReturnValueTime("BindReturnValueTime");
+TxTimerStatistic
+TxTreeNode::getStoredExpressionsTime("GetStoredExpressionsTime");
+TxTimerStatistic
+TxTreeNode::getStoredCoreExpressionsTime("GetStoredCoreExpressionsTime");
+
+TxSlabAllocator<TxTreeNode> TxTreeNode::allocator("TxTreeNode");
 
 // The interpolation tree node sequence number
 uint64_t TxTreeNode::nextNodeSequenceNumber = 1;
 
+uint64_t TxTreeNode::recordedInstructionCount = 0;
+
+uint64_t TxTreeNode::discardedInstructionCount = 0;
+
+uint64_t TxTreeNode::allocatedSize = 0;
+
 void TxTreeNode::setPhiValue(llvm::Value *val, ref<Expr> value) {
   if (isa<llvm::Instruction>(val)) {
     llvm::Instruction *instr = dyn_cast<llvm::Instruction>(val);
@@ -2646,14 +3484,16 @@ TxTreeNode::TxTreeNode(
       targetData(_targetData), globalAddresses(_globalAddresses),
       genericEarlyTermination(false), assertionFail(false),
       emitAllErrors(false), isSubsumed(false) {
-  if (_parent) {
-    entryCallHistory = _parent->callHistory;
-    callHistory = _parent->callHistory;
-  }
+  allocatedSize += sizeof(TxTreeNode);
+  entryCallHistory = callHistory =
+      _parent ? _parent->callHistory : TxCallHistory::getEmpty();
 
-  // Inherit the abstract dependency or NULL
-  dependency = new TxDependency(_parent ? _parent->dependency : 0, _targetData,
-                                _globalAddresses);
+  // The dependency of a child is created by createLeftChild or
+  // createRightChild, or lazily by replayTrace
+  dependency = 0;
+  pendingMarking = false;
+  if (!_parent)
+    createDependency();
 
   // Set speculation flag to false
   if (INTERPOLATION_ENABLED && SpecTypeToUse != NO_SPEC) {
@@ -2663,15 +3503,60 @@ TxTreeNode::TxTreeNode(
     specTime = NULL;
   }
 
-  // Set the child WP Interpolants to false
-  if (WPInterpolant) {
-    wp = new TxWeakestPreCondition(this, dependency, _targetData);
-    childWPInterpolant[0] = wp->True();
-    childWPInterpolant[1] = wp->True();
+  if (WPInterpolant && !_parent)
+    createWP();
+}
+
+void TxTreeNode::createDependency() const {
+  // Inherit the abstract dependency, which is first brought up to date, or
+  // NULL
+  TxDependency *parentDependency = 0;
+  if (parent) {
+    parent->replayTrace();
+    parentDependency = parent->dependency;
   }
+  dependency =
+      new TxDependency(parentDependency, targetData, globalAddresses);
+  if (parent) {
+    if (parent->left == this) {
+      parentDependency->setLeftChild(dependency);
+    } else {
+      assert(parent->right == this);
+      parentDependency->setRightChild(dependency);
+    }
+  }
+}
+
+void TxTreeNode::createWP() {
+  // Set the child WP Interpolants to false
+  wp = new TxWeakestPreCondition(this, dependency, targetData);
+  childWPInterpolant[0] = wp->True();
+  childWPInterpolant[1] = wp->True();
+}
+
+TxTreeNode *TxTreeNode::createLeftChild() {
+  left = new TxTreeNode(this, targetData, globalAddresses);
+  // The weakest precondition is computed on the dependency of the node
+  if (!TxTree::lazyDependency || WPInterpolant)
+    left->createDependency();
+  if (WPInterpolant)
+    left->createWP();
+  return left;
+}
+
+TxTreeNode *TxTreeNode::createRightChild() {
+  right = new TxTreeNode(this, targetData, globalAddresses);
+  if (!TxTree::lazyDependency || WPInterpolant)
+    right->createDependency();
+  if (WPInterpolant)
+    right->createWP();
+  return right;
 }
 
 TxTreeNode::~TxTreeNode() {
+  TxTreeGraph::removeNode(this);
+  discardedInstructionCount += trace.size();
+  allocatedSize -= sizeof(TxTreeNode) + trace.size() * sizeof(TraceRecord);
   if (dependency)
     delete dependency;
   if (WPInterpolant && wp) {
@@ -2682,11 +3567,22 @@ TxTreeNode::~TxTreeNode() {
 ref<Expr> TxTreeNode::getInterpolant(
     std::set<const Array *> &replacements,
     std::map<ref<Expr>, ref<Expr> > &substitution) const {
-  TimerStatIncrementer t(getInterpolantTime);
+  TxTimerStatIncrementer t(getInterpolantTime);
+  replayTrace();
   ref<Expr> expr = dependency->packInterpolant(replacements, substitution);
   return expr;
 }
 
+unsigned TxTreeNode::getPendingInterpolantCount() const {
+  unsigned count = 0;
+  for (const TxTreeNode *node = this; node && !node->genericEarlyTermination;
+       node = node->parent) {
+    if (node->storable && !node->isSubsumed)
+      ++count;
+  }
+  return count;
+}
+
 bool TxTreeNode::isSpeculationNode() { return speculationFlag; }
 
 void TxTreeNode::setSpeculationFlag() { speculationFlag = 1; }
@@ -2704,6 +3600,7 @@ void TxTreeNode::storeSpeculationUnsatCore(TimingSolver *solver,
 }
 
 void TxTreeNode::mark() {
+  replayTrace();
   int debugSubsumptionLevel = this->dependency->debugSubsumptionLevel;
   setDebugSubsumptionLevelTxTree(debugSubsumptionLevel);
   llvm::BranchInst *binst = speculationBInst;
@@ -2734,7 +3631,8 @@ void TxTreeNode::mark() {
 }
 
 ref<Expr> TxTreeNode::generateWPInterpolant() {
-  TimerStatIncrementer t(getWPInterpolantTime);
+  TxTimerStatIncrementer t(getWPInterpolantTime);
+  replayTrace();
 
   ref<Expr> expr;
   if (assertionFail && emitAllErrors) {
@@ -2998,14 +3896,23 @@ void TxTreeNode::setWPatSubsumption(ref<Expr> _wpInterpolant) {
 }
 
 void TxTreeNode::addConstraint(ref<Expr> &constraint, llvm::Value *condition) {
-  TimerStatIncrementer t(addConstraintTime);
+  TxTimerStatIncrementer t(addConstraintTime);
+  // The tree graph needs the constraint of the path condition right away
+  if (TxTree::lazyDependency && !TxTreeGraph::isRecordingPathConditions()) {
+    TraceRecord &record = newRecord(TraceRecord::Constraint, 0);
+    record.args[0] = constraint;
+    record.argCount = 1;
+    record.value = condition;
+    return;
+  }
+  replayTrace();
   ref<TxPCConstraint> pcConstraint =
       dependency->addConstraint(constraint, condition, callHistory);
   graph->addPathCondition(this, pcConstraint.get(), constraint);
 }
 
 void TxTreeNode::split(ExecutionState *leftData, ExecutionState *rightData) {
-  TimerStatIncrementer t(splitTime);
+  TxTimerStatIncrementer t(splitTime);
   assert(left == 0 && right == 0);
   leftData->txTreeNode = createLeftChild();
   rightData->txTreeNode = createRightChild();
@@ -3023,13 +3930,130 @@ void TxTreeNode::split(ExecutionState *leftData, ExecutionState *rightData) {
 void TxTreeNode::execute(llvm::Instruction *instr,
                          std::vector<ref<Expr> > &args,
                          bool symbolicExecutionError) {
-  TimerStatIncrementer t(executeTime);
+  TxTimerStatIncrementer t(executeTime);
+  if (TxTree::lazyDependency && args.size() <= 3) {
+    ref<Expr> none;
+    record(instr, args.size(), args.size() > 0 ? args[0] : none,
+           args.size() > 1 ? args[1] : none, args.size() > 2 ? args[2] : none,
+           false, symbolicExecutionError);
+    return;
+  }
+  if (TxTree::lazyDependency) {
+    TraceRecord &record = newRecord(TraceRecord::Instruction, instr);
+    record.argList = args;
+    record.symbolicExecutionError = symbolicExecutionError;
+    return;
+  }
+  replayTrace();
   dependency->execute(instr, callHistory, args, symbolicExecutionError);
 }
 
+void TxTreeNode::executePHI(llvm::Instruction *instr, unsigned incomingBlock,
+                            ref<Expr> valueExpr, bool symbolicExecutionError) {
+  if (TxTree::lazyDependency) {
+    TraceRecord &record = newRecord(TraceRecord::PHI, instr);
+    record.args[0] = valueExpr;
+    record.argCount = 1;
+    record.incomingBlock = incomingBlock;
+    record.symbolicExecutionError = symbolicExecutionError;
+    return;
+  }
+  replayTrace();
+  dependency->executePHI(instr, incomingBlock, callHistory, valueExpr,
+                         symbolicExecutionError);
+}
+
+TxTreeNode::TraceRecord &
+TxTreeNode::newRecord(TraceRecord::Kind kind, llvm::Instruction *instr) {
+  trace.push_back(TraceRecord());
+  allocatedSize += sizeof(TraceRecord);
+  TraceRecord &record = trace.back();
+  record.kind = kind;
+  record.instr = instr;
+  record.callHistory = callHistory;
+  record.argCount = 0;
+  record.value = 0;
+  record.incomingBlock = 0;
+  record.symbolicExecutionError = false;
+  ++recordedInstructionCount;
+  return record;
+}
+
+void TxTreeNode::record(llvm::Instruction *instr, unsigned argCount,
+                        ref<Expr> arg1, ref<Expr> arg2, ref<Expr> arg3,
+                        bool memoryOperation, bool symbolicExecutionError) {
+  TraceRecord &record = newRecord(memoryOperation
+                                      ? TraceRecord::MemoryOperation
+                                      : TraceRecord::Instruction,
+                                  instr);
+  record.args[0] = arg1;
+  record.args[1] = arg2;
+  record.args[2] = arg3;
+  record.argCount = argCount;
+  record.symbolicExecutionError = symbolicExecutionError;
+}
+
+void TxTreeNode::applyTrace() const {
+  // The trace is emptied before the replay, so that the node is consistent
+  // should the dependency call back into it
+  std::vector<TraceRecord> records;
+  records.swap(trace);
+  allocatedSize -= records.size() * sizeof(TraceRecord);
+  pendingMarking = false;
+
+  // A single argument vector is reused for the records of at most three
+  // arguments
+  std::vector<ref<Expr> > args;
+  args.reserve(3);
+  for (std::vector<TraceRecord>::iterator it = records.begin(),
+                                          ie = records.end();
+       it != ie; ++it) {
+    args.assign(it->args, it->args + it->argCount);
+    switch (it->kind) {
+    case TraceRecord::Instruction:
+      dependency->execute(it->instr, it->callHistory,
+                          it->argList.empty() ? args : it->argList,
+                          it->symbolicExecutionError);
+      break;
+    case TraceRecord::MemoryOperation:
+      dependency->executeMemoryOperation(it->instr, it->callHistory, args,
+                                         true, it->symbolicExecutionError);
+      break;
+    case TraceRecord::PHI:
+      dependency->executePHI(it->instr, it->incomingBlock, it->callHistory,
+                             it->args[0], it->symbolicExecutionError);
+      break;
+    case TraceRecord::Constraint:
+      dependency->addConstraint(it->args[0], it->value, it->callHistory);
+      break;
+    case TraceRecord::CallArguments:
+      dependency->bindCallArguments(it->instr, it->callHistory, it->argList);
+      break;
+    case TraceRecord::ReturnValue:
+      dependency->bindReturnValue(
+          llvm::cast_or_null<llvm::CallInst>(it->instr), it->callHistory,
+          llvm::cast_or_null<llvm::Instruction>(it->value), it->args[0]);
+      break;
+    case TraceRecord::Infeasibility:
+      applyInfeasibility(it->instr, it->argList);
+      break;
+    }
+  }
+}
+
 void TxTreeNode::bindCallArguments(llvm::Instruction *site,
                                    std::vector<ref<Expr> > &arguments) {
-  TimerStatIncrementer t(bindCallArgumentsTime);
+  TxTimerStatIncrementer t(bindCallArgumentsTime);
+  if (TxTree::lazyDependency) {
+    newRecord(TraceRecord::CallArguments, site).argList = arguments;
+    // The call history of the node is updated right away, as the dependency
+    // would when the record is replayed
+    llvm::CallInst *callInst = llvm::dyn_cast<llvm::CallInst>(site);
+    if (callInst && callInst->getCalledFunction())
+      callHistory = callHistory->push(site);
+    return;
+  }
+  replayTrace();
   dependency->bindCallArguments(site, callHistory, arguments);
 }
 
@@ -3037,16 +4061,27 @@ void TxTreeNode::bindReturnValue(llvm::CallInst *site, llvm::Instruction *inst,
                                  ref<Expr> returnValue) {
   // TODO: This is probably where we should simplify
   // the dependency graph by removing callee values.
-  TimerStatIncrementer t(bindReturnValueTime);
+  TxTimerStatIncrementer t(bindReturnValueTime);
+  if (TxTree::lazyDependency) {
+    TraceRecord &record = newRecord(TraceRecord::ReturnValue, site);
+    record.args[0] = returnValue;
+    record.argCount = 1;
+    record.value = inst;
+    llvm::ReturnInst *retInst = llvm::dyn_cast<llvm::ReturnInst>(inst);
+    if (site && retInst && retInst->getReturnValue())
+      callHistory = callHistory->pop();
+    return;
+  }
+  replayTrace();
   dependency->bindReturnValue(site, callHistory, inst, returnValue);
 }
 
 void TxTreeNode::getStoredExpressions(
-    const std::vector<llvm::Instruction *> &_callHistory, bool &leftRetrieval,
+    const TxCallHistory *_callHistory, bool &leftRetrieval,
     TxStore::TopStateStore &__internalStore,
     TxStore::LowerStateStore &__concretelyAddressedHistoricalStore,
     TxStore::LowerStateStore &__symbolicallyAddressedHistoricalStore) const {
-  TimerStatIncrementer t(getStoredExpressionsTime);
+  TxTimerStatIncrementer t(getStoredExpressionsTime);
   std::map<ref<Expr>, ref<Expr> > dummySubstitution;
   std::set<const Array *> dummyReplacements;
 
@@ -3054,6 +4089,7 @@ void TxTreeNode::getStoredExpressions(
   // the allocations to be stored in subsumption table should be obtained
   // from the parent node.
   if (parent) {
+    replayTrace();
     dependency->getParentStoredExpressions(
         _callHistory, dummySubstitution, dummyReplacements, false,
         leftRetrieval, __internalStore, __concretelyAddressedHistoricalStore,
@@ -3062,7 +4098,7 @@ void TxTreeNode::getStoredExpressions(
 }
 
 void TxTreeNode::getStoredCoreExpressions(
-    const std::vector<llvm::Instruction *> &_callHistory,
+    const TxCallHistory *_callHistory,
     const std::map<ref<Expr>, ref<Expr> > &substitution,
     std::set<const Array *> &replacements,
     TxStore::TopInterpolantStore &concretelyAddressedStore,
@@ -3070,12 +4106,13 @@ void TxTreeNode::getStoredCoreExpressions(
     TxStore::LowerInterpolantStore &concretelyAddressedHistoricalStore,
     TxStore::LowerInterpolantStore &symbolicallyAddressedHistoricalStore)
     const {
-  TimerStatIncrementer t(getStoredCoreExpressionsTime);
+  TxTimerStatIncrementer t(getStoredCoreExpressionsTime);
 
   // Since a program point index is a first statement in a basic block,
   // the allocations to be stored in subsumption table should be obtained
   // from the parent node.
   if (parent) {
+    replayTrace();
     dependency->getParentStoredCoreExpressions(
         _callHistory, substitution, replacements, true,
         concretelyAddressedStore, symbolicallyAddressedStore,
@@ -3090,6 +4127,7 @@ void TxTreeNode::incInstructionsDepth() { ++instructionsDepth; }
 
 void
 TxTreeNode::unsatCoreInterpolation(const std::vector<ref<Expr> > &unsatCore) {
+  replayTrace();
   dependency->unsatCoreInterpolation(unsatCore);
 }
 
@@ -3126,14 +4164,12 @@ void TxTreeNode::print(llvm::raw_ostream &stream,
     stream << "\n";
   }
   stream << tabsNext << "Call history:\n";
-  for (std::vector<llvm::Instruction *>::const_reverse_iterator
-           it = callHistory.rbegin(),
-           ie = callHistory.rend();
-       it != ie; ++it) {
+  for (const TxCallHistory *it = callHistory; !it->empty(); it = it->pop()) {
     stream << tabsNext;
-    (*it)->print(stream);
+    it->getCallSite()->print(stream);
     stream << "\n";
   }
+  replayTrace();
   if (dependency) {
     stream << tabsNext << "------- Abstract Dependencies ----------\n";
     dependency->print(stream, paddingAmount + 1, debugSubsumptionLevel);
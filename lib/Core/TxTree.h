@@ -20,9 +20,11 @@
 #include "klee/CommandLine.h"
 #include "klee/Config/Version.h"
 #include "klee/ExecutionState.h"
+#include "klee/Internal/ADT/MapOfSets.h"
+#include "klee/Internal/ADT/TxSlabAllocator.h"
 #include "klee/Solver.h"
 #include "klee/Statistic.h"
-#include "klee/TimerStatIncrementer.h"
+#include "klee/TxTimerStatIncrementer.h"
 #include "klee/util/ExprVisitor.h"
 #include "klee/util/TxTreeGraph.h"
 
@@ -33,6 +35,9 @@
 #include "llvm/IR/GlobalValue.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <deque>
+#include <list>
+
 namespace klee {
 
 class TxWeakestPreCondition;
@@ -51,64 +56,130 @@ class TxWeakestPreCondition;
 ///
 /// \see TxSubsumptionTableEntry
 class TxSubsumptionTable {
+  friend class TxInterpolantDatabase;
+
   typedef std::deque<TxSubsumptionTableEntry *>::const_reverse_iterator
   EntryIterator;
 
+  /// \brief The entries of a program point, indexed by the id of their
+  /// interned call history.
   class CallHistoryIndexedTable {
-    class Node {
-      friend class CallHistoryIndexedTable;
+    std::map<uint64_t, std::deque<TxSubsumptionTableEntry *> > entryLists;
 
-      llvm::Instruction *id;
+  public:
+    CallHistoryIndexedTable() {}
+
+    ~CallHistoryIndexedTable();
+
+    /// \brief Insert an entry into the table.
+    ///
+    /// \return The list in which the entry is stored, for later removal.
+    std::deque<TxSubsumptionTableEntry *> *
+    insert(const TxCallHistory *callHistory, TxSubsumptionTableEntry *entry);
+
+    /// \brief Retrieve the entries whose call history is a prefix of the
+    /// given one, found by walking the call history up the interned trie
+    /// towards the empty call history.
+    ///
+    /// The entries of the longest prefix come first, and within the entries
+    /// of a prefix the newest come first, as the successful subsumption
+    /// mostly happens with the newest entry of the most specific context.
+    ///
+    /// \return true if there is at least one entry.
+    bool find(const TxCallHistory *callHistory,
+              std::vector<TxSubsumptionTableEntry *> &entries) const;
+
+    /// \brief Tests whether there are entries whose call history is a prefix
+    /// of the given one.
+    bool hasEntries(const TxCallHistory *callHistory) const;
+
+    /// \brief The number of entries of the program point
+    uint64_t size() const;
 
-      std::deque<TxSubsumptionTableEntry *> entryList;
+    void dump() const {
+      this->print(llvm::errs());
+      llvm::errs() << "\n";
+    }
 
-      std::map<llvm::Instruction *, Node *> next;
+    void print(llvm::raw_ostream &stream) const;
+  };
 
-      Node(llvm::Instruction *_id) : id(_id) {}
+  static std::map<uintptr_t, CallHistoryIndexedTable *> instance;
 
-      void dump() const {
-        this->print(llvm::errs());
-        llvm::errs() << "\n";
-      }
+  /// \brief All entries in the table, ordered such that the front is the
+  /// first candidate for eviction when the table is bounded.
+  static std::list<TxSubsumptionTableEntry *> evictionQueue;
 
-      void print(llvm::raw_ostream &stream) const;
+  /// \brief The approximate number of bytes used by the table entries
+  static uint64_t currentSize;
 
-      void print(llvm::raw_ostream &stream, const unsigned paddingAmount, int debugSubsumptionLevel) const;
+  static uint64_t peakSize;
 
-      void print(llvm::raw_ostream &stream, const std::string &prefix, int debugSubsumptionLevel) const;
-    };
+  static uint64_t peakEntryCount;
 
-    Node *root;
+  /// \brief Number of entries evicted due to -max-subsumption-failure
+  static uint64_t entryLimitEvictionCount;
 
-    void printNode(llvm::raw_ostream &stream, Node *n, std::string edges, int debugSubsumptionLevel) const;
+  /// \brief Number of entries evicted due to -max-subsumption-table-memory
+  static uint64_t memoryLimitEvictionCount;
 
-  public:
-    CallHistoryIndexedTable() { root = new Node(0); }
+  /// \brief Number of evicted entries which never subsumed any state
+  static uint64_t unusedEvictionCount;
 
-    ~CallHistoryIndexedTable() { clearTree(root); }
+  /// \brief Number of entries evicted by evictUnused
+  static uint64_t memoryPressureEvictionCount;
 
-    void clearTree(Node *node);
+  static uint64_t evictedSize;
 
-    void insert(const std::vector<llvm::Instruction *> &callHistory,
-                TxSubsumptionTableEntry *entry);
+  /// \brief Number of states subsumed by the table entries
+  static uint64_t subsumedStateCount;
 
-    std::pair<EntryIterator, EntryIterator>
-    find(const std::vector<llvm::Instruction *> &callHistory,
-         bool &found) const;
+  /// \brief Number of states subsumed by entries loaded from an interpolant
+  /// database
+  static uint64_t loadedEntryHitCount;
 
-    void dump() const {
-      this->print(llvm::errs());
-      llvm::errs() << "\n";
-    }
+  /// \brief Tests whether any of the table bounds is exceeded
+  static bool overLimit(bool &dueToEntryLimit);
 
-    void print(llvm::raw_ostream &stream) const;
-  };
+  /// \brief Choose the entry to evict according to -subsumption-eviction,
+  /// never choosing the argument entry.
+  static TxSubsumptionTableEntry *selectVictim(TxSubsumptionTableEntry *keep);
 
-  static std::map<uintptr_t, CallHistoryIndexedTable *> instance;
+  /// \brief Remove an entry from the table and delete it
+  static void evict(TxSubsumptionTableEntry *entry);
+
+  /// \brief Update the eviction bookkeeping after a subsumption attempt
+  static void recordAttempt(TxSubsumptionTableEntry *entry, bool success);
+
+#ifdef ENABLE_Z3
+  /// \brief The solver of -parallel-subsumption, created on first use
+  static Z3ParallelSolver *parallelSolver;
+
+  /// \brief Solving time in seconds of the parallel queries which decided
+  /// subsumption
+  static double usefulParallelTime;
+
+  /// \brief Solving time in seconds of the other parallel queries
+  static double wastedParallelTime;
+
+  static uint64_t parallelBatchCount;
+
+  /// \brief Check the candidate entries against the state, solving the
+  /// queries of -parallel-subsumption entries at a time in parallel.
+  ///
+  /// \return The first entry found to subsume the state, or null.
+  static TxSubsumptionTableEntry *checkInParallel(
+      TimingSolver *solver, ExecutionState &state, double timeout,
+      int debugSubsumptionLevel,
+      const std::vector<TxSubsumptionTableEntry *> &candidates,
+      bool leftRetrieval, TxStore::TopStateStore &__internalStore,
+      TxStore::LowerStateStore &__concretelyAddressedHistoricalStore,
+      TxStore::LowerStateStore &__symbolicallyAddressedHistoricalStore);
+#endif
 
 public:
   static void insert(uintptr_t id,
-                     const std::vector<llvm::Instruction *> &callHistory,
+                     const TxCallHistory *callHistory,
                      TxSubsumptionTableEntry *entry);
 
   static bool check(TimingSolver *solver, ExecutionState &state, double timeout,
@@ -116,8 +187,35 @@ public:
 
   static bool hasInterpolation(ExecutionState &state);
 
+  /// \brief Tests whether the table has entries for the program point with
+  /// the given call history or a prefix of it
+  static bool hasEntries(uintptr_t programPoint,
+                         const TxCallHistory *callHistory);
+
+  static uint64_t getEntryCount() { return evictionQueue.size(); }
+
+  static uint64_t getSubsumedStateCount() { return subsumedStateCount; }
+
+  static uint64_t getApproximateSize() { return currentSize; }
+
+  /// \brief The number of program points with table entries
+  static uint64_t getProgramPointCount() { return instance.size(); }
+
+  /// \brief The largest number of entries of a program point
+  static uint64_t getMaxProgramPointEntryCount();
+
+  /// \brief Evict the entries which have never subsumed any state, oldest
+  /// first, until the given number of bytes is released. This is the first
+  /// response to memory pressure.
+  ///
+  /// \return The approximate number of bytes released.
+  static uint64_t evictUnused(uint64_t bytes);
+
   static void clear();
 
+  /// \brief For printing table bounding and parallel subsumption statistics
+  static void printStat(std::stringstream &stream);
+
   static void print(llvm::raw_ostream &stream) {
     for (std::map<uintptr_t, CallHistoryIndexedTable *>::const_iterator
              it = instance.begin(),
@@ -161,17 +259,97 @@ public:
 class TxSubsumptionTableEntry {
   friend class TxTree;
 
+  friend class TxSubsumptionTable;
+
+  friend class TxInterpolantDatabase;
+
+public:
+  /// \brief A cheap summary of a table entry or of a state used for
+  /// rejecting table entries before running the subsumption check.
+  ///
+  /// A table entry cannot subsume a state whenever the entry mentions an
+  /// allocation context (allocation site and call history) that does not
+  /// exist in the state, whenever it has more historical store elements than
+  /// the state, or whenever the predecessor program point of a phi node
+  /// differs. The allocation contexts are summarized in a Bloom filter, which
+  /// has no false negatives, such that the rejection is sound.
+  struct Signature {
+    enum {
+      FilterWords = 4
+    };
+
+    /// \brief Bloom filter of the allocation contexts
+    uint64_t contextFilter[FilterWords];
+
+    /// \brief The number of allocation contexts
+    uint64_t contextCount;
+
+    /// \brief The number of historical store elements
+    uint64_t historicalCount;
+
+    /// \brief The predecessor program point, 0 when not at a phi node
+    uintptr_t prevProgramPoint;
+
+    Signature() : contextCount(0), historicalCount(0), prevProgramPoint(0) {
+      for (unsigned i = 0; i < FilterWords; ++i)
+        contextFilter[i] = 0;
+    }
+
+    void addContext(ref<TxAllocationContext> context);
+
+    /// \brief Create the signature of a state to be checked for subsumption
+    static Signature
+    create(ExecutionState &state, const TxStore::TopStateStore &__internalStore,
+           const TxStore::LowerStateStore &__concretelyAddressedHistoricalStore,
+           const TxStore::LowerStateStore &
+               __symbolicallyAddressedHistoricalStore);
+
+    /// \brief Tests if a table entry of this signature may possibly subsume
+    /// a state of the argument signature.
+    bool mayMatch(const Signature &stateSignature) const;
+  };
+
+  /// \brief The query of a subsumption check left to the caller to solve,
+  /// and the values to mark when it is found valid
+  struct DeferredCheck {
+    ref<Expr> query;
+
+    /// \brief The fingerprint of the query, for recording its failure
+    uint64_t fingerprint;
+
+    std::set<ref<TxStateValue> > coreValues;
+
+    std::map<ref<TxStateValue>, std::set<uint64_t> > corePointerValues;
+
+    DeferredCheck() : fingerprint(0) {}
+  };
+
+private:
+
 #ifdef ENABLE_Z3
   /// \brief Mark begin and end of subsumption check for use within a scope
   struct SubsumptionCheckMarker {
     SubsumptionCheckMarker() { Z3Solver::subsumptionCheck = true; }
     ~SubsumptionCheckMarker() { Z3Solver::subsumptionCheck = false; }
   };
+
+  /// \brief The solver for existentially-quantified subsumption queries.
+  ///
+  /// The path condition of the state is asserted into it once per
+  /// TxSubsumptionTable#check call, and the query of each table entry is
+  /// checked incrementally on top of it.
+  static Z3Solver *quantifiedQuerySolver;
+
+  /// \brief Terminate the incremental session of the quantified query solver
+  static void endQuantifiedQuerySession();
+
+  /// \brief Delete the quantified query solver
+  static void deleteQuantifiedQuerySolver();
 #endif
 
-  static Statistic concretelyAddressedStoreExpressionBuildTime;
-  static Statistic symbolicallyAddressedStoreExpressionBuildTime;
-  static Statistic solverAccessTime;
+  static TxTimerStatistic concretelyAddressedStoreExpressionBuildTime;
+  static TxTimerStatistic symbolicallyAddressedStoreExpressionBuildTime;
+  static TxTimerStatistic solverAccessTime;
 
   ref<Expr> interpolant;
 
@@ -189,11 +367,72 @@ class TxSubsumptionTableEntry {
 
   std::set<const Array *> existentials;
 
+  /// \brief The call history at the entry of the node of this entry
+  const TxCallHistory *callHistory;
+
   // Used to ensure at subsumption the value of the phiNodes in the subsumed
   // tree remain the same
   uintptr_t prevProgramPoint;
   std::map<llvm::Value *, std::vector<ref<Expr> > > phiValues;
 
+  /// \brief Number of subsumption checks against this entry
+  uint64_t attemptCount;
+
+  /// \brief Number of successful subsumption checks against this entry
+  uint64_t hitCount;
+
+  /// \brief Whether the entry was loaded from an interpolant database
+  bool loaded;
+
+  /// \brief The approximate size in bytes, computed at table insertion
+  uint64_t approximateSize;
+
+  /// \brief The table list this entry is stored in
+  std::deque<TxSubsumptionTableEntry *> *container;
+
+  /// \brief The position of this entry in TxSubsumptionTable#evictionQueue
+  std::list<TxSubsumptionTableEntry *>::iterator evictionPosition;
+
+  /// \brief The signature for pre-filtering, computed at table insertion
+  Signature signature;
+
+  /// \brief Number of subsumption checks rejected by the signature
+  static uint64_t signatureRejectionCount;
+
+  /// \brief The maximum size of #failedQueryFingerprints
+  static const unsigned maxFailedQueryFingerprints = 256;
+
+  /// \brief The fingerprints of the subsumption queries against this entry
+  /// which the solver did not find valid, for -subsumption-failure-cache
+  std::set<uint64_t> failedQueryFingerprints;
+
+  /// \brief Number of solver calls for subsumption check looked up in, and
+  /// skipped due to, #failedQueryFingerprints
+  static uint64_t failureCacheLookupCount;
+  static uint64_t failureCacheHitCount;
+
+  /// \brief Compute a hash of the subsumption query and of the constraints of
+  /// the path condition which share arrays with it, directly or through other
+  /// constraints. The validity of the query only depends on these.
+  static uint64_t fingerprintQuery(const ConstraintManager &constraints,
+                                   ref<Expr> query);
+
+  /// \brief Tests if the query is known to fail against this entry, and if
+  /// not, returns its fingerprint for recordQueryFailure.
+  bool isKnownQueryFailure(const ConstraintManager &constraints,
+                           ref<Expr> query, uint64_t &fingerprint);
+
+  /// \brief Remember that the solver did not find the query of the
+  /// fingerprint valid
+  void recordQueryFailure(uint64_t fingerprint);
+
+  /// \brief Compute the signature of this entry
+  void computeSignature();
+
+  /// \brief Compute the approximate number of bytes used by this entry,
+  /// counting shared expression nodes once.
+  uint64_t computeApproximateSize() const;
+
   /// \brief A procedure for building subsumption check constraints using
   /// symbolically-addressed store elements
   ///
@@ -311,16 +550,38 @@ public:
   const uint64_t nodeSequenceNumber;
 
   TxSubsumptionTableEntry(TxTreeNode *node,
-                          const std::vector<llvm::Instruction *> &callHistory);
+                          const TxCallHistory *callHistory);
+
+  /// \brief Constructor for an entry loaded from an interpolant database, of
+  /// the interpolant and its existential variables. The stores and the phi
+  /// values are filled in by TxInterpolantDatabase.
+  TxSubsumptionTableEntry(uintptr_t _programPoint, uintptr_t _prevProgramPoint,
+                          const TxCallHistory *_callHistory,
+                          ref<Expr> _interpolant,
+                          const std::set<const Array *> &_existentials);
 
   ~TxSubsumptionTableEntry();
 
+  /// \brief Tests if the state is subsumed by this entry.
+  ///
+  /// \param deferred When not null, the check stops short of calling the
+  /// solver: the query that would have been solved and what is needed to
+  /// complete the check are stored into it and false is returned, so that the
+  /// caller can solve it together with the queries of other entries. Its
+  /// query is left null when the check is decided without the solver.
   bool
   subsumed(TimingSolver *solver, ExecutionState &state, double timeout,
            bool leftRetrieval, TxStore::TopStateStore &__internalStore,
            TxStore::LowerStateStore &__concretelyAddressedHistoricalStore,
            TxStore::LowerStateStore &__symbolicallyAddressedHistoricalStore,
-           int debugSubsumptionLevel);
+           int debugSubsumptionLevel, DeferredCheck *deferred = 0);
+
+  /// \brief Complete a deferred check whose query the caller found valid:
+  /// mark the unsatisfiability core and the values the check relied on, as
+  /// subsumed() does after solving the query itself.
+  void completeDeferred(ExecutionState &state, DeferredCheck &deferred,
+                        const std::vector<ref<Expr> > &unsatCore,
+                        int debugSubsumptionLevel);
 
   /// Tests if the argument is a variable. A variable here is defined to be
   /// either a symbolic concatenation or a symbolic read. A concatenation in
@@ -411,22 +672,73 @@ class TxTreeNode {
   // Timers for profiling the execution times of the member functions of this
   // class
 
-  static Statistic getInterpolantTime;
-  static Statistic getWPInterpolantTime;
-  static Statistic addConstraintTime;
-  static Statistic splitTime;
-  static Statistic executeTime;
-  static Statistic bindCallArgumentsTime;
-  static Statistic bindReturnValueTime;
-  static Statistic getStoredExpressionsTime;
-  static Statistic getStoredCoreExpressionsTime;
+  static TxTimerStatistic getInterpolantTime;
+  static TxTimerStatistic getWPInterpolantTime;
+  static TxTimerStatistic addConstraintTime;
+  static TxTimerStatistic splitTime;
+  static TxTimerStatistic executeTime;
+  static TxTimerStatistic bindCallArgumentsTime;
+  static TxTimerStatistic bindReturnValueTime;
+  static TxTimerStatistic getStoredExpressionsTime;
+  static TxTimerStatistic getStoredCoreExpressionsTime;
+
+  /// \brief The slab allocator of the objects of this class
+  static TxSlabAllocator<TxTreeNode> allocator;
 
   /// \brief Counter for the next visited node id for logging and debugging
   /// purposes
   static uint64_t nextNodeSequenceNumber;
 
-  /// \brief Value dependencies
-  TxDependency *dependency;
+  /// \brief Value dependencies. With -lazy-dependency, the dependency of a
+  /// child node is only created by replayTrace, when it is first accessed.
+  mutable TxDependency *dependency;
+
+  /// \brief An operation on this node with -lazy-dependency, not yet applied
+  /// to #dependency
+  struct TraceRecord {
+    enum Kind {
+      Instruction,
+      MemoryOperation,
+      PHI,
+      Constraint,
+      CallArguments,
+      ReturnValue,
+      Infeasibility
+    };
+
+    Kind kind;
+    llvm::Instruction *instr;
+    const TxCallHistory *callHistory;
+    ref<Expr> args[3];
+    unsigned argCount;
+    /// \brief The arguments of a call or of an instruction of more than
+    /// three arguments, or the unsat core of an infeasibility
+    std::vector<ref<Expr> > argList;
+    /// \brief The condition of a constraint, or the instruction receiving a
+    /// return value
+    llvm::Value *value;
+    /// \brief The incoming block of a PHI
+    unsigned incomingBlock;
+    bool symbolicExecutionError;
+  };
+
+  /// \brief The operations on this node not yet applied to #dependency, in
+  /// order of execution. Any member function that accesses #dependency first
+  /// replays them by calling replayTrace.
+  mutable std::vector<TraceRecord> trace;
+
+  /// \brief Whether #trace has an infeasibility, whose marking also applies
+  /// to the ancestors, hence which is not to be discarded with the node
+  mutable bool pendingMarking;
+
+  /// \brief Numbers of instructions recorded in the traces, and of those
+  /// discarded with their nodes without ever being replayed
+  static uint64_t recordedInstructionCount;
+  static uint64_t discardedInstructionCount;
+
+  /// \brief The approximate number of bytes used by the live nodes and their
+  /// traces, not counting their dependency information
+  static uint64_t allocatedSize;
 
   // \brief The pointer to solver is temporarily stored here and in case
   // speculation is failed it's used to do marking related to the infeasible
@@ -505,6 +817,43 @@ class TxTreeNode {
   void execute(llvm::Instruction *instr, std::vector<ref<Expr> > &args,
                bool symbolicExecutionError);
 
+  /// \brief Append a record of the kind to #trace
+  TraceRecord &newRecord(TraceRecord::Kind kind, llvm::Instruction *instr);
+
+  /// \brief Record the execution of an instruction of at most three
+  /// arguments, or of a memory operation, in #trace
+  void record(llvm::Instruction *instr, unsigned argCount, ref<Expr> arg1,
+              ref<Expr> arg2, ref<Expr> arg3, bool memoryOperation,
+              bool symbolicExecutionError);
+
+  /// \brief Create #dependency if not yet created, and apply the operations
+  /// recorded in #trace to it
+  void replayTrace() const {
+    if (!dependency)
+      createDependency();
+    if (!trace.empty())
+      applyTrace();
+  }
+
+  /// \brief Create #dependency from the dependency of the parent, which is
+  /// first brought up to date
+  void createDependency() const;
+
+  void applyTrace() const;
+
+  /// \brief Mark the values of an infeasible branch and its unsat core
+  void applyInfeasibility(llvm::Instruction *binst,
+                          const std::vector<ref<Expr> > &unsatCore) const;
+
+  /// \brief The dependency of the node, or of its nearest ancestor which has
+  /// one, for the debugging levels, which the children inherit
+  const TxDependency *getNearestDependency() const {
+    const TxTreeNode *node = this;
+    while (!node->dependency)
+      node = node->parent;
+    return node->dependency;
+  }
+
   void print(llvm::raw_ostream &stream, const unsigned paddingAmount, int debugSubsumptionLevel) const;
 
   TxTreeNode(TxTreeNode *_parent, llvm::DataLayout *_targetData,
@@ -519,19 +868,20 @@ class TxTreeNode {
     return new TxTreeNode(0, targetData, globalAddresses);
   }
 
-  TxTreeNode *createLeftChild() {
-    left = new TxTreeNode(this, targetData, globalAddresses);
-    dependency->setLeftChild(left->dependency);
-    return left;
-  }
+  TxTreeNode *createLeftChild();
 
-  TxTreeNode *createRightChild() {
-    right = new TxTreeNode(this, targetData, globalAddresses);
-    dependency->setRightChild(right->dependency);
-    return right;
-  }
+  TxTreeNode *createRightChild();
+
+  /// \brief Create the weakest precondition of the node, for -wp-interpolant
+  void createWP();
 
 public:
+  static void *operator new(size_t size) { return allocator.allocate(size); }
+
+  static void operator delete(void *p, size_t size) {
+    allocator.deallocate(p, size);
+  }
+
   bool isSubsumed;
 
   // \brief The unsat core from a infeasible path is temporarily stored here
@@ -557,10 +907,10 @@ public:
   std::map<llvm::Instruction *, unsigned> phiNodeArg;
 
   /// \brief The entry call history
-  std::vector<llvm::Instruction *> entryCallHistory;
+  const TxCallHistory *entryCallHistory;
 
   /// \brief The current call history
-  std::vector<llvm::Instruction *> callHistory;
+  const TxCallHistory *callHistory;
 
   uintptr_t getProgramPoint() { return programPoint; }
   llvm::BasicBlock *getBasicBlock() { return basicBlock; }
@@ -575,7 +925,10 @@ public:
 
   uint64_t getNodeSequenceNumber() { return nodeSequenceNumber; }
 
-  TxDependency *getDependency() { return dependency; }
+  TxDependency *getDependency() {
+    replayTrace();
+    return dependency;
+  }
 
   std::map<llvm::Value *, std::vector<ref<Expr> > > getPhiValue() {
     return phiValues;
@@ -583,6 +936,23 @@ public:
 
   void setPhiValue(llvm::Value *instr, ref<Expr> value);
 
+  /// \brief Abstractly execute a PHI instruction
+  void executePHI(llvm::Instruction *instr, unsigned incomingBlock,
+                  ref<Expr> valueExpr, bool symbolicExecutionError);
+
+  /// \brief Mark the values of the condition of an infeasible branch, if
+  /// any, and the constraints of the unsat core of its infeasibility
+  void markInfeasibility(llvm::BranchInst *binst,
+                         const std::vector<ref<Expr> > &unsatCore);
+
+  int getDebugSubsumptionLevel() const {
+    return getNearestDependency()->debugSubsumptionLevel;
+  }
+
+  uint64_t getDebugStateLevel() const {
+    return getNearestDependency()->debugStateLevel;
+  }
+
   /// \brief Retrieve the interpolant for this node as KLEE expression object
   ///
   /// \param replacements The replacement bound variables for replacing the
@@ -683,7 +1053,7 @@ public:
   /// arguments a pair of the store part indexed by constants, and the store
   /// part indexed by symbolic expressions.
   void getStoredExpressions(
-      const std::vector<llvm::Instruction *> &callHistory, bool &leftRetrieval,
+      const TxCallHistory *callHistory, bool &leftRetrieval,
       TxStore::TopStateStore &__internalStore,
       TxStore::LowerStateStore &__concretelyAddressedHistoricalStore,
       TxStore::LowerStateStore &__symbolicallyAddressedHistoricalStore) const;
@@ -700,7 +1070,7 @@ public:
   /// be used for storing in the subsumption table, the variables need to be
   /// replaced with the bound ones.
   void getStoredCoreExpressions(
-      const std::vector<llvm::Instruction *> &callHistory,
+      const TxCallHistory *callHistory,
       const std::map<ref<Expr>, ref<Expr> > &substitution,
       std::set<const Array *> &replacements,
       TxStore::TopInterpolantStore &concretelyAddressedStore,
@@ -722,30 +1092,44 @@ public:
   bool pointerValuesInterpolation(ref<TxStateValue> value,
                                   std::set<uint64_t> &bounds,
                                   const std::string &reason) {
+    replayTrace();
     return dependency->markAllPointerValues(value, bounds, reason);
   }
 
   /// \brief Interpolation for memory bound violation
   void memoryBoundViolationInterpolation(llvm::Instruction *inst,
                                          ref<Expr> address) {
+    replayTrace();
     dependency->memoryBoundViolationInterpolation(inst, address);
   }
 
   /// \brief Exact / non-pointer value interpolation
   void valuesInterpolation(ref<TxStateValue> value, const std::string &reason) {
+    replayTrace();
     dependency->markAllValues(value, reason);
   }
 
   void setGenericEarlyTermination() { genericEarlyTermination = true; }
 
+  /// \brief The number of interpolants that would no longer be tabled if the
+  /// state of this node were terminated early: those of the node and of its
+  /// ancestors up to the first one already marked for early termination.
+  unsigned getPendingInterpolantCount() const;
+
   void setAssertionFail(bool _emitAllErrors) {
     assertionFail = true;
     emitAllErrors = _emitAllErrors;
   }
 
-  TxStore *getStore() const { return dependency->getStore(); }
+  TxStore *getStore() const {
+    replayTrace();
+    return dependency->getStore();
+  }
 
-  TxDependency *getDependency() const { return dependency; }
+  TxDependency *getDependency() const {
+    replayTrace();
+    return dependency;
+  }
 
   /// \brief Print the content of the tree node object to the LLVM error stream.
   void dump() const;
@@ -861,6 +1245,8 @@ public:
 /// \see TxSubsumptionTable
 /// \see TxSubsumptionTableEntry
 class TxTree {
+  friend class TxSubsumptionTable;
+
   typedef std::vector<ref<Expr> > ExprList;
   typedef ExprList::iterator iterator;
   typedef ExprList::const_iterator const_iterator;
@@ -887,22 +1273,69 @@ class TxTree {
   /// two decimal points.
   static std::string inTwoDecimalPoints(const double n);
 
+  /// \brief An unsat core proving a branch condition valid (when the
+  /// validity is Solver::True) or unsatisfiable (Solver::False)
+  struct CachedUnsatCore {
+    Solver::Validity validity;
+
+    std::vector<ref<Expr> > unsatCore;
+  };
+
+  /// \brief The cached unsat cores of a branch condition, keyed by the set of
+  /// constraints of the core
+  struct BranchUnsatCores {
+    MapOfSets<ref<Expr>, CachedUnsatCore> cores;
+
+    unsigned size;
+
+    BranchUnsatCores() : size(0) {}
+  };
+
+  /// \brief The maximum number of unsat cores cached per branch condition
+  static const unsigned maxBranchUnsatCores = 64;
+
+  /// \brief The unsat cores of the branch conditions evaluated to true or
+  /// false, keyed by the branch instruction and the condition, for
+  /// -unsat-core-cache
+  typedef std::map<std::pair<llvm::Instruction *, ref<Expr> >,
+                   BranchUnsatCores> UnsatCoreCache;
+  UnsatCoreCache unsatCoreCache;
+
+  /// \brief The branch conditions of #unsatCoreCache in order of insertion,
+  /// the oldest evicted first when the cache exceeds -max-unsat-core-cache
+  std::deque<UnsatCoreCache::iterator> unsatCoreCacheOrder;
+
+  /// \brief The number of unsat cores in #unsatCoreCache
+  uint64_t unsatCoreCacheSize;
+
+  /// \brief Number of branch evaluations looked up in, and answered by,
+  /// #unsatCoreCache
+  static uint64_t unsatCoreCacheLookupCount;
+  static uint64_t unsatCoreCacheHitCount;
+
+  /// \brief Number of unsat cores evicted from #unsatCoreCache
+  static uint64_t unsatCoreCacheEvictionCount;
+
 public:
   // Several static member variables for profiling the execution time of
   // this class's member functions.
-  static Statistic setCurrentINodeTime;
-  static Statistic removeTime;
-  static Statistic subsumptionCheckTime;
-  static Statistic markPathConditionTime;
-  static Statistic splitTime;
-  static Statistic executeOnNodeTime;
-  static Statistic executeMemoryOperationTime;
+  static TxTimerStatistic setCurrentINodeTime;
+  static TxTimerStatistic removeTime;
+  static TxTimerStatistic subsumptionCheckTime;
+  static TxTimerStatistic markPathConditionTime;
+  static TxTimerStatistic splitTime;
+  static TxTimerStatistic executeOnNodeTime;
+  static TxTimerStatistic executeMemoryOperationTime;
   static double entryNumber;
   static double programPointNumber;
 
   /// \brief Number of subsumption checks for statistical purposes
   static uint64_t subsumptionCheckCount;
 
+  /// \brief Number of instructions of no argument not executed on the nodes
+  /// with -concrete-fast-path
+  static uint64_t skippedInstructionCount;
+
   /// \brief Number of visited basic blocks for statistical purposes
   static uint64_t blockCount;
 
@@ -916,10 +1349,26 @@ public:
   /// may not have been computed.
   static bool symbolicExecutionError;
 
+  /// \brief The value of -lazy-dependency: Whether the instructions are
+  /// recorded in the traces of the nodes, instead of being applied to their
+  /// dependency information as they are executed
+  static bool lazyDependency;
+
+  /// \brief The value of -concrete-fast-path: Whether the instructions that
+  /// leave the dependency information unchanged are skipped by the executor
+  static bool concreteFastPath;
+
   TxTree(ExecutionState *_root, llvm::DataLayout *_targetData,
          std::map<const llvm::GlobalValue *, ref<ConstantExpr> > *
              _globalAddresses);
 
+  /// \brief The approximate number of bytes used by the nodes of the tree
+  /// and their dependency information, maintained as the nodes are created,
+  /// updated and removed
+  static uint64_t getApproximateSize() {
+    return TxTreeNode::allocatedSize + TxDependency::getAllocatedSize();
+  }
+
   ~TxTree() {
     TxSubsumptionTable::clear();
     delete initialStateCopy;
@@ -968,6 +1417,28 @@ public:
   void markPathConditionWithBrInst(llvm::BranchInst *binst,
                                    std::vector<ref<Expr> > &unsatCore);
 
+  /// \brief Evaluate the branch condition of the state from a cached unsat
+  /// core of the same branch condition, when all the constraints of the core
+  /// are in the path condition of the state. On success, the result and the
+  /// unsat core are set as the solver would have set them.
+  bool lookupUnsatCore(ExecutionState &state, ref<Expr> condition,
+                       Solver::Validity &result,
+                       std::vector<ref<Expr> > &unsatCore);
+
+  /// \brief Cache the unsat core of the solver's evaluation of the branch
+  /// condition of the state
+  void storeUnsatCore(ExecutionState &state, ref<Expr> condition,
+                      Solver::Validity result,
+                      const std::vector<ref<Expr> > &unsatCore);
+
+  /// \brief Release all the cached unsat cores, for when the memory is low
+  void clearUnsatCoreCache() {
+    unsatCoreCacheEvictionCount += unsatCoreCacheSize;
+    unsatCoreCache.clear();
+    unsatCoreCacheOrder.clear();
+    unsatCoreCacheSize = 0;
+  }
+
   /// \brief Creates fresh interpolation data holder for the two given KLEE
   /// execution states.
   /// This member function is to be invoked after KLEE splits its own state due
@@ -1010,6 +1481,7 @@ public:
   /// \brief Execution of klee_make_symbolic
   void executeMakeSymbolic(llvm::Instruction *instr, ref<Expr> address,
                            const Array *array) {
+    currentTxTreeNode->replayTrace();
     currentTxTreeNode->dependency->executeMakeSymbolic(
         instr, currentTxTreeNode->callHistory, address, array);
   }
@@ -1034,7 +1506,20 @@ public:
                                            llvm::Instruction *instr,
                                            ref<Expr> value, ref<Expr> address,
                                            bool inBounds) {
-    TimerStatIncrementer t(executeMemoryOperationTime);
+    TxTimerStatIncrementer t(executeMemoryOperationTime);
+
+    // Without -tracerx-pointer-error, the marking of the address never
+    // reports a bounds violation, hence the operation can be deferred. An
+    // out-of-bounds operation does not change the dependency information.
+    if (lazyDependency && !TracerXPointerError) {
+      if (inBounds)
+        node->record(instr, 2, value, address, ref<Expr>(), true,
+                     symbolicExecutionError);
+      symbolicExecutionError = false;
+      return false;
+    }
+
+    node->replayTrace();
     std::vector<ref<Expr> > args;
     args.push_back(value);
     args.push_back(address);
@@ -1047,6 +1532,18 @@ public:
   /// \brief Execute an instruction of no argument for building dependency
   /// information, given a particular interpolation tree node.
   static void executeOnNode(TxTreeNode *node, llvm::Instruction *instr) {
+    // Of the instructions of no argument, only a conditional branch marks
+    // values; the others need neither be executed nor recorded.
+    if (concreteFastPath && (instr->getOpcode() != llvm::Instruction::Br ||
+                             instr->getNumOperands() != 3)) {
+      ++skippedInstructionCount;
+      symbolicExecutionError = false;
+      return;
+    }
+    if (lazyDependency) {
+      recordOnNode(node, instr, 0);
+      return;
+    }
     std::vector<ref<Expr> > dummyArgs;
     executeOnNode(node, instr, dummyArgs);
   }
@@ -1055,6 +1552,10 @@ public:
   /// information, given a particular interpolation tree node.
   static void executeOnNode(TxTreeNode *node, llvm::Instruction *instr,
                             ref<Expr> arg1) {
+    if (lazyDependency) {
+      recordOnNode(node, instr, 1, arg1);
+      return;
+    }
     std::vector<ref<Expr> > args;
     args.push_back(arg1);
     executeOnNode(node, instr, args);
@@ -1064,6 +1565,10 @@ public:
   /// information, given a particular interpolation tree node.
   static void executeOnNode(TxTreeNode *node, llvm::Instruction *instr,
                             ref<Expr> arg1, ref<Expr> arg2) {
+    if (lazyDependency) {
+      recordOnNode(node, instr, 2, arg1, arg2);
+      return;
+    }
     std::vector<ref<Expr> > args;
     args.push_back(arg1);
     args.push_back(arg2);
@@ -1074,6 +1579,10 @@ public:
   /// information, given a particular interpolation tree node.
   static void executeOnNode(TxTreeNode *node, llvm::Instruction *instr,
                             ref<Expr> arg1, ref<Expr> arg2, ref<Expr> arg3) {
+    if (lazyDependency) {
+      recordOnNode(node, instr, 3, arg1, arg2, arg3);
+      return;
+    }
     std::vector<ref<Expr> > args;
     args.push_back(arg1);
     args.push_back(arg2);
@@ -1086,6 +1595,13 @@ public:
   static void executeOnNode(TxTreeNode *node, llvm::Instruction *instr,
                             std::vector<ref<Expr> > &args);
 
+  /// \brief Record an instruction of at most three arguments in the trace of
+  /// the node, with -lazy-dependency
+  static void recordOnNode(TxTreeNode *node, llvm::Instruction *instr,
+                           unsigned argCount, ref<Expr> arg1 = ref<Expr>(),
+                           ref<Expr> arg2 = ref<Expr>(),
+                           ref<Expr> arg3 = ref<Expr>());
+
   /// \brief Check if the current node is a speculation node
   bool isSpeculationNode();
   void incSpecTime(double ts) {
@@ -1120,7 +1636,7 @@ public:
 
   /// \brief Get the current debug state flag
   uint64_t getDebugState() {
-    return currentTxTreeNode->dependency->debugStateLevel;
+    return currentTxTreeNode->getDebugStateLevel();
   }
 };
 }
@@ -51,10 +51,67 @@ std::string TxTreeGraph::NumberedEdge::render() const {
 
 /**/
 
+TxTreeGraph::EventLog::EventLog(const std::string &fileName, TxTreeNode *root)
+    : out(fileName.c_str()), nodeId(0), conditionId(0) {
+  out << "root " << newNode(root) << "\n";
+}
+
+uint64_t TxTreeGraph::EventLog::newNode(TxTreeNode *txTreeNode) {
+  LiveNode &node = liveNodes[txTreeNode];
+  node.id = ++nodeId;
+  return node.id;
+}
+
+uint64_t TxTreeGraph::EventLog::getId(TxTreeNode *txTreeNode) const {
+  std::map<TxTreeNode *, LiveNode>::const_iterator it =
+      liveNodes.find(txTreeNode);
+  return it == liveNodes.end() ? 0 : it->second.id;
+}
+
+std::string TxTreeGraph::EventLog::escape(const std::string &s) {
+  std::string ret;
+  ret.reserve(s.size());
+  for (std::string::const_iterator it = s.begin(), ie = s.end(); it != ie;
+       ++it) {
+    if (*it == '\\')
+      ret += "\\\\";
+    else if (*it == '\n')
+      ret += "\\n";
+    else
+      ret += *it;
+  }
+  return ret;
+}
+
+/**/
+
 uint64_t TxTreeGraph::nodeCount = 1;
 
 TxTreeGraph *TxTreeGraph::instance = 0;
 
+TxTreeGraph::EventLog *TxTreeGraph::eventLog = 0;
+
+std::string TxTreeGraph::getLocation(const ExecutionState &state) {
+  std::string location;
+  llvm::raw_string_ostream out(location);
+  if (llvm::MDNode *n = state.pc->inst->getMetadata("dbg")) {
+    // Display the line, char position of this instruction
+    llvm::DILocation loc(n);
+    unsigned line = loc.getLineNumber();
+    llvm::StringRef file = loc.getFilename();
+    out << file << ":" << line << "\n";
+  } else {
+    state.pc->inst->print(out);
+  }
+  return out.str();
+}
+
+std::string TxTreeGraph::getName(const ExecutionState &state) {
+  std::string functionName(
+      state.pc->inst->getParent()->getParent()->getName().str());
+  return functionName + "\\l" + getLocation(state);
+}
+
 std::string TxTreeGraph::recurseRender(TxTreeGraph::Node *node) {
   std::ostringstream stream;
 
@@ -242,6 +299,22 @@ std::string TxTreeGraph::render() {
   return res;
 }
 
+void TxTreeGraph::initialize(TxTreeNode *root,
+                             const std::string &logFileName) {
+  if (STREAM_INTERPOLATION_TREE) {
+    if (eventLog)
+      delete eventLog;
+    eventLog = new EventLog(logFileName, root);
+  }
+
+  if (!OUTPUT_INTERPOLATION_TREE)
+    return;
+
+  if (!instance)
+    delete instance;
+  instance = new TxTreeGraph(root);
+}
+
 TxTreeGraph::TxTreeGraph(TxTreeNode *_root)
     : subsumptionEdgeNumber(0), internalNodeId(0) {
   root = TxTreeGraph::Node::createNode(0);
@@ -272,6 +345,12 @@ void TxTreeGraph::addChildren(TxTreeNode *parent, TxTreeNode *falseChild,
                               TxTreeNode *trueChild) {
   nodeCount += 2;
 
+  if (eventLog) {
+    eventLog->out << "split " << eventLog->getId(parent) << " "
+                  << eventLog->newNode(falseChild) << " "
+                  << eventLog->newNode(trueChild) << "\n";
+  }
+
   if (!OUTPUT_INTERPOLATION_TREE)
     return;
 
@@ -294,6 +373,35 @@ void TxTreeGraph::addChildren(TxTreeNode *parent, TxTreeNode *falseChild,
 
 void TxTreeGraph::setCurrentNode(ExecutionState &state,
                                  const uint64_t _nodeSequenceNumber) {
+  if (!OUTPUT_INTERPOLATION_TREE && !eventLog)
+    return;
+
+  // Increase the mark addition count when there is a return from a function
+  // named tracerx_mark.
+  bool mark = false;
+  if (llvm::ReturnInst *ri = llvm::dyn_cast<llvm::ReturnInst>(state.pc->inst)) {
+    if (ri->getParent()) {
+      if (llvm::Function *f = ri->getParent()->getParent()) {
+        mark = (f->getName().str() == "tracerx_mark");
+      }
+    }
+  }
+
+  if (eventLog) {
+    std::map<TxTreeNode *, EventLog::LiveNode>::iterator it =
+        eventLog->liveNodes.find(state.txTreeNode);
+    if (it != eventLog->liveNodes.end()) {
+      if (!it->second.visited) {
+        it->second.visited = true;
+        eventLog->out << "visit " << it->second.id << " "
+                      << _nodeSequenceNumber << " "
+                      << EventLog::escape(getName(state)) << "\n";
+      }
+      if (mark)
+        eventLog->out << "mark " << it->second.id << "\n";
+    }
+  }
+
   if (!OUTPUT_INTERPOLATION_TREE)
     return;
 
@@ -302,39 +410,26 @@ void TxTreeGraph::setCurrentNode(ExecutionState &state,
   TxTreeNode *txTreeNode = state.txTreeNode;
   TxTreeGraph::Node *node = instance->txTreeNodeMap[txTreeNode];
   if (!node->nodeSequenceNumber) {
-    std::string functionName(
-        state.pc->inst->getParent()->getParent()->getName().str());
-    node->name = functionName + "\\l";
-    llvm::raw_string_ostream out(node->name);
-    if (llvm::MDNode *n = state.pc->inst->getMetadata("dbg")) {
-      // Display the line, char position of this instruction
-      llvm::DILocation loc(n);
-      unsigned line = loc.getLineNumber();
-      llvm::StringRef file = loc.getFilename();
-      out << file << ":" << line << "\n";
-    } else {
-      state.pc->inst->print(out);
-    }
-    node->name = out.str();
+    node->name = getName(state);
     node->nodeSequenceNumber = _nodeSequenceNumber;
   }
 
-  // Increase the mark addition count when there is a return from a function
-  // named tracerx_mark.
-  if (llvm::ReturnInst *ri = llvm::dyn_cast<llvm::ReturnInst>(state.pc->inst)) {
-    if (ri->getParent()) {
-      if (llvm::Function *f = ri->getParent()->getParent()) {
-        if (f->getName().str() == "tracerx_mark") {
-          (node->markCount)++;
-          (node->markAddition)++;
-        }
-      }
-    }
+  if (mark) {
+    (node->markCount)++;
+    (node->markAddition)++;
   }
 }
 
 void TxTreeGraph::markAsSubsumed(TxTreeNode *txTreeNode,
                                  TxSubsumptionTableEntry *entry) {
+  if (eventLog) {
+    std::map<TxSubsumptionTableEntry *, uint64_t>::iterator it =
+        eventLog->entryNodeIds.find(entry);
+    eventLog->out << "subsumed " << eventLog->getId(txTreeNode) << " "
+                  << (it == eventLog->entryNodeIds.end() ? 0 : it->second)
+                  << "\n";
+  }
+
   if (!OUTPUT_INTERPOLATION_TREE)
     return;
 
@@ -342,14 +437,35 @@ void TxTreeGraph::markAsSubsumed(TxTreeNode *txTreeNode,
 
   TxTreeGraph::Node *node = instance->txTreeNodeMap[txTreeNode];
   node->subsumed = true;
-  TxTreeGraph::Node *subsuming = instance->tableEntryMap[entry];
+  std::map<TxSubsumptionTableEntry *, TxTreeGraph::Node *>::iterator it =
+      instance->tableEntryMap.find(entry);
+  // Entries loaded from an interpolant database have no node in the graph
+  if (it == instance->tableEntryMap.end())
+    return;
   instance->subsumptionEdges.push_back(new TxTreeGraph::NumberedEdge(
-      node, subsuming, ++(instance->subsumptionEdgeNumber)));
+      node, it->second, ++(instance->subsumptionEdgeNumber)));
 }
 
 void TxTreeGraph::addPathCondition(TxTreeNode *txTreeNode,
                                    TxPCConstraint *pathCondition,
                                    ref<Expr> condition) {
+  if (!OUTPUT_INTERPOLATION_TREE && !eventLog)
+    return;
+
+  std::string s = TxPrettyExpressionBuilder::construct(condition);
+
+  if (eventLog) {
+    std::map<TxTreeNode *, EventLog::LiveNode>::iterator it =
+        eventLog->liveNodes.find(txTreeNode);
+    if (it != eventLog->liveNodes.end()) {
+      uint64_t id = ++(eventLog->conditionId);
+      eventLog->conditionIds[pathCondition] = id;
+      it->second.conditions.push_back(pathCondition);
+      eventLog->out << "condition " << it->second.id << " " << id << " "
+                    << EventLog::escape(s) << "\n";
+    }
+  }
+
   if (!OUTPUT_INTERPOLATION_TREE)
     return;
 
@@ -357,8 +473,6 @@ void TxTreeGraph::addPathCondition(TxTreeNode *txTreeNode,
 
   TxTreeGraph::Node *node = instance->txTreeNodeMap[txTreeNode];
 
-  std::string s = TxPrettyExpressionBuilder::construct(condition);
-
   std::pair<std::string, bool> p(s, false);
   node->pathConditionTable[pathCondition] = p;
   instance->pathConditionMap[pathCondition] = node;
@@ -366,6 +480,9 @@ void TxTreeGraph::addPathCondition(TxTreeNode *txTreeNode,
 
 void TxTreeGraph::addTableEntryMapping(TxTreeNode *txTreeNode,
                                        TxSubsumptionTableEntry *entry) {
+  if (eventLog)
+    eventLog->entryNodeIds[entry] = eventLog->getId(txTreeNode);
+
   if (!OUTPUT_INTERPOLATION_TREE)
     return;
 
@@ -375,7 +492,43 @@ void TxTreeGraph::addTableEntryMapping(TxTreeNode *txTreeNode,
   instance->tableEntryMap[entry] = node;
 }
 
+void TxTreeGraph::removeTableEntryMapping(TxSubsumptionTableEntry *entry) {
+  if (eventLog)
+    eventLog->entryNodeIds.erase(entry);
+
+  if (!OUTPUT_INTERPOLATION_TREE)
+    return;
+
+  assert(TxTreeGraph::instance && "Search tree graph not initialized");
+
+  instance->tableEntryMap.erase(entry);
+}
+
+void TxTreeGraph::removeNode(TxTreeNode *txTreeNode) {
+  if (!eventLog)
+    return;
+
+  std::map<TxTreeNode *, EventLog::LiveNode>::iterator it =
+      eventLog->liveNodes.find(txTreeNode);
+  if (it == eventLog->liveNodes.end())
+    return;
+  for (std::vector<TxPCConstraint *>::iterator
+           it1 = it->second.conditions.begin(),
+           ie1 = it->second.conditions.end();
+       it1 != ie1; ++it1) {
+    eventLog->conditionIds.erase(*it1);
+  }
+  eventLog->liveNodes.erase(it);
+}
+
 void TxTreeGraph::setAsCore(TxPCConstraint *pathCondition) {
+  if (eventLog) {
+    std::map<TxPCConstraint *, uint64_t>::iterator it =
+        eventLog->conditionIds.find(pathCondition);
+    if (it != eventLog->conditionIds.end())
+      eventLog->out << "core " << it->second << "\n";
+  }
+
   if (!OUTPUT_INTERPOLATION_TREE)
     return;
 
@@ -388,23 +541,23 @@ void TxTreeGraph::setAsCore(TxPCConstraint *pathCondition) {
 
 void TxTreeGraph::setError(const ExecutionState &state,
                            TxTreeGraph::Error errorType) {
+  if (eventLog) {
+    const char *type = "generic";
+    if (errorType == ASSERTION)
+      type = "assertion";
+    else if (errorType == MEMORY)
+      type = "memory";
+    eventLog->out << "error " << eventLog->getId(state.txTreeNode) << " "
+                  << type << " " << EventLog::escape(getLocation(state))
+                  << "\n";
+  }
+
   if (!OUTPUT_INTERPOLATION_TREE)
     return;
 
   TxTreeGraph::Node *node = instance->txTreeNodeMap[state.txTreeNode];
   node->errorType = errorType;
-
-  node->errorLocation = "";
-  llvm::raw_string_ostream out(node->errorLocation);
-  if (llvm::MDNode *n = state.pc->inst->getMetadata("dbg")) {
-    // Display the line, char position of this instruction
-    llvm::DILocation loc(n);
-    unsigned line = loc.getLineNumber();
-    llvm::StringRef file = loc.getFilename();
-    out << file << ":" << line << "\n";
-  } else {
-    state.pc->inst->print(out);
-  }
+  node->errorLocation = getLocation(state);
 
   // Mark the path as leading to memory error
   while (node) {
@@ -414,6 +567,9 @@ void TxTreeGraph::setError(const ExecutionState &state,
 }
 
 void TxTreeGraph::save(std::string dotFileName) {
+  if (eventLog)
+    eventLog->out.flush();
+
   if (!OUTPUT_INTERPOLATION_TREE)
     return;
 
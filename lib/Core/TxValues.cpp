@@ -37,6 +37,10 @@ using namespace klee;
 
 namespace klee {
 
+TxSlabAllocator<TxStateValue> TxStateValue::allocator("TxStateValue");
+
+TxSlabAllocator<TxStoreEntry> TxStoreEntry::allocator("TxStoreEntry");
+
 bool concreteBound(uint64_t bound) { return bound < symbolicBoundId; }
 
 /**/
@@ -164,8 +168,39 @@ void TxAllocationInfo::print(llvm::raw_ostream &stream,
 
 /**/
 
-ref<TxAllocationContext> TxAllocationContext::create(
-    llvm::Value *_value, const std::vector<llvm::Instruction *> &_callHistory) {
+uint64_t TxCallHistory::internedCount = 0;
+
+const TxCallHistory *TxCallHistory::getEmpty() {
+  static TxCallHistory *root = new TxCallHistory(0, 0);
+  return root;
+}
+
+const TxCallHistory *TxCallHistory::push(llvm::Instruction *_site) const {
+  std::map<llvm::Instruction *, TxCallHistory *>::const_iterator it =
+      next.find(_site);
+  if (it != next.end())
+    return it->second;
+
+  TxCallHistory *ret = new TxCallHistory(this, _site);
+  next[_site] = ret;
+  return ret;
+}
+
+void TxCallHistory::getCallSites(
+    std::vector<llvm::Instruction *> &sites) const {
+  sites.resize(length);
+  const TxCallHistory *current = this;
+  for (unsigned i = length; i > 0; --i) {
+    sites[i - 1] = current->site;
+    current = current->parent;
+  }
+}
+
+/**/
+
+ref<TxAllocationContext>
+TxAllocationContext::create(llvm::Value *_value,
+                            const TxCallHistory *_callHistory) {
   ref<TxAllocationContext> ret(new TxAllocationContext(_value, _callHistory));
   return ret;
 }
@@ -184,11 +219,12 @@ void TxAllocationContext::print(llvm::raw_ostream &stream,
     }
     value->print(stream);
   }
-  if (callHistory.size() > 0) {
+  if (!callHistory->empty()) {
+    std::vector<llvm::Instruction *> sites;
+    callHistory->getCallSites(sites);
     stream << "\n" << prefix << "Call history:";
-    for (std::vector<llvm::Instruction *>::const_iterator
-             it = callHistory.begin(),
-             ie = callHistory.end();
+    for (std::vector<llvm::Instruction *>::const_iterator it = sites.begin(),
+                                                          ie = sites.end();
          it != ie; ++it) {
       stream << "\n" << tabs << prefix;
       (*it)->print(stream);
@@ -209,16 +245,14 @@ void TxVariable::print(llvm::raw_ostream &stream,
   if (debugSubsumptionLevel_g>=4){
   stream << "\n";
   stream << prefix << "stack:";
-  if (allocInfo->getContext()->getCallHistory().empty()) {
+  if (allocInfo->getContext()->getCallHistory()->empty()) {
     stream << " (empty)\n";
   } else {
     stream << "\n";
-    for (std::vector<llvm::Instruction *>::const_reverse_iterator
-             it = allocInfo->getContext()->getCallHistory().rbegin(),
-             ie = allocInfo->getContext()->getCallHistory().rend();
-         it != ie; ++it) {
+    for (const TxCallHistory *it = allocInfo->getContext()->getCallHistory();
+         !it->empty(); it = it->pop()) {
       stream << tabsNext;
-      (*it)->print(stream);
+      it->getCallSite()->print(stream);
       stream << "\n";
     }
   }
@@ -642,7 +676,7 @@ void TxInterpolantValue::print(llvm::raw_ostream &stream,
                                const std::string &prefix) const {
   std::string nextTabs = appendTab(prefix);
   bool offsetDisplayed = false;
-  if (debugSubsumptionLevel_g>=4){
+  if (debugSubsumptionLevel_g>=4 && value){
   stream << prefix << "function/value: ";
   if (outputFunctionName(value, stream))
       stream << "/";
@@ -7,8 +7,72 @@
 
 #include "Z3Simplification.h"
 
+#include "klee/CommandLine.h"
+
+#include <sstream>
+
 using namespace klee;
 
+z3::context *Z3Simplification::context = 0;
+
+std::vector<z3::tactic> Z3Simplification::tactics;
+
+std::map<std::string, ref<Expr> > Z3Simplification::emap;
+
+std::map<const Expr *, std::pair<ref<Expr>, z3::expr> >
+Z3Simplification::toZ3Cache;
+
+std::map<unsigned, std::pair<z3::expr, ref<Expr> > >
+Z3Simplification::fromZ3Cache;
+
+std::map<const Expr *, std::pair<ref<Expr>, ref<Expr> > >
+Z3Simplification::simplifiedCache;
+
+void Z3Simplification::initialize() {
+  context = new z3::context();
+
+  std::istringstream stream(WPSimplificationTactics);
+  std::string name;
+  while (std::getline(stream, name, ',')) {
+    if (name.empty())
+      continue;
+    try {
+      tactics.push_back(z3::tactic(*context, name.c_str()));
+    } catch (z3::exception &e) {
+      klee_error("unknown Z3 tactic \"%s\" in -wp-simplification-tactics: %s",
+                 name.c_str(), e.msg());
+    }
+  }
+}
+
+void Z3Simplification::clear() {
+  // The Z3 expressions are released before their context
+  simplifiedCache.clear();
+  fromZ3Cache.clear();
+  toZ3Cache.clear();
+  emap.clear();
+  tactics.clear();
+  delete context;
+  context = 0;
+}
+
+bool Z3Simplification::isSmall(ref<Expr> expr, unsigned bound) {
+  std::set<const Expr *> visited;
+  std::vector<const Expr *> worklist;
+  worklist.push_back(expr.get());
+  while (!worklist.empty()) {
+    const Expr *e = worklist.back();
+    worklist.pop_back();
+    if (!visited.insert(e).second)
+      continue;
+    if (visited.size() >= bound)
+      return false;
+    for (unsigned i = 0; i < e->getNumKids(); ++i)
+      worklist.push_back(e->getKid(i).get());
+  }
+  return true;
+}
+
 void Z3Simplification::test() {
   std::cout << "Start test!\n";
   z3::context c;
@@ -26,25 +90,64 @@ ref<Expr> Z3Simplification::simplify(ref<Expr> txe) {
   if (txe.isNull()) {
     return txe;
   }
-  z3::context c;
-  std::map<std::string, ref<Expr> > emap;
+  if (WPSimplificationThreshold && isSmall(txe, WPSimplificationThreshold))
+    return txe;
+
+  std::map<const Expr *, std::pair<ref<Expr>, ref<Expr> > >::iterator it =
+      simplifiedCache.find(txe.get());
+  if (it != simplifiedCache.end())
+    return it->second.second;
+
+  // Renew the context once it has accumulated too many expressions
+  if (context && toZ3Cache.size() + fromZ3Cache.size() +
+                         simplifiedCache.size() > maxCacheSize)
+    clear();
+  if (!context)
+    initialize();
+
+  z3::context &c = *context;
   z3::expr z3e = c.bool_val(false);
   bool succ = txExpr2z3Expr(z3e, c, txe, emap);
+  ref<Expr> ret = txe;
   if (succ) {
-    z3e = applyTactic(c, "simplify", z3e);
-    z3e = applyTactic(c, "ctx-solver-simplify", z3e);
-    ref<Expr> ret = z3Expr2TxExpr(z3e, emap);
-    return ret;
+    for (std::vector<z3::tactic>::iterator tit = tactics.begin(),
+                                           tie = tactics.end();
+         tit != tie; ++tit) {
+      z3e = applyTactic(c, *tit, z3e);
+    }
+    ret = z3Expr2TxExpr(z3e, emap);
   }
-  return txe;
+  simplifiedCache.insert(std::make_pair(txe.get(), std::make_pair(txe, ret)));
+  return ret;
 }
 
 bool Z3Simplification::txExpr2z3Expr(z3::expr &z3e, z3::context &c,
                                      ref<Expr> txe,
                                      std::map<std::string, ref<Expr> > &emap) {
+  std::map<const Expr *, std::pair<ref<Expr>, z3::expr> >::iterator it =
+      toZ3Cache.find(txe.get());
+  if (it != toZ3Cache.end()) {
+    z3e = it->second.second;
+    return true;
+  }
+
+  if (!translateTxExpr(z3e, c, txe, emap))
+    return false;
+  toZ3Cache.insert(std::make_pair(txe.get(), std::make_pair(txe, z3e)));
+  return true;
+}
+
+bool Z3Simplification::translateTxExpr(z3::expr &z3e, z3::context &c,
+                                       ref<Expr> txe,
+                                       std::map<std::string, ref<Expr> > &emap) {
   if (isaVar(txe)) {
     std::string name = extractVarName(txe);
     unsigned int size = txe->getWidth();
+    // The name is kept for the whole run, hence a different expression of the
+    // same name cannot be translated back
+    std::map<std::string, ref<Expr> >::iterator it = emap.find(name);
+    if (it != emap.end() && it->second != txe)
+      return false;
     emap.insert(std::pair<std::string, ref<Expr> >(name, txe));
     switch (size) {
     case Expr::Bool:
@@ -305,6 +408,20 @@ bool Z3Simplification::txExpr2z3Expr(z3::expr &z3e, z3::context &c,
 ref<Expr>
 Z3Simplification::z3Expr2TxExpr(z3::expr e,
                                 std::map<std::string, ref<Expr> > &emap) {
+  unsigned id = Z3_get_ast_id(e.ctx(), e);
+  std::map<unsigned, std::pair<z3::expr, ref<Expr> > >::iterator it =
+      fromZ3Cache.find(id);
+  if (it != fromZ3Cache.end())
+    return it->second.second;
+
+  ref<Expr> ret = translateZ3Expr(e, emap);
+  fromZ3Cache.insert(std::make_pair(id, std::make_pair(e, ret)));
+  return ret;
+}
+
+ref<Expr>
+Z3Simplification::translateZ3Expr(z3::expr e,
+                                  std::map<std::string, ref<Expr> > &emap) {
   if (e.is_const()) {
     std::string name = e.decl().name().str();
     if (name == "Int") {
@@ -440,11 +557,10 @@ Z3Simplification::z3Expr2TxExpr(z3::expr e,
   return ret;
 }
 
-z3::expr Z3Simplification::applyTactic(z3::context &c, std::string tactic,
+z3::expr Z3Simplification::applyTactic(z3::context &c, z3::tactic &t,
                                        z3::expr e) {
   z3::goal g(c);
   g.add(e);
-  z3::tactic t(c, tactic.c_str());
   z3::apply_result r = t(g);
   assert(r.size() > 0 && "apply result is empty!");
   z3::expr ret = r[0].as_expr();
@@ -12,7 +12,9 @@
 #include <cstdlib>
 #include <iostream>
 #include <klee/Expr.h>
+#include <map>
 #include <string>
+#include <vector>
 
 #include <z3++.h>
 
@@ -25,13 +27,51 @@ public:
   static ref<Expr> simplify(ref<Expr> expr);
   static void test();
 
+  /// \brief Release the context and the caches of the run
+  static void clear();
+
 private:
+  /// \brief The maximum number of cached translations, above which the
+  /// context is renewed
+  static const unsigned maxCacheSize = 100000;
+
+  /// \brief The context of all simplifications in the run, created on first
+  /// use together with the tactics of -wp-simplification-tactics
+  static z3::context *context;
+
+  static std::vector<z3::tactic> tactics;
+
+  /// \brief The variables by their names in the context
+  static std::map<std::string, ref<Expr> > emap;
+
+  /// \brief Translations to Z3, by the address of the kept expression
+  static std::map<const Expr *, std::pair<ref<Expr>, z3::expr> > toZ3Cache;
+
+  /// \brief Translations from Z3, by the id of the kept Z3 expression
+  static std::map<unsigned, std::pair<z3::expr, ref<Expr> > > fromZ3Cache;
+
+  /// \brief The results of simplify, by the address of the kept argument
+  static std::map<const Expr *, std::pair<ref<Expr>, ref<Expr> > >
+  simplifiedCache;
+
+  static void initialize();
+
+  /// \brief Tests if the expression has fewer distinct nodes than the bound
+  static bool isSmall(ref<Expr> expr, unsigned bound);
+
   static bool txExpr2z3Expr(z3::expr &z3e, z3::context &c, ref<Expr> txe,
                             std::map<std::string, ref<Expr> > &emap);
 
+  static bool translateTxExpr(z3::expr &z3e, z3::context &c, ref<Expr> txe,
+                              std::map<std::string, ref<Expr> > &emap);
+
   static ref<Expr> z3Expr2TxExpr(z3::expr,
                                  std::map<std::string, ref<Expr> > &emap);
-  static z3::expr applyTactic(z3::context &c, std::string tactic, z3::expr e);
+
+  static ref<Expr> translateZ3Expr(z3::expr,
+                                   std::map<std::string, ref<Expr> > &emap);
+
+  static z3::expr applyTactic(z3::context &c, z3::tactic &t, z3::expr e);
 
   static bool isaVar(ref<Expr> e);
   static std::string extractVarName(ref<Expr> e);
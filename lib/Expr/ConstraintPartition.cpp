@@ -0,0 +1,160 @@
+//===-- ConstraintPartition.cpp -------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/ConstraintPartition.h"
+
+#include "klee/util/ExprUtil.h"
+
+#include <algorithm>
+#include <set>
+
+using namespace klee;
+
+void ConstraintPartition::getAccesses(ref<Expr> e,
+                                      std::vector<Access> &accesses) {
+  std::vector<ref<ReadExpr> > reads;
+  findReads(e, /* visitUpdates= */ true, reads);
+  for (std::vector<ref<ReadExpr> >::iterator it = reads.begin(),
+                                             ie = reads.end();
+       it != ie; ++it) {
+    ReadExpr *re = it->get();
+
+    // Reads of a constant array don't alias.
+    if (re->updates.root->isConstantArray() && !re->updates.head)
+      continue;
+
+    if (ConstantExpr *CE = dyn_cast<ConstantExpr>(re->index)) {
+      accesses.push_back(Access(re->updates.root, false,
+                                (unsigned)CE->getZExtValue(32)));
+    } else {
+      accesses.push_back(Access(re->updates.root, true, 0));
+    }
+  }
+}
+
+unsigned ConstraintPartition::newElement() {
+  unsigned element = parent.size();
+  parent.push_back(element);
+  members.push_back(std::vector<unsigned>());
+  return element;
+}
+
+unsigned ConstraintPartition::find(unsigned element) const {
+  while (parent[element] != element) {
+    parent[element] = parent[parent[element]];
+    element = parent[element];
+  }
+  return element;
+}
+
+unsigned ConstraintPartition::unite(unsigned a, unsigned b) {
+  a = find(a);
+  b = find(b);
+  if (a == b)
+    return a;
+
+  // Move the smaller list of constraints
+  if (members[a].size() < members[b].size())
+    std::swap(a, b);
+  parent[b] = a;
+  members[a].insert(members[a].end(), members[b].begin(), members[b].end());
+  std::vector<unsigned>().swap(members[b]);
+  return a;
+}
+
+void ConstraintPartition::add(unsigned index, ref<Expr> constraint) {
+  std::vector<Access> accesses;
+  getAccesses(constraint, accesses);
+
+  bool found = false;
+  unsigned root = 0;
+  for (std::vector<Access>::iterator it = accesses.begin(),
+                                     ie = accesses.end();
+       it != ie; ++it) {
+    ArrayElements &elements = arrays[it->array];
+    unsigned element;
+    if (elements.wholeRead) {
+      element = elements.whole;
+    } else if (it->whole) {
+      // From now on, the bytes of the array are all in the same class
+      elements.wholeRead = true;
+      elements.whole = newElement();
+      for (std::map<unsigned, unsigned>::iterator bit = elements.bytes.begin(),
+                                                  bie = elements.bytes.end();
+           bit != bie; ++bit) {
+        unite(elements.whole, bit->second);
+      }
+      element = elements.whole;
+    } else {
+      std::map<unsigned, unsigned>::iterator bit =
+          elements.bytes.find(it->index);
+      if (bit == elements.bytes.end()) {
+        element = newElement();
+        elements.bytes[it->index] = element;
+      } else {
+        element = bit->second;
+      }
+    }
+
+    root = found ? unite(root, element) : find(element);
+    found = true;
+  }
+
+  if (found)
+    members[find(root)].push_back(index);
+}
+
+void ConstraintPartition::getDependentConstraints(
+    ref<Expr> e, std::vector<unsigned> &indices) const {
+  std::vector<Access> accesses;
+  getAccesses(e, accesses);
+
+  std::set<unsigned> roots;
+  for (std::vector<Access>::iterator it = accesses.begin(),
+                                     ie = accesses.end();
+       it != ie; ++it) {
+    std::map<const Array *, ArrayElements>::const_iterator ait =
+        arrays.find(it->array);
+    if (ait == arrays.end())
+      continue;
+
+    const ArrayElements &elements = ait->second;
+    if (elements.wholeRead) {
+      roots.insert(find(elements.whole));
+    } else if (it->whole) {
+      for (std::map<unsigned, unsigned>::const_iterator
+               bit = elements.bytes.begin(),
+               bie = elements.bytes.end();
+           bit != bie; ++bit) {
+        roots.insert(find(bit->second));
+      }
+    } else {
+      std::map<unsigned, unsigned>::const_iterator bit =
+          elements.bytes.find(it->index);
+      if (bit != elements.bytes.end())
+        roots.insert(find(bit->second));
+    }
+  }
+
+  for (std::set<unsigned>::iterator it = roots.begin(), ie = roots.end();
+       it != ie; ++it) {
+    indices.insert(indices.end(), members[*it].begin(), members[*it].end());
+  }
+  std::sort(indices.begin(), indices.end());
+}
+
+void ConstraintPartition::getFactors(
+    std::vector<std::vector<unsigned> > &factors) const {
+  for (unsigned element = 0, n = parent.size(); element < n; ++element) {
+    if (parent[element] != element || members[element].empty())
+      continue;
+    factors.push_back(members[element]);
+    std::sort(factors.back().begin(), factors.back().end());
+  }
+}
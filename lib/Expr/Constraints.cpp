@@ -87,6 +87,11 @@ bool ConstraintManager::rewriteConstraints(ExprVisitor &visitor) {
   ConstraintManager::constraints_ty old;
   bool changed = false;
 
+  // The constraints are renumbered, hence the partition is only kept when
+  // nothing is rewritten
+  ref<ConstraintPartition> oldPartition = partition;
+  partition = 0;
+
   constraints.swap(old);
   for (ConstraintManager::constraints_ty::iterator 
          it = old.begin(), ie = old.end(); it != ie; ++it) {
@@ -101,9 +106,29 @@ bool ConstraintManager::rewriteConstraints(ExprVisitor &visitor) {
     }
   }
 
+  if (!changed)
+    partition = oldPartition;
   return changed;
 }
 
+const ConstraintPartition &ConstraintManager::getPartition() const {
+  if (partition.isNull()) {
+    partition = new ConstraintPartition();
+    for (unsigned i = 0, n = constraints.size(); i < n; ++i)
+      partition->add(i, constraints[i]);
+  }
+  return *partition;
+}
+
+void ConstraintManager::pushConstraint(ref<Expr> e) {
+  constraints.push_back(e);
+  if (partition.isNull())
+    return;
+  if (partition->refCount > 1)
+    partition = new ConstraintPartition(*partition);
+  partition->add(constraints.size() - 1, e);
+}
+
 void ConstraintManager::simplifyForValidConstraint(ref<Expr> e) {
   // XXX 
 }
@@ -171,12 +196,12 @@ void ConstraintManager::addConstraintInternal(ref<Expr> e) {
 	rewriteConstraints(visitor);
       }
     }
-    constraints.push_back(e);
+    pushConstraint(e);
     break;
   }
     
   default:
-    constraints.push_back(e);
+    pushConstraint(e);
     break;
   }
 }
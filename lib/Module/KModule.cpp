@@ -13,6 +13,7 @@
 
 #include "Passes.h"
 
+#include "klee/CommandLine.h"
 #include "klee/Config/Version.h"
 #include "klee/Interpreter.h"
 #include "klee/Internal/Module/Cell.h"
@@ -375,6 +376,18 @@ void KModule::prepare(const Interpreter::ModuleOptions &opts,
   pm3.add(new IntrinsicCleanerPass(*targetData));
   pm3.add(new PhiCleanerPass());
   pm3.run(*module);
+
+  // Compute the dependency sets of the speculation mode, unless they are
+  // given as files
+  if (INTERPOLATION_ENABLED && SpecTypeToUse != NO_SPEC &&
+      !DependencyFolder.getNumOccurrences()) {
+    std::string cacheFile = SpecDependencyCache;
+    if (cacheFile.empty())
+      cacheFile = ih->getOutputFilename("spec.txdep");
+    PassManager pm4;
+    pm4.add(new SpecDependencyPass(specDependencies, cacheFile));
+    pm4.run(*module);
+  }
 #if LLVM_VERSION_CODE < LLVM_VERSION(3, 3)
   // For cleanliness see if we can discard any of the functions we
   // forced to import.
@@ -491,3 +491,58 @@ static bool valueIsOnlyCalled(const Value *v) {
 bool klee::functionEscapes(const Function *f) {
   return !valueIsOnlyCalled(f);
 }
+
+uint64_t klee::hashModule(Module *module) {
+  // FNV-1a over the textual IR of the module, such that any change of an
+  // instruction, operand, constant, type or global initializer changes the
+  // hash
+  std::string text;
+  llvm::raw_string_ostream stream(text);
+  module->print(stream, 0);
+  stream.flush();
+
+  // The module identifier is the path of the input file, which may differ
+  // between runs on the same module
+  std::string::size_type begin = 0;
+  if (text.compare(0, 11, "; ModuleID ") == 0) {
+    begin = text.find('\n');
+    begin = begin == std::string::npos ? text.size() : begin + 1;
+  }
+
+  uint64_t h = 0xcbf29ce484222325ULL;
+  const uint64_t prime = 0x100000001b3ULL;
+  for (std::string::const_iterator it = text.begin() + begin, ie = text.end();
+       it != ie; ++it) {
+    h = (h ^ static_cast<unsigned char>(*it)) * prime;
+  }
+  return h;
+}
+
+static void collectVariableNames(Value *v, std::set<Value *> &visited,
+                                 std::set<std::string> &names) {
+  if (!visited.insert(v).second)
+    return;
+
+  if (GlobalVariable *gv = dyn_cast<GlobalVariable>(v)) {
+    names.insert(gv->getName().str());
+  } else if (AllocaInst *ai = dyn_cast<AllocaInst>(v)) {
+    if (ai->getName() == "") {
+      Function *f = ai->getParent()->getParent();
+      if (ai == &f->getEntryBlock().front()) {
+        names.insert(f->arg_begin()->getName().str());
+      } else if (ai == f->getEntryBlock().front().getNextNode()) {
+        names.insert(f->arg_begin()->getNextNode()->getName().str());
+      }
+    } else {
+      names.insert(ai->getName().str());
+    }
+  } else if (Instruction *ins = dyn_cast<Instruction>(v)) {
+    for (unsigned i = 0; i < ins->getNumOperands(); ++i)
+      collectVariableNames(ins->getOperand(i), visited, names);
+  }
+}
+
+void klee::collectVariableNames(Value *v, std::set<std::string> &names) {
+  std::set<Value *> visited;
+  ::collectVariableNames(v, visited, names);
+}
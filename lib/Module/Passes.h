@@ -25,6 +25,10 @@
 #include "llvm/CodeGen/IntrinsicLowering.h"
 #include "llvm/Pass.h"
 
+#include <map>
+#include <set>
+#include <string>
+
 namespace llvm {
   class Function;
   class Instruction;
@@ -149,6 +153,42 @@ public:
   virtual bool runOnModule(llvm::Module &M);
 };
 
+/// SpecDependencyPass - Compute the variable dependency set of each target
+/// block of the speculation mode: the variables which the conditions of the
+/// branches controlling the execution of the block depend on, where the
+/// controlling branches are those the block is transitively
+/// control-dependent on. As with the SpecAvoid files of -spec-dependency, the
+/// targets are the blocks reporting an assertion failure.
+///
+/// The result is cached in the given file, and reused when the hash of the
+/// module matches.
+class SpecDependencyPass : public llvm::ModulePass {
+  static char ID;
+
+  static const uint32_t version = 2;
+
+  std::map<llvm::BasicBlock *, std::set<std::string> > &dependencies;
+
+  std::string cacheFile;
+
+  static bool isTarget(llvm::BasicBlock &bb);
+
+  void runOnFunction(llvm::Function &f);
+
+  bool loadCache(const std::string &fileName, llvm::Module &M, uint64_t hash);
+
+  void saveCache(const std::string &fileName, llvm::Module &M, uint64_t hash);
+
+public:
+  SpecDependencyPass(
+      std::map<llvm::BasicBlock *, std::set<std::string> > &_dependencies,
+      const std::string &_cacheFile)
+      : llvm::ModulePass(ID), dependencies(_dependencies),
+        cacheFile(_cacheFile) {}
+
+  virtual bool runOnModule(llvm::Module &M);
+};
+
 /// LowerSwitchPass - Replace all SwitchInst instructions with chained branch
 /// instructions.  Note that this cannot be a BasicBlock pass because it
 /// modifies the CFG!
@@ -0,0 +1,285 @@
+//===-- SpecDependency.cpp - Speculation dependency analysis ----*- C++ -*-===//
+//
+//               The Tracer-X KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file contains the implementation of the pass computing the variable
+/// dependency sets of the target blocks of the speculation mode, which used
+/// to be read from files generated before the run.
+///
+//===----------------------------------------------------------------------===//
+
+#include "Passes.h"
+
+#include "klee/Config/Version.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+#include "klee/Internal/Support/ModuleUtil.h"
+
+#if LLVM_VERSION_CODE >= LLVM_VERSION(3, 5)
+#include "llvm/IR/Dominators.h"
+#else
+#include "llvm/Analysis/Dominators.h"
+#endif
+#if LLVM_VERSION_CODE >= LLVM_VERSION(3, 3)
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#else
+#include "llvm/BasicBlock.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#endif
+
+#include <fstream>
+#include <vector>
+
+using namespace llvm;
+using namespace klee;
+
+char SpecDependencyPass::ID;
+
+namespace {
+const char cacheMagic[4] = { 'T', 'X', 'D', 'P' };
+
+void writeWord(std::ostream &out, uint32_t word) {
+  out.write(reinterpret_cast<const char *>(&word), sizeof(word));
+}
+
+bool readWord(std::istream &in, uint32_t &word) {
+  in.read(reinterpret_cast<char *>(&word), sizeof(word));
+  return in.good();
+}
+
+void writeString(std::ostream &out, const std::string &str) {
+  writeWord(out, str.size());
+  out.write(str.data(), str.size());
+}
+
+bool readString(std::istream &in, std::string &str) {
+  uint32_t size;
+  if (!readWord(in, size))
+    return false;
+  str.resize(size);
+  if (size)
+    in.read(&str[0], size);
+  return in.good();
+}
+}
+
+bool SpecDependencyPass::runOnModule(Module &M) {
+  dependencies.clear();
+
+  uint64_t hash = hashModule(&M);
+  if (loadCache(cacheFile, M, hash))
+    return false;
+
+  dependencies.clear();
+
+  for (Module::iterator f = M.begin(), fe = M.end(); f != fe; ++f) {
+    if (!f->isDeclaration())
+      runOnFunction(*f);
+  }
+  saveCache(cacheFile, M, hash);
+  return false;
+}
+
+bool SpecDependencyPass::isTarget(BasicBlock &bb) {
+  for (BasicBlock::iterator it = bb.begin(), ie = bb.end(); it != ie; ++it) {
+    CallInst *ci = dyn_cast<CallInst>(&*it);
+    if (!ci)
+      continue;
+    Value *callee = ci->getCalledValue()->stripPointerCasts();
+    if (isa<Function>(callee) && callee->getName() == "__assert_fail")
+      return true;
+  }
+  return false;
+}
+
+void SpecDependencyPass::runOnFunction(Function &f) {
+  DominatorTreeBase<BasicBlock> postDominators(/*isPostDom=*/true);
+  postDominators.recalculate(f);
+
+  // The branching blocks each block is directly control-dependent on: the
+  // block is on a path from a successor of the branching block to the
+  // immediate post-dominator of the branching block.
+  std::map<BasicBlock *, std::set<BasicBlock *> > controllers;
+  for (Function::iterator bb = f.begin(), bbe = f.end(); bb != bbe; ++bb) {
+    TerminatorInst *terminator = bb->getTerminator();
+    if (terminator->getNumSuccessors() < 2)
+      continue;
+
+    DomTreeNode *node = postDominators.getNode(&*bb);
+    DomTreeNode *stop = node ? node->getIDom() : 0;
+    for (unsigned i = 0; i < terminator->getNumSuccessors(); ++i) {
+      for (DomTreeNode *n = postDominators.getNode(terminator->getSuccessor(i));
+           n && n != stop; n = n->getIDom()) {
+        if (n->getBlock())
+          controllers[n->getBlock()].insert(&*bb);
+      }
+    }
+  }
+
+  // Only the target blocks have a dependency set, otherwise every branch
+  // condition would be avoided, as every branch controls its successors
+  std::map<BasicBlock *, std::set<std::string> > conditionVariables;
+  for (std::map<BasicBlock *, std::set<BasicBlock *> >::iterator
+           it = controllers.begin(),
+           ie = controllers.end();
+       it != ie; ++it) {
+    if (!isTarget(*it->first))
+      continue;
+
+    // Follow the control dependences transitively
+    std::set<BasicBlock *> visited;
+    std::vector<BasicBlock *> worklist(it->second.begin(), it->second.end());
+    std::set<std::string> &variables = dependencies[it->first];
+    while (!worklist.empty()) {
+      BasicBlock *controller = worklist.back();
+      worklist.pop_back();
+      if (!visited.insert(controller).second)
+        continue;
+
+      std::map<BasicBlock *, std::set<std::string> >::iterator cit =
+          conditionVariables.find(controller);
+      if (cit == conditionVariables.end()) {
+        cit = conditionVariables.insert(std::make_pair(
+                                            controller,
+                                            std::set<std::string>())).first;
+        collectVariableNames(controller->getTerminator(), cit->second);
+      }
+      variables.insert(cit->second.begin(), cit->second.end());
+
+      std::map<BasicBlock *, std::set<BasicBlock *> >::iterator next =
+          controllers.find(controller);
+      if (next != controllers.end())
+        worklist.insert(worklist.end(), next->second.begin(),
+                        next->second.end());
+    }
+    if (variables.empty())
+      dependencies.erase(it->first);
+  }
+}
+
+// The cache consists of a header with the module hash, the table of the
+// strings used, and the dependency set of each block, where a block is
+// identified by the name of its function and its index in the function.
+bool SpecDependencyPass::loadCache(const std::string &fileName, Module &M,
+                                   uint64_t hash) {
+  std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
+  if (!in.good())
+    return false;
+
+  char magic[sizeof(cacheMagic)];
+  uint32_t fileVersion;
+  uint64_t fileHash;
+  in.read(magic, sizeof(magic));
+  in.read(reinterpret_cast<char *>(&fileHash), sizeof(fileHash));
+  if (!in.good() || !std::equal(magic, magic + sizeof(magic), cacheMagic) ||
+      !readWord(in, fileVersion) || fileVersion != version || fileHash != hash)
+    return false;
+
+  uint32_t stringCount;
+  if (!readWord(in, stringCount))
+    return false;
+  std::vector<std::string> strings(stringCount);
+  for (uint32_t i = 0; i < stringCount; ++i) {
+    if (!readString(in, strings[i]))
+      return false;
+  }
+
+  uint32_t blockCount;
+  if (!readWord(in, blockCount))
+    return false;
+  for (uint32_t i = 0; i < blockCount; ++i) {
+    uint32_t functionId, blockIndex, variableCount;
+    if (!readWord(in, functionId) || functionId >= stringCount ||
+        !readWord(in, blockIndex) || !readWord(in, variableCount))
+      return false;
+
+    Function *f = M.getFunction(strings[functionId]);
+    if (!f || blockIndex >= f->size())
+      return false;
+    Function::iterator bb = f->begin();
+    std::advance(bb, blockIndex);
+
+    std::set<std::string> &variables = dependencies[&*bb];
+    for (uint32_t j = 0; j < variableCount; ++j) {
+      uint32_t variableId;
+      if (!readWord(in, variableId) || variableId >= stringCount)
+        return false;
+      variables.insert(strings[variableId]);
+    }
+  }
+  return true;
+}
+
+void SpecDependencyPass::saveCache(const std::string &fileName, Module &M,
+                                   uint64_t hash) {
+  std::map<std::string, uint32_t> stringIds;
+  std::vector<const std::string *> strings;
+  std::map<BasicBlock *, uint32_t> blockIndices;
+  for (Module::iterator f = M.begin(), fe = M.end(); f != fe; ++f) {
+    uint32_t index = 0;
+    for (Function::iterator bb = f->begin(), bbe = f->end(); bb != bbe;
+         ++bb, ++index) {
+      if (dependencies.find(&*bb) != dependencies.end())
+        blockIndices[&*bb] = index;
+    }
+  }
+
+  // Intern the function and variable names
+  for (std::map<BasicBlock *, std::set<std::string> >::iterator
+           it = dependencies.begin(),
+           ie = dependencies.end();
+       it != ie; ++it) {
+    std::set<std::string> names(it->second);
+    names.insert(it->first->getParent()->getName().str());
+    for (std::set<std::string>::iterator nit = names.begin(),
+                                         nie = names.end();
+         nit != nie; ++nit) {
+      std::pair<std::map<std::string, uint32_t>::iterator, bool> inserted =
+          stringIds.insert(std::make_pair(*nit, strings.size()));
+      if (inserted.second)
+        strings.push_back(&inserted.first->first);
+    }
+  }
+
+  std::ofstream out(fileName.c_str(),
+                    std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out.good()) {
+    klee_warning("unable to write speculation dependency cache %s",
+                 fileName.c_str());
+    return;
+  }
+
+  out.write(cacheMagic, sizeof(cacheMagic));
+  out.write(reinterpret_cast<const char *>(&hash), sizeof(hash));
+  writeWord(out, version);
+
+  writeWord(out, strings.size());
+  for (std::vector<const std::string *>::iterator it = strings.begin(),
+                                                  ie = strings.end();
+       it != ie; ++it) {
+    writeString(out, **it);
+  }
+
+  writeWord(out, dependencies.size());
+  for (std::map<BasicBlock *, std::set<std::string> >::iterator
+           it = dependencies.begin(),
+           ie = dependencies.end();
+       it != ie; ++it) {
+    writeWord(out, stringIds[it->first->getParent()->getName().str()]);
+    writeWord(out, blockIndices[it->first]);
+    writeWord(out, it->second.size());
+    for (std::set<std::string>::iterator vit = it->second.begin(),
+                                         vie = it->second.end();
+         vit != vie; ++vit) {
+      writeWord(out, stringIds[*vit]);
+    }
+  }
+}
@@ -19,6 +19,7 @@
 #include "klee/util/Assignment.h"
 
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <map>
 #include <vector>
 #include <ostream>
@@ -27,55 +28,61 @@
 using namespace klee;
 using namespace llvm;
 
+// A set of small unsigned integers, e.g., the indices of array elements,
+// represented as a bitmap.
 template<class T>
 class DenseSet {
-  typedef std::set<T> set_ty;
-  set_ty s;
+  std::vector<uint64_t> words;
 
 public:
   DenseSet() {}
 
   void add(T x) {
-    s.insert(x);
+    if (x / 64 >= words.size())
+      words.resize(x / 64 + 1, 0);
+    words[x / 64] |= (uint64_t)1 << (x % 64);
   }
   void add(T start, T end) {
     for (; start<end; start++)
-      s.insert(start);
+      add(start);
   }
 
   // returns true iff set is changed by addition
   bool add(const DenseSet &b) {
+    if (b.words.size() > words.size())
+      words.resize(b.words.size(), 0);
     bool modified = false;
-    for (typename set_ty::const_iterator it = b.s.begin(), ie = b.s.end(); 
-         it != ie; ++it) {
-      if (modified || !s.count(*it)) {
+    for (unsigned i = 0, n = b.words.size(); i < n; ++i) {
+      if (b.words[i] & ~words[i]) {
         modified = true;
-        s.insert(*it);
+        words[i] |= b.words[i];
       }
     }
     return modified;
   }
 
   bool intersects(const DenseSet &b) {
-    for (typename set_ty::iterator it = s.begin(), ie = s.end(); 
-         it != ie; ++it)
-      if (b.s.count(*it))
+    for (unsigned i = 0, n = std::min(words.size(), b.words.size()); i < n; ++i)
+      if (words[i] & b.words[i])
         return true;
     return false;
   }
 
-  std::set<unsigned>::iterator begin(){
-    return s.begin();
-  }
-
-  std::set<unsigned>::iterator end(){
-    return s.end();
+  // the elements of the set, in ascending order
+  void getElements(std::vector<T> &elements) const {
+    for (unsigned i = 0, n = words.size(); i < n; ++i) {
+      for (uint64_t w = words[i]; w; w &= w - 1)
+        elements.push_back(i * 64 + __builtin_ctzll(w));
+    }
   }
 
   void print(llvm::raw_ostream &os) const {
+    std::vector<T> elements;
+    getElements(elements);
     bool first = true;
     os << "{";
-    for (typename set_ty::iterator it = s.begin(), ie = s.end(); 
+    for (typename std::vector<T>::iterator it = elements.begin(),
+                                           ie = elements.end();
          it != ie; ++it) {
       if (first) {
         first = false;
@@ -257,12 +264,28 @@ inline llvm::raw_ostream &operator<<(llvm::raw_ostream &os,
 }
 
 // Breaks down a constraint into all of it's individual pieces, returning a
-// list of IndependentElementSets or the independent factors.
+// list of IndependentElementSets or the independent factors. The factors of
+// the constraints are looked up in the partition maintained by the constraint
+// manager, and only the factors of the query expression are merged.
 //
 // Caller takes ownership of returned std::list.
 static std::list<IndependentElementSet>*
 getAllIndependentConstraintsSets(const Query &query) {
   std::list<IndependentElementSet> *factors = new std::list<IndependentElementSet>();
+
+  std::vector<std::vector<unsigned> > partition;
+  query.constraints.getPartition().getFactors(partition);
+
+  // The constraints that read no array are each a factor of their own
+  std::vector<bool> inFactor(query.constraints.size(), false);
+  for (std::vector<std::vector<unsigned> >::iterator it = partition.begin(),
+                                                     ie = partition.end();
+       it != ie; ++it) {
+    for (std::vector<unsigned>::iterator it1 = it->begin(), ie1 = it->end();
+         it1 != ie1; ++it1)
+      inFactor[*it1] = true;
+  }
+
   ConstantExpr *CE = dyn_cast<ConstantExpr>(query.expr);
   if (CE) {
     assert(CE && CE->isFalse() && "the expr should always be false and "
@@ -272,85 +295,46 @@ getAllIndependentConstraintsSets(const Query &query) {
     factors->push_back(IndependentElementSet(neg));
   }
 
-  for (ConstraintManager::const_iterator it = query.constraints.begin(),
-                                         ie = query.constraints.end();
+  for (std::vector<std::vector<unsigned> >::iterator it = partition.begin(),
+                                                     ie = partition.end();
        it != ie; ++it) {
-    // iterate through all the previously separated constraints.  Until we
-    // actually return, factors is treated as a queue of expressions to be
-    // evaluated.  If the queue property isn't maintained, then the exprs
-    // could be returned in an order different from how they came it, negatively
-    // affecting later stages.
-    factors->push_back(IndependentElementSet(*it));
+    IndependentElementSet factor(query.constraints.begin()[it->front()]);
+    for (std::vector<unsigned>::iterator it1 = it->begin() + 1,
+                                         ie1 = it->end();
+         it1 != ie1; ++it1)
+      factor.add(IndependentElementSet(query.constraints.begin()[*it1]));
+
+    // Merge into the factor of the query expression if dependent
+    if (!CE && factors->front().intersects(factor))
+      factors->front().add(factor);
+    else
+      factors->push_back(factor);
   }
 
-  bool doneLoop = false;
-  do {
-    doneLoop = true;
-    std::list<IndependentElementSet> *done =
-        new std::list<IndependentElementSet>;
-    while (factors->size() > 0) {
-      IndependentElementSet current = factors->front();
-      factors->pop_front();
-      // This list represents the set of factors that are separate from current.
-      // Those that are not inserted into this list (queue) intersect with
-      // current.
-      std::list<IndependentElementSet> *keep =
-          new std::list<IndependentElementSet>;
-      while (factors->size() > 0) {
-        IndependentElementSet compare = factors->front();
-        factors->pop_front();
-        if (current.intersects(compare)) {
-          if (current.add(compare)) {
-            // Means that we have added (z=y)added to (x=y)
-            // Now need to see if there are any (z=?)'s
-            doneLoop = false;
-          }
-        } else {
-          keep->push_back(compare);
-        }
-      }
-      done->push_back(current);
-      delete factors;
-      factors = keep;
-    }
-    delete factors;
-    factors = done;
-  } while (!doneLoop);
+  for (unsigned i = 0, n = inFactor.size(); i < n; ++i) {
+    if (!inFactor[i])
+      factors->push_back(
+          IndependentElementSet(query.constraints.begin()[i]));
+  }
 
   return factors;
 }
 
-static 
-IndependentElementSet getIndependentConstraints(const Query& query,
-                                                std::vector< ref<Expr> > &result) {
-  IndependentElementSet eltsClosure(query.expr);
-  std::vector< std::pair<ref<Expr>, IndependentElementSet> > worklist;
-
-  for (ConstraintManager::const_iterator it = query.constraints.begin(), 
-         ie = query.constraints.end(); it != ie; ++it)
-    worklist.push_back(std::make_pair(*it, IndependentElementSet(*it)));
-
-  // XXX This should be more efficient (in terms of low level copy stuff).
-  bool done = false;
-  do {
-    done = true;
-    std::vector< std::pair<ref<Expr>, IndependentElementSet> > newWorklist;
-    for (std::vector< std::pair<ref<Expr>, IndependentElementSet> >::iterator
-           it = worklist.begin(), ie = worklist.end(); it != ie; ++it) {
-      if (it->second.intersects(eltsClosure)) {
-        if (eltsClosure.add(it->second))
-          done = false;
-        result.push_back(it->first);
-        // Means that we have added (z=y)added to (x=y)
-        // Now need to see if there are any (z=?)'s
-      } else {
-        newWorklist.push_back(*it);
-      }
-    }
-    worklist.swap(newWorklist);
-  } while (!done);
+static
+void getIndependentConstraints(const Query& query,
+                               std::vector< ref<Expr> > &result) {
+  std::vector<unsigned> indices;
+  query.constraints.getPartition().getDependentConstraints(query.expr,
+                                                           indices);
+  for (std::vector<unsigned>::iterator it = indices.begin(),
+                                       ie = indices.end();
+       it != ie; ++it)
+    result.push_back(query.constraints.begin()[*it]);
 
   KLEE_DEBUG(
+    IndependentElementSet eltsClosure(query.expr);
+    for (unsigned i = 0; i < result.size(); ++i)
+      eltsClosure.add(IndependentElementSet(result[i]));
     std::set< ref<Expr> > reqset(result.begin(), result.end());
     errs() << "--\n";
     errs() << "Q: " << query.expr << "\n";
@@ -364,9 +348,6 @@ IndependentElementSet getIndependentConstraints(const Query& query,
     }
     errs() << "elts closure: " << eltsClosure << "\n";
  );
-
-
-  return eltsClosure;
 }
 
 
@@ -419,8 +400,7 @@ bool IndependentSolver::computeValidity(const Query &query,
                                         Solver::Validity &result,
                                         std::vector<ref<Expr> > &unsatCore) {
   std::vector< ref<Expr> > required;
-  IndependentElementSet eltsClosure =
-    getIndependentConstraints(query, required);
+  getIndependentConstraints(query, required);
   ConstraintManager tmp(required);
   return solver->impl->computeValidity(Query(tmp, query.expr), result,
                                        unsatCore);
@@ -429,16 +409,14 @@ bool IndependentSolver::computeValidity(const Query &query,
 bool IndependentSolver::computeTruth(const Query &query, bool &isValid,
                                      std::vector<ref<Expr> > &unsatCore) {
   std::vector< ref<Expr> > required;
-  IndependentElementSet eltsClosure = 
-    getIndependentConstraints(query, required);
+  getIndependentConstraints(query, required);
   ConstraintManager tmp(required);
   return solver->impl->computeTruth(Query(tmp, query.expr), isValid, unsatCore);
 }
 
 bool IndependentSolver::computeValue(const Query& query, ref<Expr> &result) {
   std::vector< ref<Expr> > required;
-  IndependentElementSet eltsClosure = 
-    getIndependentConstraints(query, required);
+  getIndependentConstraints(query, required);
   ConstraintManager tmp(required);
   return solver->impl->computeValue(Query(tmp, query.expr), result);
 }
@@ -526,8 +504,10 @@ bool IndependentSolver::computeInitialValues(
           std::vector<unsigned char> * tempPtr = &retMap[arraysInFactor[i]];
           assert(tempPtr->size() == tempValues[i].size() &&
                  "we're talking about the same array here");
-          ::DenseSet<unsigned> * ds = &(it->elements[arraysInFactor[i]]);
-          for (std::set<unsigned>::iterator it2 = ds->begin(); it2 != ds->end(); it2++){
+          std::vector<unsigned> indices;
+          it->elements[arraysInFactor[i]].getElements(indices);
+          for (std::vector<unsigned>::iterator it2 = indices.begin();
+               it2 != indices.end(); it2++){
             unsigned index = * it2;
             (* tempPtr)[index] = tempValues[i][index];
           }
@@ -15,9 +15,14 @@
 #include "klee/SolverImpl.h"
 #include "klee/util/Assignment.h"
 #include "klee/util/ExprUtil.h"
+#include "klee/Internal/System/Time.h"
 
 #include "llvm/Support/ErrorHandling.h"
 
+#include <pthread.h>
+#include <set>
+#include <sstream>
+
 namespace klee {
 
 class Z3SolverImpl : public SolverImpl {
@@ -29,6 +34,21 @@ private:
   // Parameter symbols
   ::Z3_symbol timeoutParamStrSymbol;
 
+  // Solver of the incremental session, or NULL when there is no session
+  ::Z3_solver sessionSolver;
+  // The constraints asserted in the incremental session, in the order of
+  // their tracking identifiers
+  ConstraintManager sessionConstraints;
+
+  /// assertTrackedConstraints - Assert the constraints into the solver, each
+  /// tracked by a Boolean constant named by its position for unsat core
+  /// extraction.
+  void assertTrackedConstraints(::Z3_solver theSolver,
+                                const ConstraintManager &constraints);
+
+  /// mkSolver - Create a solver suitable for the given query expression.
+  ::Z3_solver mkSolver(ref<Expr> queryExpr);
+
   bool internalRunSolver(const Query &,
                          const std::vector<const Array *> *objects,
                          std::vector<std::vector<unsigned char> > *values,
@@ -70,11 +90,17 @@ public:
                        std::vector<std::vector<unsigned char> > *values,
                        bool &hasSolution);
   SolverRunStatus getOperationStatusCode();
+
+  void startSession(const ConstraintManager &constraints);
+  bool computeTruthInSession(ref<Expr> expr, bool &isValid,
+                             std::vector<ref<Expr> > &unsatCore);
+  void endSession();
+  bool inSession() const { return sessionSolver != NULL; }
 };
 
 Z3SolverImpl::Z3SolverImpl()
     : builder(new Z3Builder(/*autoClearConstructCache=*/false)), timeout(0.0),
-      runStatusCode(SOLVER_RUN_STATUS_FAILURE) {
+      runStatusCode(SOLVER_RUN_STATUS_FAILURE), sessionSolver(NULL) {
   assert(builder && "unable to create Z3Builder");
   solverParameters = Z3_mk_params(builder->ctx);
   Z3_params_inc_ref(builder->ctx, solverParameters);
@@ -83,6 +109,7 @@ Z3SolverImpl::Z3SolverImpl()
 }
 
 Z3SolverImpl::~Z3SolverImpl() {
+  endSession();
   Z3_params_dec_ref(builder->ctx, solverParameters);
   delete builder;
 }
@@ -107,6 +134,22 @@ bool Z3Solver::directComputeValidity(const Query &query,
   return impl->computeValidity(query, result, unsatCore);
 }
 
+void Z3Solver::startSession(const ConstraintManager &constraints) {
+  static_cast<Z3SolverImpl *>(impl)->startSession(constraints);
+}
+
+bool Z3Solver::sessionComputeTruth(ref<Expr> expr, bool &isValid,
+                                   std::vector<ref<Expr> > &unsatCore) {
+  return static_cast<Z3SolverImpl *>(impl)
+      ->computeTruthInSession(expr, isValid, unsatCore);
+}
+
+void Z3Solver::endSession() { static_cast<Z3SolverImpl *>(impl)->endSession(); }
+
+bool Z3Solver::inSession() const {
+  return static_cast<Z3SolverImpl *>(impl)->inSession();
+}
+
 /***/
 
 char *Z3SolverImpl::getConstraintLog(const Query &query) {
@@ -204,41 +247,17 @@ bool Z3SolverImpl::internalRunSolver(
   }
   TimerStatIncrementer t(stats::queryTime);
   // TODO: Does making a new solver for each query have a performance
-  // impact vs making one global solver and using push and pop?
+  // impact vs making one global solver and using push and pop? For
+  // subsumption checks this is done by the incremental session.
   // TODO: is the "simple_solver" the right solver to use for
   // best performance?
-  Z3_solver theSolver = Z3_mk_simple_solver(builder->ctx);
-  if (INTERPOLATION_ENABLED) {
-    if (llvm::isa<ExistsExpr>(query.expr) ||
-        (llvm::isa<EqExpr>(query.expr) &&
-         llvm::isa<ExistsExpr>(query.expr->getKid(1)))) {
-      Z3_symbol abv = Z3_mk_string_symbol(builder->ctx, "ABV");
-      theSolver = Z3_mk_solver_for_logic(builder->ctx, abv);
-    }
-  }
+  Z3_solver theSolver = mkSolver(query.expr);
   Z3_solver_inc_ref(builder->ctx, theSolver);
   Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
 
   runStatusCode = SOLVER_RUN_STATUS_FAILURE;
 
-  Z3_sort sort = Z3_mk_bool_sort(builder->ctx);
-  unsigned constraintIdCtr = 1;
-  for (ConstraintManager::const_iterator it = query.constraints.begin(),
-                                         ie = query.constraints.end();
-       it != ie; ++it) {
-    std::ostringstream stringStream;
-    stringStream << constraintIdCtr;
-
-    Z3_symbol symbol =
-        Z3_mk_string_symbol(builder->ctx, stringStream.str().c_str());
-    Z3ASTHandle constraintId(Z3_mk_const(builder->ctx, symbol, sort),
-                             builder->ctx);
-
-    Z3_solver_assert_and_track(builder->ctx, theSolver, builder->construct(*it),
-                               constraintId);
-
-    constraintIdCtr++;
-  }
+  assertTrackedConstraints(theSolver, query.constraints);
   ++stats::queries;
   if (objects)
     ++stats::queryCounterexamples;
@@ -283,6 +302,120 @@ bool Z3SolverImpl::internalRunSolver(
   return false; // failed
 }
 
+::Z3_solver Z3SolverImpl::mkSolver(ref<Expr> queryExpr) {
+  if (INTERPOLATION_ENABLED) {
+    if (llvm::isa<ExistsExpr>(queryExpr) ||
+        (llvm::isa<EqExpr>(queryExpr) &&
+         llvm::isa<ExistsExpr>(queryExpr->getKid(1)))) {
+      Z3_symbol abv = Z3_mk_string_symbol(builder->ctx, "ABV");
+      return Z3_mk_solver_for_logic(builder->ctx, abv);
+    }
+  }
+  return Z3_mk_simple_solver(builder->ctx);
+}
+
+void Z3SolverImpl::assertTrackedConstraints(
+    ::Z3_solver theSolver, const ConstraintManager &constraints) {
+  Z3_sort sort = Z3_mk_bool_sort(builder->ctx);
+  unsigned constraintIdCtr = 1;
+  for (ConstraintManager::const_iterator it = constraints.begin(),
+                                         ie = constraints.end();
+       it != ie; ++it) {
+    std::ostringstream stringStream;
+    stringStream << constraintIdCtr;
+
+    Z3_symbol symbol =
+        Z3_mk_string_symbol(builder->ctx, stringStream.str().c_str());
+    Z3ASTHandle constraintId(Z3_mk_const(builder->ctx, symbol, sort),
+                             builder->ctx);
+
+    Z3_solver_assert_and_track(builder->ctx, theSolver, builder->construct(*it),
+                               constraintId);
+
+    constraintIdCtr++;
+  }
+}
+
+void Z3SolverImpl::startSession(const ConstraintManager &constraints) {
+  endSession();
+
+  // The session is used for quantified queries, hence we use the solver for
+  // the quantified bit-vector and array logic.
+  Z3_symbol abv = Z3_mk_string_symbol(builder->ctx, "ABV");
+  sessionSolver = Z3_mk_solver_for_logic(builder->ctx, abv);
+  Z3_solver_inc_ref(builder->ctx, sessionSolver);
+  sessionConstraints = constraints;
+  assertTrackedConstraints(sessionSolver, sessionConstraints);
+}
+
+bool Z3SolverImpl::computeTruthInSession(ref<Expr> expr, bool &isValid,
+                                         std::vector<ref<Expr> > &unsatCore) {
+  assert(sessionSolver && "no incremental session started");
+
+  if (Z3Solver::subsumptionCheck) {
+    TimerStatIncrementer t(stats::subsumptionQueryTime);
+    ++stats::subsumptionQueryCount;
+    Z3Solver::subsumptionCheck = false;
+    bool result = computeTruthInSession(expr, isValid, unsatCore);
+    if (!result || !isValid) {
+      ++stats::subsumptionQueryFailureCount;
+    }
+    Z3Solver::subsumptionCheck = true;
+    return result;
+  }
+  TimerStatIncrementer t(stats::queryTime);
+
+  // The timeout may have changed since the session was started
+  Z3_solver_set_params(builder->ctx, sessionSolver, solverParameters);
+
+  runStatusCode = SOLVER_RUN_STATUS_FAILURE;
+  ++stats::queries;
+
+  // Only the negated query lives in the scope, the constraints asserted at
+  // the start of the session are kept for the next query.
+  Z3_solver_push(builder->ctx, sessionSolver);
+  Z3_solver_assert(
+      builder->ctx, sessionSolver,
+      Z3ASTHandle(Z3_mk_not(builder->ctx, builder->construct(expr)),
+                  builder->ctx));
+
+  bool hasSolution = false;
+  ::Z3_lbool satisfiable = Z3_solver_check(builder->ctx, sessionSolver);
+  runStatusCode = handleSolverResponse(sessionSolver, satisfiable,
+                                       /*objects=*/NULL, /*values=*/NULL,
+                                       hasSolution);
+
+  if (runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE) {
+    getUnsatCoreVector(Query(sessionConstraints, expr), builder, sessionSolver,
+                       unsatCore);
+  }
+  Z3_solver_pop(builder->ctx, sessionSolver, 1);
+
+  if (runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE ||
+      runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE) {
+    if (hasSolution) {
+      ++stats::queriesInvalid;
+    } else {
+      ++stats::queriesValid;
+    }
+    isValid = !hasSolution;
+    return true; // success
+  }
+  return false; // failed
+}
+
+void Z3SolverImpl::endSession() {
+  if (!sessionSolver)
+    return;
+
+  Z3_solver_dec_ref(builder->ctx, sessionSolver);
+  sessionSolver = NULL;
+  sessionConstraints = ConstraintManager();
+  // The construct cache is kept during the session such that the
+  // expressions shared between the queries are constructed only once.
+  builder->clearConstructCache();
+}
+
 SolverImpl::SolverRunStatus Z3SolverImpl::handleSolverResponse(
     ::Z3_solver theSolver, ::Z3_lbool satisfiable,
     const std::vector<const Array *> *objects,
@@ -386,5 +519,344 @@ void Z3SolverImpl::getUnsatCoreVector(const Query &query,
   }
 }
 
+
+class Z3ParallelSolverImpl {
+  struct Worker {
+    Z3ParallelSolverImpl *owner;
+    pthread_t thread;
+    ::Z3_context ctx;
+    // The job in the solver, or -1, protected by the lock. The context is
+    // only interrupted while it has a job, and only created or deleted while
+    // it has none, hence it is never interrupted after it is deleted.
+    int job;
+    // Whether the context was interrupted, protected by the lock. An
+    // interrupt may stay pending in the context, such as when it arrives
+    // before the solver starts, and would cancel the next job, hence an
+    // interrupted context is not reused.
+    bool interrupted;
+  };
+
+  // The builder for translating the queries into scripts, used only by the
+  // thread calling findValid()
+  Z3Builder *builder;
+
+  std::vector<Worker> workers;
+
+  pthread_mutex_t lock;
+  // Signalled when a batch is started or the pool is shut down
+  pthread_cond_t batchStarted;
+  // Signalled when a worker finishes a job
+  pthread_cond_t jobFinished;
+
+  // The current batch, protected by the lock
+  std::vector<std::string> scripts;
+  std::vector<double> jobTimes;
+  // Whether each query was found invalid
+  std::vector<bool> invalidJobs;
+  // The unsat core of each query found valid, as constraint indices
+  std::vector<std::vector<unsigned> > jobCores;
+  unsigned nextJob;
+  unsigned runningJobs;
+  int winner;
+  bool shuttingDown;
+
+  static void *run(void *worker);
+
+  static void ignoreError(::Z3_context ctx, ::Z3_error_code ec) {}
+
+  /// The answer of a script, which is its first line of sat, unsat or
+  /// unknown, as the output may start with error messages. For unsat, the
+  /// 1-based indices of the constraints in the unsat core are returned, and
+  /// the answer is empty if the core is missing.
+  static std::string getAnswer(const std::string &output,
+                               std::vector<unsigned> &core);
+
+  void work(Worker &worker);
+
+  std::string makeScript(const ConstraintManager &constraints,
+                         ref<Expr> query);
+
+  bool batchDone() const {
+    return (nextJob >= scripts.size() || winner >= 0) && runningJobs == 0;
+  }
+
+public:
+  Z3ParallelSolverImpl(unsigned threadCount);
+  ~Z3ParallelSolverImpl();
+
+  int findValid(const ConstraintManager &constraints,
+                const std::vector<ref<Expr> > &queries, double timeout,
+                double &usefulTime, double &wastedTime,
+                std::vector<bool> &invalid, std::vector<ref<Expr> > &unsatCore);
+};
+
+Z3ParallelSolverImpl::Z3ParallelSolverImpl(unsigned threadCount)
+    : builder(new Z3Builder(/*autoClearConstructCache=*/false)),
+      workers(threadCount ? threadCount : 1), nextJob(0), runningJobs(0),
+      winner(-1), shuttingDown(false) {
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&batchStarted, NULL);
+  pthread_cond_init(&jobFinished, NULL);
+
+  for (std::vector<Worker>::iterator it = workers.begin(),
+                                     ie = workers.end();
+       it != ie; ++it) {
+    it->owner = this;
+    it->ctx = NULL;
+    it->job = -1;
+    it->interrupted = false;
+    pthread_create(&it->thread, NULL, run, &(*it));
+  }
+}
+
+Z3ParallelSolverImpl::~Z3ParallelSolverImpl() {
+  pthread_mutex_lock(&lock);
+  shuttingDown = true;
+  pthread_cond_broadcast(&batchStarted);
+  pthread_mutex_unlock(&lock);
+
+  for (std::vector<Worker>::iterator it = workers.begin(),
+                                     ie = workers.end();
+       it != ie; ++it) {
+    pthread_join(it->thread, NULL);
+  }
+
+  pthread_cond_destroy(&jobFinished);
+  pthread_cond_destroy(&batchStarted);
+  pthread_mutex_destroy(&lock);
+  delete builder;
+}
+
+void *Z3ParallelSolverImpl::run(void *worker) {
+  Worker *w = static_cast<Worker *>(worker);
+  w->owner->work(*w);
+  return NULL;
+}
+
+void Z3ParallelSolverImpl::work(Worker &worker) {
+  pthread_mutex_lock(&lock);
+  while (true) {
+    while (!shuttingDown && (nextJob >= scripts.size() || winner >= 0))
+      pthread_cond_wait(&batchStarted, &lock);
+    if (shuttingDown)
+      break;
+
+    unsigned job = nextJob++;
+    ++runningJobs;
+    const std::string &script = scripts[job];
+
+    // The context is created without a timeout, which is set by the script
+    // itself.
+    if (worker.interrupted) {
+      Z3_del_context(worker.ctx);
+      worker.ctx = NULL;
+      worker.interrupted = false;
+    }
+    if (!worker.ctx) {
+      ::Z3_config cfg = Z3_mk_config();
+      worker.ctx = Z3_mk_context(cfg);
+      Z3_del_config(cfg);
+      // Errors, such as due to cancellation, are reported in the result
+      Z3_set_error_handler(worker.ctx, ignoreError);
+    }
+    worker.job = job;
+    pthread_mutex_unlock(&lock);
+
+    double start = util::getWallTime();
+    std::vector<unsigned> core;
+    std::string answer =
+        getAnswer(Z3_eval_smtlib2_string(worker.ctx, script.c_str()), core);
+    double elapsed = util::getWallTime() - start;
+
+    pthread_mutex_lock(&lock);
+    worker.job = -1;
+    jobTimes[job] = elapsed;
+    if (answer == "sat") {
+      // The negated query is satisfiable under the constraints
+      invalidJobs[job] = true;
+    } else if (answer == "unsat" && winner < 0) {
+      // The state constraints and the negated query are unsatisfiable, hence
+      // the query is valid
+      winner = job;
+      jobCores[job].swap(core);
+      for (std::vector<Worker>::iterator it = workers.begin(),
+                                         ie = workers.end();
+           it != ie; ++it) {
+        if (it->job >= 0) {
+          Z3_interrupt(it->ctx);
+          it->interrupted = true;
+        }
+      }
+    }
+    --runningJobs;
+    pthread_cond_signal(&jobFinished);
+  }
+
+  if (worker.ctx)
+    Z3_del_context(worker.ctx);
+  pthread_mutex_unlock(&lock);
+}
+
+std::string Z3ParallelSolverImpl::getAnswer(const std::string &output,
+                                            std::vector<unsigned> &core) {
+  std::istringstream lines(output);
+  std::string line;
+  while (std::getline(lines, line)) {
+    std::string::size_type end = line.find_last_not_of("\r");
+    line.erase(end == std::string::npos ? 0 : end + 1);
+    if (line == "sat" || line == "unknown")
+      return line;
+    if (line == "unsat")
+      break;
+  }
+  if (line != "unsat")
+    return "";
+
+  // The unsat core follows, as a list of the constraint trackers |1|, |2|,
+  // ... An error, such as due to cancellation, decides nothing
+  if (!std::getline(lines, line) || line.compare(0, 1, "(") != 0 ||
+      line.compare(0, 6, "(error") == 0)
+    return "";
+  for (std::string::iterator it = line.begin(), ie = line.end(); it != ie;
+       ++it) {
+    if (*it == '(' || *it == ')' || *it == '|')
+      *it = ' ';
+  }
+  std::istringstream trackers(line);
+  unsigned index;
+  while (trackers >> index)
+    core.push_back(index);
+  if (!trackers.eof())
+    return "";
+  return "unsat";
+}
+
+std::string Z3ParallelSolverImpl::makeScript(
+    const ConstraintManager &constraints, ref<Expr> query) {
+  // As in Z3SolverImpl::assertTrackedConstraints(), each constraint is tracked
+  // by a Boolean constant named after its index, here as an implication by
+  // the constant, which is assumed by the check.
+  Z3_sort sort = Z3_mk_bool_sort(builder->ctx);
+  std::vector<Z3ASTHandle> assumptions;
+  std::ostringstream trackers;
+  unsigned constraintIdCtr = 1;
+  for (ConstraintManager::const_iterator it = constraints.begin(),
+                                         ie = constraints.end();
+       it != ie; ++it) {
+    std::ostringstream stringStream;
+    stringStream << constraintIdCtr;
+
+    Z3_symbol symbol =
+        Z3_mk_string_symbol(builder->ctx, stringStream.str().c_str());
+    Z3ASTHandle constraintId(Z3_mk_const(builder->ctx, symbol, sort),
+                             builder->ctx);
+    assumptions.push_back(Z3ASTHandle(
+        Z3_mk_implies(builder->ctx, constraintId, builder->construct(*it)),
+        builder->ctx));
+    trackers << " |" << constraintIdCtr << "|";
+
+    constraintIdCtr++;
+  }
+  std::vector< ::Z3_ast> assumptionsArray(assumptions.begin(),
+                                          assumptions.end());
+
+  // As in Z3SolverImpl::getConstraintLog(), the script checks the
+  // satisfiability of the negation of the validity query.
+  Z3ASTHandle formula = Z3ASTHandle(
+      Z3_mk_not(builder->ctx, builder->construct(query)), builder->ctx);
+
+  std::string script = Z3_benchmark_to_smtlib_string(
+      builder->ctx, /*name=*/"", /*logic=*/"", /*status=*/"unknown",
+      /*attributes=*/"", /*num_assumptions=*/assumptionsArray.size(),
+      /*assumptions=*/assumptionsArray.empty() ? NULL : &assumptionsArray[0],
+      /*formula=*/formula);
+
+  // The check of the benchmark is replaced by a check under the trackers,
+  // followed by the retrieval of the unsat core
+  std::string::size_type check = script.rfind("(check-sat)");
+  if (check != std::string::npos)
+    script.erase(check);
+  script += "(check-sat-assuming (" + trackers.str() + " ))\n";
+  script += "(get-unsat-core)\n";
+  return script;
+}
+
+int Z3ParallelSolverImpl::findValid(const ConstraintManager &constraints,
+                                    const std::vector<ref<Expr> > &queries,
+                                    double timeout, double &usefulTime,
+                                    double &wastedTime,
+                                    std::vector<bool> &invalid,
+                                    std::vector<ref<Expr> > &unsatCore) {
+  invalid.assign(queries.size(), false);
+  if (queries.empty())
+    return -1;
+
+  // Each script first resets the declarations and the assertions left in the
+  // worker's context by its previous script.
+  std::ostringstream prefix;
+  prefix << "(reset)\n";
+  prefix << "(set-option :produce-unsat-cores true)\n";
+  unsigned timeoutInMilliSeconds = (unsigned)((timeout * 1000) + 0.5);
+  if (timeoutInMilliSeconds)
+    prefix << "(set-option :timeout " << timeoutInMilliSeconds << ")\n";
+
+  std::vector<std::string> batch;
+  for (std::vector<ref<Expr> >::const_iterator it = queries.begin(),
+                                               ie = queries.end();
+       it != ie; ++it) {
+    batch.push_back(prefix.str() + makeScript(constraints, *it));
+  }
+  builder->clearConstructCache();
+
+  pthread_mutex_lock(&lock);
+  scripts.swap(batch);
+  jobTimes.assign(scripts.size(), 0.0);
+  invalidJobs.assign(scripts.size(), false);
+  jobCores.assign(scripts.size(), std::vector<unsigned>());
+  nextJob = 0;
+  winner = -1;
+  pthread_cond_broadcast(&batchStarted);
+
+  while (!batchDone())
+    pthread_cond_wait(&jobFinished, &lock);
+
+  int ret = winner;
+  for (unsigned i = 0; i < jobTimes.size(); ++i) {
+    if ((int)i == ret)
+      usefulTime += jobTimes[i];
+    else
+      wastedTime += jobTimes[i];
+  }
+  invalid = invalidJobs;
+  if (ret >= 0) {
+    std::set<unsigned> core(jobCores[ret].begin(), jobCores[ret].end());
+    unsigned constraintIdCtr = 1;
+    for (ConstraintManager::const_iterator it = constraints.begin(),
+                                           ie = constraints.end();
+         it != ie; ++it, ++constraintIdCtr) {
+      if (core.count(constraintIdCtr))
+        unsatCore.push_back(*it);
+    }
+  }
+  scripts.clear();
+  pthread_mutex_unlock(&lock);
+
+  return ret;
+}
+
+Z3ParallelSolver::Z3ParallelSolver(unsigned threadCount)
+    : impl(new Z3ParallelSolverImpl(threadCount)) {}
+
+Z3ParallelSolver::~Z3ParallelSolver() { delete impl; }
+
+int Z3ParallelSolver::findValid(const ConstraintManager &constraints,
+                                const std::vector<ref<Expr> > &queries,
+                                double timeout, double &usefulTime,
+                                double &wastedTime,
+                                std::vector<bool> &invalid,
+                                std::vector<ref<Expr> > &unsatCore) {
+  return impl->findValid(constraints, queries, timeout, usefulTime,
+                         wastedTime, invalid, unsatCore);
+}
 }
 #endif // ENABLE_Z3
@@ -22,6 +22,8 @@
 #include <malloc/malloc.h>
 #endif
 
+#include <sys/resource.h>
+
 using namespace klee;
 
 size_t util::GetTotalMallocUsage() {
@@ -55,3 +57,16 @@ size_t util::GetTotalMallocUsage() {
 
 #endif
 }
+
+size_t util::GetPeakResidentSetSize() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage))
+    return 0;
+#if defined(__APPLE__)
+  // Darwin reports the size in bytes
+  return usage.ru_maxrss;
+#else
+  // Linux reports the size in kilobytes
+  return (size_t)usage.ru_maxrss * 1024;
+#endif
+}
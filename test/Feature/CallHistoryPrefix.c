@@ -0,0 +1,34 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 --exit-on-error %t1.bc
+// RUN: grep "subsumed paths = [1-9]" %t.klee-out/info
+// REQUIRES: z3
+
+// The body of the match in count() is first completed with the call history
+// of the outermost call, and is reached again by the recursive calls, whose
+// call histories extend it by the recursive call site. The table entry of the
+// outermost call subsumes them.
+
+#include <assert.h>
+#include <stdlib.h>
+#include <klee/klee.h>
+
+int limit = 10;
+
+void count(int depth, int s) {
+  if (s == depth) {
+    assert(limit > 0);
+    exit(0);
+  }
+  if (depth > 0)
+    count(depth - 1, s);
+}
+
+int main() {
+  int s;
+
+  klee_make_symbolic(&s, sizeof(s), "s");
+  count(3, s);
+
+  return 0;
+}
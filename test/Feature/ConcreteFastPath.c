@@ -0,0 +1,38 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out %t.klee-out2
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 --concrete-fast-path=false %t1.bc
+// RUN: %klee --output-dir=%t.klee-out2 --solver-backend=z3 %t1.bc
+// RUN: grep "Number of concrete operands without dependency computation" %t.klee-out2/info
+// RUN: grep "completed paths = " %t.klee-out/info > %t.full.paths
+// RUN: grep "completed paths = " %t.klee-out2/info > %t.fast.paths
+// RUN: diff %t.full.paths %t.fast.paths
+// RUN: grep "Number of subsumption checks = " %t.klee-out/info > %t.full.checks
+// RUN: grep "Number of subsumption checks = " %t.klee-out2/info > %t.fast.checks
+// RUN: diff %t.full.checks %t.fast.checks
+// REQUIRES: z3
+
+// A concrete table setup, followed by symbolic lookups into the table. The
+// constant operands of the setup computations have no value created with
+// -concrete-fast-path, which must not change the exploration.
+
+#include <klee/klee.h>
+
+int table[32];
+
+int main() {
+  int i, x, count = 0;
+
+  for (i = 0; i < 32; ++i)
+    table[i] = (i * 5 + 3) % 17;
+
+  klee_make_symbolic(&x, sizeof(x), "x");
+  klee_assume(x >= 0);
+  klee_assume(x < 32);
+
+  for (i = 0; i < 4; ++i) {
+    if (table[x] > i * 4)
+      count++;
+  }
+
+  return count;
+}
@@ -0,0 +1,31 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 --max-memory=200 %t1.bc > %t.log 2> %t.err
+// RUN: not grep "over memory cap" %t.err
+// RUN: grep "completed paths = " %t.klee-out/info
+// REQUIRES: z3
+
+// A path of a thousand interpolation tree nodes, each of which stores to a
+// new location, runs to completion within the memory cap. The peak memory of
+// the shared and of the copied stores on a deep path is compared by the
+// DeepPathPeakRSS benchmark in unittests/ADT.
+
+#include <klee/klee.h>
+
+#define DEPTH 1000
+
+int table[DEPTH];
+
+int main() {
+  int x, i;
+
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  for (i = 0; i < DEPTH; ++i) {
+    table[i] = x + i;
+    if (x == i)
+      return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,28 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out %t.klee-out2
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 --save-interpolants %t1.bc
+// RUN: grep "Saved .* subsumption table entries" %t.klee-out/messages.txt
+// RUN: %klee --output-dir=%t.klee-out2 --solver-backend=z3 --load-interpolants=%t.klee-out/interpolants.txdb %t1.bc
+// RUN: grep "Loaded .* subsumption table entries" %t.klee-out2/messages.txt
+// RUN: grep "Subsumptions by loaded table entries = " %t.klee-out2/info
+// RUN: not grep "Subsumptions by loaded table entries = 0$" %t.klee-out2/info
+// REQUIRES: z3
+
+// The loaded entries must subsume states of the second run, which requires
+// their arrays to be those the second run makes symbolic.
+
+#include <klee/klee.h>
+
+int main() {
+  int x[4];
+  int i, count = 0;
+
+  klee_make_symbolic(x, sizeof(x), "x");
+
+  for (i = 0; i < 4; ++i) {
+    if (x[i] > 0)
+      count++;
+  }
+
+  return 0;
+}
@@ -0,0 +1,28 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -DBOUND=5 -o %t1.bc
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -DBOUND=6 -o %t2.bc
+// RUN: rm -rf %t.klee-out %t.klee-out2
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 --save-interpolants %t1.bc
+// RUN: grep "Saved .* subsumption table entries" %t.klee-out/messages.txt
+// RUN: %klee --output-dir=%t.klee-out2 --solver-backend=z3 --load-interpolants=%t.klee-out/interpolants.txdb %t2.bc
+// RUN: grep "saved for a different module" %t.klee-out2/warnings.txt
+// RUN: not grep "Loaded .* subsumption table entries" %t.klee-out2/messages.txt
+// REQUIRES: z3
+
+// The two modules differ only in one constant, which must be enough for the
+// second run to reject the interpolants saved by the first.
+
+#include <klee/klee.h>
+
+int main() {
+  int x[4];
+  int i, count = 0;
+
+  klee_make_symbolic(x, sizeof(x), "x");
+
+  for (i = 0; i < 4; ++i) {
+    if (x[i] > BOUND)
+      count++;
+  }
+
+  return 0;
+}
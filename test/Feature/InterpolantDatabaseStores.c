@@ -0,0 +1,32 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out %t.klee-out2
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 --save-interpolants %t1.bc
+// RUN: grep "Saved [1-9][0-9]* of .* ([1-9][0-9]* with stores)" %t.klee-out/messages.txt
+// RUN: %klee --output-dir=%t.klee-out2 --solver-backend=z3 --load-interpolants=%t.klee-out/interpolants.txdb %t1.bc
+// RUN: grep "Loaded [1-9][0-9]* subsumption table entries ([1-9][0-9]* with stores)" %t.klee-out2/messages.txt
+// RUN: not grep "Subsumptions by loaded table entries = 0$" %t.klee-out2/info
+// REQUIRES: z3
+
+// The values stored into the local variables decide the later branches, so
+// the table entries have stores, which must survive the round trip through
+// the database and subsume states of the second run.
+
+#include <klee/klee.h>
+
+int main() {
+  int x[3];
+  int i, y, count = 0;
+
+  klee_make_symbolic(x, sizeof(x), "x");
+
+  for (i = 0; i < 3; ++i) {
+    if (x[i] > 0)
+      y = 1;
+    else
+      y = 2;
+    if (y > 1)
+      count++;
+  }
+
+  return 0;
+}
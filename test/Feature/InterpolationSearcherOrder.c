@@ -0,0 +1,34 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 --allow-external-sym-calls --search=interpolation %t.bc > %t.order.log 2>&1
+// RUN: FileCheck %s -input-file=%t.order.log
+// REQUIRES: z3
+
+// The false side of a branch is the most recently added state, and is
+// selected first. Once it terminates, the true side closes the subtree of the
+// first branch and is selected before its own false side is added.
+
+#include "klee/klee.h"
+#include <stdio.h>
+
+int main() {
+  int a, b;
+
+  klee_make_symbolic(&a, sizeof(a), "a");
+  klee_make_symbolic(&b, sizeof(b), "b");
+
+  if (a > 0) {
+    if (b > 0)
+      printf("a and b\n");
+    else
+      printf("a only\n");
+  } else {
+    printf("not a\n");
+  }
+
+  // CHECK: not a
+  // CHECK: a only
+  // CHECK: a and b
+
+  return 0;
+}
@@ -0,0 +1,34 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out %t.klee-out2
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 %t1.bc
+// RUN: %klee --output-dir=%t.klee-out2 --solver-backend=z3 --lazy-dependency %t1.bc
+// RUN: grep "Number of instructions recorded for lazy dependency computation" %t.klee-out2/info
+// RUN: grep "completed paths = " %t.klee-out/info > %t.eager.paths
+// RUN: grep "completed paths = " %t.klee-out2/info > %t.lazy.paths
+// RUN: diff %t.eager.paths %t.lazy.paths
+// RUN: grep "Number of subsumption checks = " %t.klee-out/info > %t.eager.checks
+// RUN: grep "Number of subsumption checks = " %t.klee-out2/info > %t.lazy.checks
+// RUN: diff %t.eager.checks %t.lazy.checks
+// REQUIRES: z3
+
+// With lazy dependency computation, the instructions of this loop-heavy
+// program are recorded, and the run completes the same paths and performs the
+// same subsumption checks as with eager dependency computation.
+
+#include <klee/klee.h>
+
+int main() {
+  int x[4];
+  int i, j, sum = 0, count = 0;
+
+  klee_make_symbolic(x, sizeof(x), "x");
+
+  for (i = 0; i < 4; ++i) {
+    for (j = 0; j < 64; ++j)
+      sum += (j * 7 + i) % 13;
+    if (x[i] > sum)
+      count++;
+  }
+
+  return count;
+}
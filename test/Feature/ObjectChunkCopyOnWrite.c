@@ -0,0 +1,41 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out %t.klee-out2
+// RUN: %klee --output-dir=%t.klee-out --exit-on-error --object-chunk-size=4096 %t1.bc
+// RUN: grep "object bytes copied per fork" %t.klee-out/info
+// RUN: grep "peak resident set size" %t.klee-out/info
+// RUN: %klee --output-dir=%t.klee-out2 --exit-on-error --object-chunk-size=100 %t1.bc
+
+// A large global table written by both sides of every fork. Each state must
+// see its own writes only, whatever the chunks shared with the other states.
+
+#include <assert.h>
+#include <klee/klee.h>
+
+#define SIZE (1 << 20)
+
+char table[SIZE];
+
+int main() {
+  int x, i;
+
+  for (i = 0; i < SIZE; i += 4096)
+    table[i] = 1;
+
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  if (x > 0) {
+    table[0] = 2;
+    table[SIZE - 1] = 3;
+  } else {
+    table[5000] = 4;
+  }
+
+  if (x > 0) {
+    assert(table[0] == 2 && table[SIZE - 1] == 3 && table[5000] == 0);
+  } else {
+    assert(table[0] == 1 && table[SIZE - 1] == 0 && table[5000] == 4);
+  }
+  assert(table[4096] == 1);
+
+  return 0;
+}
@@ -0,0 +1,31 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out %t.klee-out2
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 --exit-on-error %t1.bc
+// RUN: %klee --output-dir=%t.klee-out2 --solver-backend=z3 --exit-on-error --parallel-subsumption=4 --subsumption-threads=2 %t1.bc
+// RUN: grep "Parallel subsumption batches = [1-9]" %t.klee-out2/info
+// RUN: grep "completed paths = " %t.klee-out/info > %t.sequential.paths
+// RUN: grep "completed paths = " %t.klee-out2/info > %t.parallel.paths
+// RUN: diff %t.sequential.paths %t.parallel.paths
+// REQUIRES: z3
+
+// The subsumptions decided by the parallel solver are completed with the
+// unsat core returned by its worker, and the run must still find the
+// assertion to hold on every path.
+
+#include <assert.h>
+#include <klee/klee.h>
+
+int main() {
+  int x[4];
+  int i, count = 0;
+
+  klee_make_symbolic(x, sizeof(x), "x");
+
+  for (i = 0; i < 4; ++i) {
+    if (x[i] > 0)
+      count++;
+  }
+  assert(count <= 4);
+
+  return 0;
+}
@@ -0,0 +1,34 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out %t.cache.txdep
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 --spec-type=safety --write-spec-avoid --spec-dependency-cache=%t.cache.txdep %t1.bc
+// RUN: ls %t.klee-out | grep -c "^SpecAvoid_" | grep "^1$"
+// RUN: tail -n +2 %S/SpecDependency/SpecAvoid_7.txt > %t.expected
+// RUN: tail -n +2 %t.klee-out/SpecAvoid_*.txt > %t.computed
+// RUN: diff %t.expected %t.computed
+// RUN: test -f %t.cache.txdep
+// RUN: not ls %t1.bc.txdep
+// REQUIRES: z3
+
+// The dependency set computed for the only target block, the one failing the
+// assertion, matches the SpecAvoid file of the dependency folder: the
+// assertion is controlled by the branch on y, and not by the one on x.
+
+#include <assert.h>
+#include <klee/klee.h>
+
+int main() {
+  int x, y, z;
+
+  klee_make_symbolic(&x, sizeof(x), "x");
+  klee_make_symbolic(&y, sizeof(y), "y");
+
+  if (x > 0)
+    z = 1;
+  else
+    z = 2;
+
+  if (y > 10)
+    assert(z == 1);
+
+  return 0;
+}
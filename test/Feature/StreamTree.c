@@ -0,0 +1,28 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 --stream-tree %t1.bc
+// RUN: tx-tree-convert %t.klee-out --format=json -o %t.json
+// RUN: tx-tree-convert %t.klee-out/tree.log -o %t.dot
+// RUN: grep -c "\"id\":" %t.json | grep "^3$"
+// RUN: grep -c "\"parent\": null" %t.json | grep "^1$"
+// RUN: grep -c " -> " %t.dot | grep "^2$"
+// RUN: grep -c "shape=record" %t.dot | grep "^3$"
+// REQUIRES: z3
+
+// A single branch: the log converts into a root node with its two children,
+// and the two edges from the root.
+
+#include <klee/klee.h>
+
+int main() {
+  int x, y = 0;
+
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  if (x > 0)
+    y = 1;
+  else
+    y = 2;
+
+  return y;
+}
@@ -0,0 +1,26 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 --max-subsumption-failure=2 --subsumption-eviction=lru %t1.bc
+// RUN: grep "Table eviction policy = lru" %t.klee-out/info
+// RUN: grep "Peak table entries = [0-2]$" %t.klee-out/info
+// RUN: grep "Evicted table entries by entry limit" %t.klee-out/info
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 %t1.bc
+// RUN: not grep "Table eviction policy" %t.klee-out/info
+// REQUIRES: z3
+
+#include <klee/klee.h>
+
+int main() {
+  int x[4];
+  int i, count = 0;
+
+  klee_make_symbolic(x, sizeof(x), "x");
+
+  for (i = 0; i < 4; ++i) {
+    if (x[i] > 0)
+      count++;
+  }
+
+  return count;
+}
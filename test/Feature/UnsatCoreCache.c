@@ -0,0 +1,40 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out %t.klee-out2
+// RUN: %klee --output-dir=%t.klee-out --solver-backend=z3 --unsat-core-cache %t1.bc
+// RUN: grep "Number of branch evaluations looked up in the unsat core cache = " %t.klee-out/info
+// RUN: not grep "Number of branch evaluations looked up in the unsat core cache = 0$" %t.klee-out/info
+// RUN: grep "Number of branch evaluations answered by the unsat core cache = " %t.klee-out/info
+// RUN: not grep "Number of branch evaluations answered by the unsat core cache = 0$" %t.klee-out/info
+// RUN: grep "Number of unsat cores evicted from the unsat core cache = 0$" %t.klee-out/info
+// RUN: %klee --output-dir=%t.klee-out2 --solver-backend=z3 --unsat-core-cache --max-unsat-core-cache=1 %t1.bc
+// RUN: grep "Number of unsat cores evicted from the unsat core cache = " %t.klee-out2/info
+// REQUIRES: z3
+
+// Both sides of the branch on y evaluate the branch on x > 5 under x > 10.
+// The unsat core found for the first side answers the second.
+
+#include <klee/klee.h>
+
+int main() {
+  int x, y, z = 0;
+
+  klee_make_symbolic(&x, sizeof(x), "x");
+  klee_make_symbolic(&y, sizeof(y), "y");
+
+  if (x > 10) {
+    if (y > 0)
+      z = 1;
+    else
+      z = 2;
+
+    if (x > 5)
+      z += 3;
+    else
+      z += 4;
+
+    if (y > 100)
+      z += 5;
+  }
+
+  return z;
+}
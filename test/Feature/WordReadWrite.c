@@ -0,0 +1,41 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t1.bc
+// RUN: rm -rf %t.klee-out
+// RUN: %klee --output-dir=%t.klee-out --exit-on-error %t1.bc
+// RUN: grep "whole word reads = " %t.klee-out/info
+// RUN: not grep "whole word reads = 0$" %t.klee-out/info
+// RUN: grep "symbolic offset word accesses = " %t.klee-out/info
+// RUN: not grep "symbolic offset word accesses = 0$" %t.klee-out/info
+
+// Words read and written as a whole at concrete and symbolic offsets must
+// read back the same values as through their bytes.
+
+#include <assert.h>
+#include <klee/klee.h>
+
+unsigned long long words[4] = { 1, 0x0102030405060708ULL, 3, 4 };
+
+int main() {
+  unsigned long long v;
+  unsigned char *bytes = (unsigned char *) words;
+  unsigned i;
+
+  klee_make_symbolic(&v, sizeof(v), "v");
+  klee_make_symbolic(&i, sizeof(i), "i");
+  klee_assume(i < 4);
+
+  // A concrete word, assembled directly into a constant
+  assert(words[1] == 0x0102030405060708ULL);
+
+  // A symbolic word written at a concrete offset, and read back as a whole
+  words[2] = v;
+  assert(words[2] == v);
+  assert(bytes[16] == (unsigned char) v);
+
+  // A word written and read at a symbolic offset
+  words[i] = v + 1;
+  assert(words[i] == v + 1);
+  if (i != 1)
+    assert(words[1] == 0x0102030405060708ULL);
+
+  return 0;
+}
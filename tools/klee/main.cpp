@@ -19,6 +19,7 @@
 #include "klee/Internal/ADT/TreeStream.h"
 #include "klee/Internal/Support/Debug.h"
 #include "klee/Internal/Support/ModuleUtil.h"
+#include "klee/Internal/System/MemoryUsage.h"
 #include "klee/Internal/System/Time.h"
 #include "klee/Internal/Support/PrintVersion.h"
 #include "klee/Internal/Support/ErrorHandling.h"
@@ -1681,6 +1682,26 @@ int main(int argc, char **argv, char **envp) {
   handler->getInfoStream()
     << "KLEE: done: explored paths = " << 1 + forks << "\n";
 
+  // The object contents copied on write, which are shared between the states
+  // in chunks of -object-chunk-size bytes
+  uint64_t objectBytesCopied =
+    *theStatisticManager->getStatisticByName("ObjectBytesCopied");
+  handler->getInfoStream()
+    << "KLEE: done: object bytes copied per fork = "
+    << (forks ? objectBytesCopied / forks : objectBytesCopied) << "\n"
+    << "KLEE: done: peak resident set size (MB) = "
+    << util::GetPeakResidentSetSize() / (1024 * 1024) << "\n";
+
+  // The multi-byte memory accesses handled as whole words by ObjectState
+  uint64_t wordReads =
+    *theStatisticManager->getStatisticByName("WordReads");
+  uint64_t symbolicWordAccesses =
+    *theStatisticManager->getStatisticByName("SymbolicWordAccesses");
+  handler->getInfoStream()
+    << "KLEE: done: whole word reads = " << wordReads << "\n"
+    << "KLEE: done: symbolic offset word accesses = "
+    << symbolicWordAccesses << "\n";
+
   // Write some extra information in the info file which users won't
   // necessarily care about or understand.
   if (queries)
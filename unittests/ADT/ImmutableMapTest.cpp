@@ -0,0 +1,150 @@
+//===-- ImmutableMapTest.cpp ------------------------------------*- C++ -*-===//
+//
+//               The Tracer-X KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+/* Memory benchmark for the persistent maps used by TxStore and
+   TxPathCondition. A deep path is simulated by a chain of nodes, each copying
+   the map of its parent and adding one entry, with all nodes kept alive as
+   they are in the interpolation tree. The peak resident set sizes of the
+   persistent and of the copying scheme on such a path are measured in child
+   processes and reported. */
+
+#include "gtest/gtest.h"
+
+#include "klee/Internal/ADT/ImmutableMap.h"
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+typedef ImmutableMap<unsigned, unsigned> PersistentMap;
+typedef std::map<unsigned, unsigned> CopiedMap;
+
+const unsigned pathDepth = 2000;
+
+void buildNothing() {}
+
+void buildPersistentPath() {
+  std::vector<PersistentMap> path(1);
+  path.reserve(pathDepth + 1);
+  for (unsigned depth = 1; depth <= pathDepth; ++depth)
+    path.push_back(path.back().replace(std::make_pair(depth, depth)));
+}
+
+void buildCopiedPath() {
+  std::vector<CopiedMap> path(1);
+  path.reserve(pathDepth + 1);
+  for (unsigned depth = 1; depth <= pathDepth; ++depth) {
+    path.push_back(path.back());
+    path.back()[depth] = depth;
+  }
+}
+
+/// Run the function in a child process and return the peak resident set size
+/// of the child, in the units of ru_maxrss, or -1 if the child failed
+long peakChildRSS(void (*build)()) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    build();
+    _exit(0);
+  }
+  if (pid < 0)
+    return -1;
+
+  int status;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) ||
+      WEXITSTATUS(status))
+    return -1;
+  return usage.ru_maxrss;
+}
+
+// This runs first, while the heap of this process is small: a child inherits
+// the resident pages of its parent, including the memory freed by earlier
+// tests, which the baseline measures and the child may reuse.
+TEST(ImmutableMapTest, DeepPathPeakRSS) {
+  long baseline = peakChildRSS(buildNothing);
+  long persistent = peakChildRSS(buildPersistentPath);
+  long copied = peakChildRSS(buildCopiedPath);
+  ASSERT_LE(0, baseline);
+  ASSERT_LE(baseline, persistent);
+  ASSERT_LE(baseline, copied);
+
+  std::cout << "Peak RSS on a path of depth " << pathDepth
+            << " above a baseline of " << baseline
+            << " (ru_maxrss units): persistent maps " << persistent - baseline
+            << ", copied maps " << copied - baseline << "\n";
+
+  EXPECT_LT((persistent - baseline) * 10, copied - baseline);
+}
+
+TEST(ImmutableMapTest, DeepPathSharing) {
+  size_t baseAllocated = PersistentMap::getAllocated();
+  size_t persistentNodes = 0, copiedElements = 0;
+
+  {
+    std::vector<PersistentMap> persistentPath(1);
+    std::vector<CopiedMap> copiedPath(1);
+
+    for (unsigned depth = 1; depth <= pathDepth; ++depth) {
+      PersistentMap persistent = persistentPath.back();
+      persistentPath.push_back(
+          persistent.replace(std::make_pair(depth, depth)));
+
+      CopiedMap copied = copiedPath.back();
+      copied[depth] = depth;
+      copiedPath.push_back(copied);
+    }
+
+    persistentNodes = PersistentMap::getAllocated() - baseAllocated;
+    for (std::vector<CopiedMap>::iterator it = copiedPath.begin(),
+                                          ie = copiedPath.end();
+         it != ie; ++it)
+      copiedElements += it->size();
+
+    // Each node still sees exactly the entries of its own path prefix
+    for (unsigned depth = 0; depth <= pathDepth; depth += pathDepth / 10) {
+      EXPECT_EQ(depth, persistentPath[depth].size());
+      EXPECT_EQ(0u, persistentPath[depth].count(depth + 1));
+      if (depth)
+        EXPECT_EQ(1u, persistentPath[depth].count(depth));
+    }
+  }
+
+  // The copying scheme stores depth * (depth + 1) / 2 elements, while the
+  // persistent map only allocates O(log depth) nodes per update.
+  EXPECT_EQ(pathDepth * (pathDepth + 1) / 2, copiedElements);
+  EXPECT_LT(persistentNodes * 20, copiedElements);
+
+  // Everything is released once the path is gone
+  EXPECT_EQ(baseAllocated, PersistentMap::getAllocated());
+}
+
+TEST(ImmutableMapTest, ReplaceDoesNotAffectParent) {
+  PersistentMap parent;
+  parent = parent.replace(std::make_pair(1u, 10u));
+
+  PersistentMap child = parent.replace(std::make_pair(1u, 20u));
+  child = child.replace(std::make_pair(2u, 30u));
+
+  ASSERT_TRUE(parent.lookup(1u));
+  EXPECT_EQ(10u, parent.lookup(1u)->second);
+  EXPECT_FALSE(parent.lookup(2u));
+  EXPECT_EQ(20u, child.lookup(1u)->second);
+  EXPECT_EQ(30u, child.lookup(2u)->second);
+}
+}
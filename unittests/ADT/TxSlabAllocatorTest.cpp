@@ -0,0 +1,165 @@
+//===-- TxSlabAllocatorTest.cpp ---------------------------------*- C++ -*-===//
+//
+//               The Tracer-X KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+/* Microbenchmark for the slab allocators of the interpolation tree. A trace of
+   branches and removals is recorded from a depth-first exploration of a random
+   tree, as done by TxTree::split and TxTree::remove, and replayed once with
+   slab-allocated nodes and once with nodes allocated by the global operator
+   new. */
+
+#include "gtest/gtest.h"
+
+#include "klee/Internal/ADT/TxSlabAllocator.h"
+
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+/// A node roughly the size of a TxTreeNode, allocated by the global operator
+/// new
+struct PlainNode {
+  PlainNode *parent, *left, *right;
+  char payload[160];
+
+  explicit PlainNode(PlainNode *_parent)
+      : parent(_parent), left(0), right(0) {}
+};
+
+/// The same node, allocated from a slab
+struct SlabNode {
+  SlabNode *parent, *left, *right;
+  char payload[160];
+
+  static TxSlabAllocator<SlabNode> allocator;
+
+  explicit SlabNode(SlabNode *_parent) : parent(_parent), left(0), right(0) {}
+
+  static void *operator new(size_t size) { return allocator.allocate(size); }
+
+  static void operator delete(void *p, size_t size) {
+    allocator.deallocate(p, size);
+  }
+};
+
+TxSlabAllocator<SlabNode> SlabNode::allocator("SlabNode");
+
+enum Event { BRANCH, REMOVE };
+
+const unsigned branchCount = 200000;
+
+/// Record the events of a depth-first exploration of a random binary tree
+/// with the given number of branches.
+std::vector<Event> recordTrace(unsigned branches) {
+  std::vector<Event> trace;
+  // The number of unexplored siblings on the path of the current leaf
+  unsigned pending = 0;
+  std::srand(1);
+  while (branches) {
+    if (!pending || std::rand() % 2) {
+      --branches;
+      ++pending;
+      trace.push_back(BRANCH);
+    } else {
+      --pending;
+      trace.push_back(REMOVE);
+    }
+  }
+  while (pending) {
+    --pending;
+    trace.push_back(REMOVE);
+  }
+  // The last leaf, and with it the rest of the tree
+  trace.push_back(REMOVE);
+  return trace;
+}
+
+/// Replay the trace, returning the peak number of live nodes
+template <class Node> unsigned replay(const std::vector<Event> &trace) {
+  Node *root = new Node(0);
+  Node *current = root;
+  unsigned live = 1, peak = 1;
+  for (std::vector<Event>::const_iterator it = trace.begin(), ie = trace.end();
+       it != ie; ++it) {
+    if (*it == BRANCH) {
+      current->left = new Node(current);
+      current->right = new Node(current);
+      current = current->left;
+      live += 2;
+      if (live > peak)
+        peak = live;
+      continue;
+    }
+
+    // Remove the current leaf and its ancestors with no remaining child, then
+    // continue with the next unexplored leaf
+    Node *node = current;
+    do {
+      Node *parent = node->parent;
+      if (parent) {
+        if (node == parent->left)
+          parent->left = 0;
+        else
+          parent->right = 0;
+      }
+      delete node;
+      --live;
+      node = parent;
+    } while (node && !node->left && !node->right);
+    current = node ? (node->left ? node->left : node->right) : 0;
+  }
+  EXPECT_TRUE(current == 0);
+  EXPECT_EQ(0u, live);
+  return peak;
+}
+
+TEST(TxSlabAllocatorTest, BranchRemoveTrace) {
+  std::vector<Event> trace = recordTrace(branchCount);
+  uint64_t baseTotal = SlabNode::allocator.getTotal();
+
+  clock_t start = clock();
+  unsigned plainPeak = replay<PlainNode>(trace);
+  clock_t plainTicks = clock() - start;
+
+  start = clock();
+  unsigned slabPeak = replay<SlabNode>(trace);
+  clock_t slabTicks = clock() - start;
+
+  RecordProperty("PlainMicroseconds",
+                 (int)(plainTicks * 1000000 / CLOCKS_PER_SEC));
+  RecordProperty("SlabMicroseconds",
+                 (int)(slabTicks * 1000000 / CLOCKS_PER_SEC));
+
+  EXPECT_EQ(plainPeak, slabPeak);
+  EXPECT_EQ(2 * branchCount + 1, SlabNode::allocator.getTotal() - baseTotal);
+  EXPECT_EQ(0u, SlabNode::allocator.getLive());
+  EXPECT_LE(slabPeak, SlabNode::allocator.getPeak());
+
+  // The freed slots are reused, so the slabs only grow with the peak number
+  // of live nodes and not with the number of allocations.
+  EXPECT_LE(SlabNode::allocator.getReservedBytes(),
+            (slabPeak / 1024 + 1) * 1024 * 2 * sizeof(SlabNode));
+}
+
+TEST(TxSlabAllocatorTest, LastFreedSlotIsReusedFirst) {
+  SlabNode *a = new SlabNode(0);
+  SlabNode *b = new SlabNode(0);
+  delete a;
+  delete b;
+  SlabNode *c = new SlabNode(0);
+  SlabNode *d = new SlabNode(0);
+  EXPECT_EQ(b, c);
+  EXPECT_EQ(a, d);
+  delete c;
+  delete d;
+}
+}
@@ -12,6 +12,7 @@
 
 #include "klee/Expr.h"
 #include "klee/util/ArrayCache.h"
+#include "klee/util/ConstraintPartition.h"
 
 using namespace klee;
 
@@ -113,4 +114,42 @@ TEST(ExprTest, ExtractConcat) {
   EXPECT_EQ(Expr::Extract, concat2->getKid(1)->getKind());
 }
 
+TEST(ExprTest, ConstraintPartition) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("arr4", 4);
+  const Array *b = ac.CreateArray("arr5", 4);
+  UpdateList ua(a, 0), ub(b, 0);
+
+  ref<Expr> a0 = ReadExpr::create(ua, getConstant(0, Expr::Int32));
+  ref<Expr> a1 = ReadExpr::create(ua, getConstant(1, Expr::Int32));
+  ref<Expr> b0 = ReadExpr::create(ub, getConstant(0, Expr::Int32));
+  ref<Expr> b1 = ReadExpr::create(ub, getConstant(1, Expr::Int32));
+
+  ConstraintPartition partition;
+  partition.add(0, UltExpr::create(a0, getConstant(10, Expr::Int8)));
+  partition.add(1, UltExpr::create(a1, getConstant(10, Expr::Int8)));
+  partition.add(2, EqExpr::create(b0, b1));
+
+  std::vector<unsigned> indices;
+  partition.getDependentConstraints(EqExpr::create(a0, b0), indices);
+  ASSERT_EQ(2U, indices.size());
+  EXPECT_EQ(0U, indices[0]);
+  EXPECT_EQ(2U, indices[1]);
+
+  std::vector<std::vector<unsigned> > factors;
+  partition.getFactors(factors);
+  EXPECT_EQ(3U, factors.size());
+
+  // A read at a symbolic index depends on all the bytes of the array
+  partition.add(3, UltExpr::create(ReadExpr::create(ua, b1),
+                                   getConstant(5, Expr::Int8)));
+  indices.clear();
+  partition.getDependentConstraints(a0, indices);
+  ASSERT_EQ(4U, indices.size());
+  EXPECT_EQ(3U, indices[3]);
+
+  factors.clear();
+  partition.getFactors(factors);
+  EXPECT_EQ(1U, factors.size());
+}
 }
@@ -11,6 +11,7 @@
 #include "gtest/gtest.h"
 
 #include "klee/CommandLine.h"
+#include "klee/Config/config.h"
 #include "klee/Constraints.h"
 #include "klee/Expr.h"
 #include "klee/Solver.h"
@@ -166,4 +167,86 @@ TEST(SolverTest, Evaluation) {
   delete solver;
 }
 
+#ifdef ENABLE_Z3
+TEST(SolverTest, Z3IncrementalSession) {
+  Z3Solver solver;
+
+  const Array *array = ac.CreateArray("session", 1);
+  ref<Expr> x = Expr::createTempRead(array, Expr::Int8);
+  ref<Expr> constraint =
+      UltExpr::create(ConstantExpr::create(5, Expr::Int8), x);
+
+  ConstraintManager constraints;
+  constraints.addConstraint(constraint);
+
+  solver.startSession(constraints);
+  EXPECT_TRUE(solver.inSession());
+
+  // Queries in the session are independent of each other
+  bool isValid = false;
+  std::vector<ref<Expr> > unsatCore;
+  EXPECT_TRUE(solver.sessionComputeTruth(
+      UltExpr::create(ConstantExpr::create(3, Expr::Int8), x), isValid,
+      unsatCore));
+  EXPECT_TRUE(isValid);
+  ASSERT_EQ(1u, unsatCore.size());
+  EXPECT_EQ(constraint, unsatCore[0]);
+
+  unsatCore.clear();
+  EXPECT_TRUE(solver.sessionComputeTruth(
+      UltExpr::create(ConstantExpr::create(10, Expr::Int8), x), isValid,
+      unsatCore));
+  EXPECT_FALSE(isValid);
+  EXPECT_TRUE(unsatCore.empty());
+
+  EXPECT_TRUE(solver.sessionComputeTruth(
+      UltExpr::create(ConstantExpr::create(4, Expr::Int8), x), isValid,
+      unsatCore));
+  EXPECT_TRUE(isValid);
+
+  solver.endSession();
+  EXPECT_FALSE(solver.inSession());
+}
+
+TEST(SolverTest, Z3ParallelSolver) {
+  Z3ParallelSolver solver(2);
+
+  const Array *array = ac.CreateArray("parallel", 1);
+  ref<Expr> x = Expr::createTempRead(array, Expr::Int8);
+
+  ConstraintManager constraints;
+  constraints.addConstraint(
+      UltExpr::create(ConstantExpr::create(5, Expr::Int8), x));
+
+  std::vector<ref<Expr> > queries;
+  queries.push_back(UltExpr::create(ConstantExpr::create(10, Expr::Int8), x));
+  queries.push_back(UltExpr::create(ConstantExpr::create(20, Expr::Int8), x));
+  queries.push_back(UltExpr::create(ConstantExpr::create(3, Expr::Int8), x));
+
+  double usefulTime = 0, wastedTime = 0;
+  std::vector<bool> invalid;
+  EXPECT_EQ(2, solver.findValid(constraints, queries, 0, usefulTime,
+                                wastedTime, invalid));
+  EXPECT_EQ(3u, invalid.size());
+  EXPECT_FALSE(invalid[2]);
+
+  // The solver is reused for the next batch, whose scripts declare the same
+  // array in the contexts of the previous batch
+  queries.pop_back();
+  EXPECT_EQ(-1, solver.findValid(constraints, queries, 0, usefulTime,
+                                 wastedTime, invalid));
+  EXPECT_TRUE(invalid[0]);
+  EXPECT_TRUE(invalid[1]);
+  EXPECT_GE(wastedTime, 0.0);
+
+  // The assertions of the previous batch do not make a valid query appear
+  // invalid
+  queries.clear();
+  queries.push_back(UltExpr::create(ConstantExpr::create(3, Expr::Int8), x));
+  EXPECT_EQ(0, solver.findValid(constraints, queries, 1, usefulTime,
+                                wastedTime, invalid));
+  EXPECT_FALSE(invalid[0]);
+}
+#endif
+
 }